@@ -0,0 +1,102 @@
+#include "jumpflooding.h"
+
+
+JumpFlooding::JumpFlooding(int width, int height) :
+        seedProgram("shaders/jfa_seed.vert", "shaders/jfa_seed.frag"),
+        floodProgram("shaders/jfa_flood.vert", "shaders/jfa_flood.frag"),
+        width(0), height(0), current(0)
+{
+    glGenTextures(2, idTextures);
+    glGenFramebuffers(2, framebuffers);
+    glGenTextures(1, &siteTexture);
+    glGenVertexArrays(1, &emptyVAO);
+    resize(width, height);
+}
+
+JumpFlooding::~JumpFlooding()
+{
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteTextures(1, &siteTexture);
+    glDeleteFramebuffers(2, framebuffers);
+    glDeleteTextures(2, idTextures);
+}
+
+void JumpFlooding::resize(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    for (int i = 0; i < 2; i++) {
+        // ids are read with texelFetch, there is nothing to filter
+        glBindTexture(GL_TEXTURE_2D, idTextures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, idTextures[i], 0);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void JumpFlooding::update(unsigned int siteBuffer, unsigned int siteCount)
+{
+    // the buffer of the sites changes when it grows, so it is attached again every time
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, siteTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, siteBuffer);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glViewport(0, 0, width, height);
+    glBindVertexArray(emptyVAO);
+
+    // seed: no site anywhere, and then every site in its pixel; when sites share a pixel the last one stays
+    current = 0;
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[current]);
+    const GLuint none[4] = {0, 0, 0, 0};
+    glClearBufferuiv(GL_COLOR, 0, none);
+    glUseProgram(seedProgram.ID);
+    seedProgram.setInt("sites", 1);
+    glDrawArrays(GL_POINTS, 0, siteCount);
+
+    // flood: steps of half the size of the screen, rounded up to a power of 2, down to 1, and then 1 again, which
+    // fixes most of the few pixels the halving steps get wrong
+    int step = 1;
+    while (step < width || step < height)
+        step *= 2;
+    glUseProgram(floodProgram.ID);
+    floodProgram.setInt("nearest", 0);
+    floodProgram.setInt("sites", 1);
+    for (step /= 2; step >= 1; step /= 2) {
+        for (int repeat = step == 1 ? 2 : 1; repeat > 0; repeat--) {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[1 - current]);
+            glBindTexture(GL_TEXTURE_2D, idTextures[current]);
+            floodProgram.setInt("step", step);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            current = 1 - current;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+}
+
+void JumpFlooding::draw(const Shader &look) const
+{
+    // one point per pixel, the pixels go through the fragment shader of the look as if they were a cone
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(look.ID);
+    look.setInt("nearest", 0);
+    look.setInt("sites", 1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, idTextures[current]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, siteTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_POINTS, 0, width * height);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+}
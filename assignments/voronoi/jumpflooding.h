@@ -0,0 +1,48 @@
+#ifndef JUMP_FLOODING_H
+#define JUMP_FLOODING_H
+
+#include <glad/glad.h>
+
+#include <shader.h>
+
+
+/// Computes the Voronoi diagram with the jump flooding algorithm, at a cost that does not grow with the sites.
+/// The pixel of every site is seeded with the site id, and then every pixel looks at 9 pixels, itself and 8 at a
+/// distance of N/2 and takes the nearest of their sites, then at N/4, and so on down to 1, which is log2(N) passes
+/// over the screen. The ids ping-pong between two textures, and the offsets and colors of the sites are read from
+/// the instance buffer of the cones through a buffer texture.
+
+class JumpFlooding
+{
+public:
+    // compiles the seed and flood programs, the textures are made by resize()
+    JumpFlooding(int width, int height);
+    ~JumpFlooding();
+
+    // makes the textures the size of the screen
+    void resize(int width, int height);
+
+    // finds the nearest site of every pixel, the sites are 5 floats each in siteBuffer, offset x, y and color r, g, b
+    void update(unsigned int siteBuffer, unsigned int siteCount);
+
+    // draws one point per pixel with the look of a program built with shaders/jfa_resolve.vert
+    void draw(const Shader &look) const;
+
+private:
+    Shader seedProgram;
+    Shader floodProgram;
+
+    int width, height;
+    // the nearest site of every pixel, 0 for none and i + 1 for site i, in two textures so a pass reads one and
+    // writes the other; the framebuffer of each texture, and the one with the result
+    unsigned int idTextures[2];
+    unsigned int framebuffers[2];
+    int current;
+
+    // the instance buffer of the cones as a texture, and a vertex array object without attributes, the shaders
+    // make their vertices from gl_VertexID
+    unsigned int siteTexture;
+    unsigned int emptyVAO;
+};
+
+#endif
@@ -2,35 +2,55 @@
 #include <GLFW/glfw3.h>
 
 #include <shader.h>
+#include <jumpflooding.h>
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <math.h>
 
-// structure to hold the info necessary to render an object
-struct SceneObject {
-    unsigned int VAO;           // vertex array object handle
-    unsigned int vertexCount;   // number of vertices in the object
-    float r, g, b;              // for object color
-    float x, y;                 // for position offset
+// structure to hold the info necessary to render the cones, one cone mesh drawn once per site
+struct ConeInstances {
+    unsigned int VAO;               // vertex array object handle, with the cone and the per site attributes
+    unsigned int vertexCount;       // number of vertices in the cone
+    unsigned int instanceVBO;       // offset (x, y) and color (r, g, b) of every site
+    unsigned int instanceCount;     // number of sites
+    unsigned int instanceCapacity;  // number of sites the instance buffer has room for
 };
 
+// the floats of a site in the instance buffer, offset and color
+const unsigned int siteFloats = 5;
+
+// the cones only have to reach the pixels nearest to their site. when every cell of a grid over the screen has a
+// site, no pixel is farther from its nearest site than the diagonal of a cell, so the cones are cut to that radius,
+// which is what keeps many sites from covering the whole screen many times. the grids have 1x1 to 512x512 cells
+const int coverageLevels = 10;
+std::vector<bool> coveredCells[coverageLevels];
+unsigned int coveredCount[coverageLevels];
+// the radius of the cones, 3 is larger than the screen
+float coneRadius = 3.0f;
+
 // declaration of the function you will implement in voronoi 1.1
-SceneObject instantiateCone(float r, float g, float b, float offsetX, float offsetY);
+ConeInstances instantiateCones();
+void addSites(const std::vector<float> &sites);
 // mouse, keyboard and screen reshape glfw callbacks
 void button_input_callback(GLFWwindow* window, int button, int action, int mods);
 void key_input_callback(GLFWwindow* window, int button, int other,int action, int mods);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void draw(SceneObject);
+void draw(const ConeInstances &cones);
 
 // settings
 const unsigned int SCR_WIDTH = 1200;
 const unsigned int SCR_HEIGHT = 900;
 
 // global variables we will use to store our objects, shaders, and active shader
-std::vector<SceneObject> sceneObjects;
+ConeInstances cones;
 std::vector<Shader> shaderPrograms;
 Shader* activeShader;
+// the same looks for the jump flooding mode, J switches between the cones and jump flooding
+std::vector<Shader> floodPrograms;
+JumpFlooding* jumpFlooding = nullptr;
+bool useJumpFlooding = false;
 
 int main()
 {
@@ -72,6 +92,15 @@ int main()
     shaderPrograms.push_back(Shader("shaders/shader.vert", "shaders/distance.frag"));
     shaderPrograms.push_back(Shader("shaders/shader.vert", "shaders/distance_color.frag"));
     activeShader = &shaderPrograms[0];
+    floodPrograms.push_back(Shader("shaders/jfa_resolve.vert", "shaders/color.frag"));
+    floodPrograms.push_back(Shader("shaders/jfa_resolve.vert", "shaders/distance.frag"));
+    floodPrograms.push_back(Shader("shaders/jfa_resolve.vert", "shaders/distance_color.frag"));
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    jumpFlooding = new JumpFlooding(framebufferWidth, framebufferHeight);
+
+    // the cone is made once, the sites only add an instance
+    cones = instantiateCones();
 
     // NEW!
     // set up the z-buffer
@@ -91,17 +120,22 @@ int main()
         glUseProgram(activeShader->ID);
 
         // TODO voronoi 1.3
-        // Iterate through the scene objects, for each object:
-        // - bind the VAO; set the uniform variables; and draw.
-        for(SceneObject s : sceneObjects){
-            draw(s);
+        // all the cones in one draw call, each with the offset and color of its site, or the same diagram with
+        // jump flooding, at a cost that depends on the pixels instead of the sites
+        if (useJumpFlooding) {
+            jumpFlooding->update(cones.instanceVBO, cones.instanceCount);
+            jumpFlooding->draw(floodPrograms[activeShader - &shaderPrograms[0]]);
         }
+        else
+            draw(cones);
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    delete jumpFlooding;
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     glfwTerminate();
     return 0;
@@ -116,55 +150,30 @@ void createArrayBuffer(const std::vector<float> &array, unsigned int &VBO){
     glBufferData(GL_ARRAY_BUFFER, array.size() * sizeof(GLfloat), &array[0], GL_STATIC_DRAW);
 }
 
-// creates a cone triangle mesh, uploads it to openGL and returns the VAO associated to the mesh
-SceneObject instantiateCone(float r, float g, float b, float offsetX, float offsetY){
+// creates a cone triangle mesh and an empty buffer for the sites, uploads them to openGL and returns the VAO
+// that draws one cone per site
+ConeInstances instantiateCones(){
     // TODO voronoi 1.1
     // (exercises 1.7 and 1.8 can help you with implementing this function)
+    ConeInstances instances{};
 
-    // Create an instance of a SceneObject,
-    SceneObject sceneObject{};
-
-    // you will need to store offsetX, offsetY, r, g and b in the object.
-    sceneObject.r = r;
-    sceneObject.g = g;
-    sceneObject.b = b;
-    sceneObject.x = offsetX;
-    sceneObject.y = offsetY;
-
-    // generate geometry in a vertex array object (VAO), record the number of vertices in the mesh,
-    // tells the shader how to read it
-    // Build the geometry into an std::vector<float> or float array.
+    // the cone as a triangle fan, the tip first and then the rim, the first point of the rim again at the end
     std::vector<float> positions;
 
     const int triangleCount = 360; // 360 for a full circle
     const float PI = 3.14159265;
     float angleInterval = (2*PI) / (float) triangleCount;
-    for (int i = 0; i < triangleCount; i++){
-        // vertex 1
-        positions.push_back(0.0f);
-        positions.push_back(0.0f);
-        positions.push_back(1.0f); // 1.0f to be above the other two points of the triangle.
-
-        // vertex 2
+    positions.push_back(0.0f);
+    positions.push_back(0.0f);
+    positions.push_back(1.0f); // 1.0f to be above the points of the rim.
+    for (int i = 0; i <= triangleCount; i++){
         positions.push_back(cos(i*angleInterval)*3); // times 3 to make it larger than the screen.
         positions.push_back(sin(i*angleInterval)*3);
         positions.push_back(0.0f);
-
-        // vertex 3
-        positions.push_back(cos((i+1)*angleInterval)*3);
-        positions.push_back(sin((i+1)*angleInterval)*3);
-        positions.push_back(0.0f);
     }
+    instances.vertexCount = positions.size()/3;
 
-    // Store the number of vertices in the mesh in the scene object.
-
-    unsigned int vertexCount = positions.size()/3;
-    sceneObject.vertexCount = vertexCount;
-
-    // Declare and generate a VAO and VBO (and an EBO if you decide the work with indices).
     unsigned int posVBO, VAO;
-
-    // Bind and set the VAO and VBO (and optionally a EBO) in the correct order.
     createArrayBuffer(positions, posVBO);
 
     glGenVertexArrays(1, &VAO);
@@ -177,24 +186,90 @@ SceneObject instantiateCone(float r, float g, float b, float offsetX, float offs
     glEnableVertexAttribArray(posAttributeLocation);
     glVertexAttribPointer(posAttributeLocation, posSize, GL_FLOAT, GL_FALSE, 0, 0);
 
-    // Store the VAO handle in the scene object.
-    sceneObject.VAO = VAO;
-    // 'return' the scene object for the cone instance you just created.
-    return sceneObject;
+    // the per site attributes advance once per cone instead of once per vertex
+    instances.instanceCapacity = 1024;
+    glGenBuffers(1, &instances.instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instances.instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instances.instanceCapacity * siteFloats * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+    GLsizei stride = siteFloats * sizeof(GLfloat);
+    int offsetAttributeLocation = glGetAttribLocation(activeShader->ID, "siteOffset");
+    glEnableVertexAttribArray(offsetAttributeLocation);
+    glVertexAttribPointer(offsetAttributeLocation, 2, GL_FLOAT, GL_FALSE, stride, 0);
+    glVertexAttribDivisor(offsetAttributeLocation, 1);
+    int colorAttributeLocation = glGetAttribLocation(activeShader->ID, "siteColor");
+    glEnableVertexAttribArray(colorAttributeLocation);
+    glVertexAttribPointer(colorAttributeLocation, 3, GL_FLOAT, GL_FALSE, stride, (void*) (2 * sizeof(GLfloat)));
+    glVertexAttribDivisor(colorAttributeLocation, 1);
+
+    instances.VAO = VAO;
+    return instances;
 }
 
-void draw(SceneObject s){
+// appends sites, siteFloats floats each, to the instance buffer; a full buffer is copied to one twice as large
+void addSites(const std::vector<float> &sites){
+    unsigned int count = sites.size() / siteFloats;
+    if (count == 0)
+        return;
+
+    if (cones.instanceCount + count > cones.instanceCapacity) {
+        unsigned int capacity = cones.instanceCapacity;
+        while (cones.instanceCount + count > capacity)
+            capacity *= 2;
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * siteFloats * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, cones.instanceVBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            cones.instanceCount * siteFloats * sizeof(GLfloat));
+        glDeleteBuffers(1, &cones.instanceVBO);
+        cones.instanceVBO = buffer;
+        cones.instanceCapacity = capacity;
+
+        // the attributes still point to the old buffer
+        GLsizei stride = siteFloats * sizeof(GLfloat);
+        glBindVertexArray(cones.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, cones.instanceVBO);
+        glVertexAttribPointer(glGetAttribLocation(shaderPrograms[0].ID, "siteOffset"), 2, GL_FLOAT, GL_FALSE,
+                              stride, 0);
+        glVertexAttribPointer(glGetAttribLocation(shaderPrograms[0].ID, "siteColor"), 3, GL_FLOAT, GL_FALSE,
+                              stride, (void*) (2 * sizeof(GLfloat)));
+        glBindVertexArray(0);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, cones.instanceVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, cones.instanceCount * siteFloats * sizeof(GLfloat),
+                    sites.size() * sizeof(GLfloat), &sites[0]);
+    cones.instanceCount += count;
+
+    // mark the cells of the sites on the screen, and cut the cones to the finest grid with a site in every cell
+    for (int level = 0; level < coverageLevels; level++) {
+        int cells = 1 << level;
+        coveredCells[level].resize(cells * cells);
+        for (unsigned int i = 0; i < count; i++) {
+            float x = sites[i * siteFloats], y = sites[i * siteFloats + 1];
+            if (x < -1.0f || x > 1.0f || y < -1.0f || y > 1.0f)
+                continue;
+            int cellX = std::min(cells - 1, (int) ((x + 1.0f) * 0.5f * cells));
+            int cellY = std::min(cells - 1, (int) ((y + 1.0f) * 0.5f * cells));
+            if (!coveredCells[level][cellY * cells + cellX]) {
+                coveredCells[level][cellY * cells + cellX] = true;
+                coveredCount[level]++;
+            }
+        }
+        if (coveredCount[level] == (unsigned int) (cells * cells))
+            coneRadius = std::min(3.0f, 2.0f * sqrtf(2.0f) / cells);
+    }
+}
+
+void draw(const ConeInstances &instances){
     // set active shader program
     glUseProgram(activeShader->ID);
-    // update uniforms
-    int offsetLocation = glGetUniformLocation(activeShader->ID, "offset");
-    glUniform2f(offsetLocation, s.x, s.y);
-    int vertexColorLocation = glGetUniformLocation(activeShader->ID, "aColor");
-    glUniform3f(vertexColorLocation, s.r, s.g, s.b);
+    glUniform1f(glGetUniformLocation(activeShader->ID, "coneRadius"), coneRadius);
     // bind vertex array object
-    glBindVertexArray(s.VAO);
-    // draw geometry
-    glDrawArrays(GL_TRIANGLES, 0, s.vertexCount);
+    glBindVertexArray(instances.VAO);
+    // draw geometry, the whole cone once per site
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, instances.vertexCount, instances.instanceCount);
 }
 
 // glfw: called whenever a mouse button is pressed
@@ -205,8 +280,7 @@ void button_input_callback(GLFWwindow* window, int button, int action, int mods)
     // Test button press, see documentation at:
     //     https://www.glfw.org/docs/latest/input_guide.html#input_mouse_button
     // CODE HERE
-    // If a left mouse button press was detected, call instantiateCone:
-    // - Push the return value to the back of the global 'vector<SceneObject> sceneObjects'.
+    // If a left mouse button press was detected, call addSites:
     // - The click position should be transformed from screen coordinates to normalized device coordinates,
     //   to obtain the offset values that describe the position of the object in the screen plane.
     // - A random value in the range [0, 1] should be used for the r, g and b variables.
@@ -226,8 +300,8 @@ void button_input_callback(GLFWwindow* window, int button, int action, int mods)
         float g = ((float) rand()) / (float) RAND_MAX;
         float b = ((float) rand()) / (float) RAND_MAX;
 
-        // create cone with color and position and add it to scene objects
-        sceneObjects.push_back(instantiateCone(r, g, b, X_ndc, Y_ndc));
+        // add a cone with color and position
+        addSites({X_ndc, Y_ndc, r, g, b});
     }
 }
 
@@ -246,6 +320,22 @@ void key_input_callback(GLFWwindow* window, int button, int other,int action, in
         activeShader = &shaderPrograms[1];
     else if (button == GLFW_KEY_3 && action == GLFW_PRESS)
         activeShader = &shaderPrograms[2];
+
+    if (button == GLFW_KEY_J && action == GLFW_PRESS)
+        useJumpFlooding = !useJumpFlooding;
+
+    // R adds 10000 random sites at once
+    if (button == GLFW_KEY_R && action == GLFW_PRESS) {
+        std::vector<float> sites;
+        for (int i = 0; i < 10000; i++) {
+            sites.push_back(((float) rand()) / (float) RAND_MAX * 2.0f - 1.0f);
+            sites.push_back(((float) rand()) / (float) RAND_MAX * 2.0f - 1.0f);
+            sites.push_back(((float) rand()) / (float) RAND_MAX);
+            sites.push_back(((float) rand()) / (float) RAND_MAX);
+            sites.push_back(((float) rand()) / (float) RAND_MAX);
+        }
+        addSites(sites);
+    }
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -254,4 +344,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    // the jump flooding has one pixel per pixel of the screen
+    if (jumpFlooding)
+        jumpFlooding->resize(width, height);
 }
\ No newline at end of file
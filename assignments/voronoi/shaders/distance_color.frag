@@ -6,8 +6,8 @@ out vec4 fragColor;
 // Create an 'in float' variable to receive the depth value from the vertex shader,
 // the variable must have the same name as the 'out variable' in the vertex shader.
 in float zValue;
-// Create a 'uniform vec3' to receive the cone color from your application.
-uniform vec3 aColor;
+// The cone color, from the site of the cone in the vertex shader.
+in vec3 aColor;
 
 
 void main()
@@ -0,0 +1,40 @@
+#version 330 core
+// FRAGMENT SHADER
+
+// Jump flooding, flood: every pixel takes the nearest of the sites of the pixel itself and of the 8 pixels at a
+// distance of 'step' around it.
+// The nearest site of every pixel so far, 0 is no site and site i is i + 1.
+uniform usampler2D nearest;
+// The offset (x, y) and color (r, g, b) of every site, 5 floats each.
+uniform samplerBuffer sites;
+uniform int step;
+out uint nearestId;
+
+void main()
+{
+    ivec2 size = textureSize(nearest, 0);
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    // the distances are measured in normalized device coordinates, as the cones do
+    vec2 position = gl_FragCoord.xy / vec2(size) * 2.0 - 1.0;
+
+    uint best = 0u;
+    float bestDistance = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            ivec2 other = pixel + ivec2(x, y) * step;
+            if (any(lessThan(other, ivec2(0))) || any(greaterThanEqual(other, size)))
+                continue;
+            uint id = texelFetch(nearest, other, 0).r;
+            if (id == 0u)
+                continue;
+            int site = int(id - 1u) * 5;
+            vec2 offset = vec2(texelFetch(sites, site).r, texelFetch(sites, site + 1).r) - position;
+            float distance = dot(offset, offset);
+            if (best == 0u || distance < bestDistance) {
+                best = id;
+                bestDistance = distance;
+            }
+        }
+    }
+    nearestId = best;
+}
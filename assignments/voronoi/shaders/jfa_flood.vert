@@ -0,0 +1,10 @@
+#version 330 core
+// VERTEX SHADER
+
+// Jump flooding, flood: one triangle larger than the screen, so every pixel runs the fragment shader once.
+
+void main()
+{
+    vec2 corner = vec2((gl_VertexID & 1) * 4 - 1, (gl_VertexID & 2) * 2 - 1);
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 330 core
+// VERTEX SHADER
+
+// Jump flooding, shading: one point per pixel, with the color of its nearest site and the depth of the cone of
+// that site at the pixel, so the fragment shaders of the cones give the same looks.
+// The nearest site of every pixel, 0 is no site and site i is i + 1.
+uniform usampler2D nearest;
+// The offset (x, y) and color (r, g, b) of every site, 5 floats each.
+uniform samplerBuffer sites;
+out float zValue;
+out vec3 aColor;
+
+void main()
+{
+    ivec2 size = textureSize(nearest, 0);
+    ivec2 pixel = ivec2(gl_VertexID % size.x, gl_VertexID / size.x);
+    uint id = texelFetch(nearest, pixel, 0).r;
+    if (id == 0u) {
+        // no site yet, the point is put outside of the screen, which leaves the background
+        gl_Position = vec4(2.0, 2.0, 0.0, 1.0);
+        zValue = 0.0;
+        aColor = vec3(0.0);
+        return;
+    }
+
+    vec2 position = (vec2(pixel) + 0.5) / vec2(size) * 2.0 - 1.0;
+    gl_Position = vec4(position, 0.0, 1.0);
+
+    // the cones fall from 1 at the site by 1 every 3 units
+    int site = int(id - 1u) * 5;
+    vec2 offset = vec2(texelFetch(sites, site).r, texelFetch(sites, site + 1).r);
+    zValue = 1.0 - distance(position, offset) / 3.0;
+    aColor = vec3(texelFetch(sites, site + 2).r, texelFetch(sites, site + 3).r, texelFetch(sites, site + 4).r);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+// FRAGMENT SHADER
+
+// Jump flooding, seed: the pixel of a site gets its id.
+flat in uint siteId;
+out uint nearestId;
+
+void main()
+{
+    nearestId = siteId;
+}
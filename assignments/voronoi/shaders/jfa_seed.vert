@@ -0,0 +1,15 @@
+#version 330 core
+// VERTEX SHADER
+
+// Jump flooding, seed: one point per site, in the pixel of the site, with its id.
+// The offset (x, y) and color (r, g, b) of every site, 5 floats each.
+uniform samplerBuffer sites;
+// The id of the site, site i is i + 1 since 0 is no site.
+flat out uint siteId;
+
+void main()
+{
+    int site = gl_VertexID * 5;
+    gl_Position = vec4(texelFetch(sites, site).r, texelFetch(sites, site + 1).r, 0.0, 1.0);
+    siteId = uint(gl_VertexID + 1);
+}
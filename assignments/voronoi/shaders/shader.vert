@@ -4,11 +4,16 @@
 // TODO voronoi 1.3
 // Receives position in 'vec3', the position variable has attribute 'location = 0'
 layout (location = 0) in vec3 aPos;
+// The offset and the color of the site of the cone, the same for all the vertices of a cone
+layout (location = 1) in vec2 siteOffset;
+layout (location = 2) in vec3 siteColor;
 // You have to declare an 'out float' to send the z-coordinate of the position
 // to the fragment shader (voronoi 1.4 and 1.5)
 out float zValue;
-// You have to set an 'uniform vec2' to receive the position offset of the object
-uniform vec2 offset;
+// The cone color, for the fragment shader
+out vec3 aColor;
+// The radius the cones are cut to, the mesh has radius 3
+uniform float coneRadius;
 
 void main()
 {
@@ -16,8 +21,12 @@ void main()
     // Set the vertex->fragment shader 'out' variable
     // CODE HERE
     // Set the 'gl_Position' built-in variable using a 'vec4(vec3 position you compute, 1.0)',
-    // Remeber to use the 'uniform vec2' to move the vertex before you set 'gl_Position'.
+    // Remeber to use the site offset to move the vertex before you set 'gl_Position'.
 
-    gl_Position = vec4(vec3((aPos.x + offset.x), (aPos.y + offset.y), aPos.z), 1.0);
-    zValue = aPos.z;
+    // A smaller cone is the tip of the mesh, with the same slope, so the depth is the same function of the distance
+    float cut = coneRadius / 3.0;
+    vec3 position = vec3(aPos.xy * cut, 1.0 - (1.0 - aPos.z) * cut);
+    gl_Position = vec4(vec3((position.x + siteOffset.x), (position.y + siteOffset.y), position.z), 1.0);
+    zValue = position.z;
+    aColor = siteColor;
 }
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "collider.h"
+
+#include <limits>
+
+
+/*
+ * \class PlaneCollider
+ * Everything below a plane
+ */
+
+/*
+ * Parameterized constructor
+ * \param point - a point of the plane
+ * \param normal - the direction out of the solid side
+ */
+PlaneCollider::PlaneCollider(const glm::vec3 &point, const glm::vec3 &normal) : point(point),
+                                                                              normal(glm::normalize(normal))
+{}
+
+/*
+ * Returns true if a position is below the plane
+ */
+bool PlaneCollider::contains(const glm::vec3 &position) const
+{
+    return glm::dot(position - this->point, this->normal) < 0.f;
+}
+
+/*
+ * Returns a point of the plane, which has no bounding sphere
+ */
+glm::vec3 PlaneCollider::boundingCenter() const
+{
+    return this->point;
+}
+
+/*
+ * Returns infinity, the plane has no bounding sphere
+ */
+float PlaneCollider::boundingRadius() const
+{
+    return std::numeric_limits<float>::infinity();
+}
+
+/*
+ * \class BoxCollider
+ * A box moved, rotated and scaled by a model matrix
+ */
+
+/*
+ * Parameterized constructor
+ * \param model - the model matrix of the box, without shear
+ * \param halfSize - half the size of the box along each of its axes, before the model matrix
+ */
+BoxCollider::BoxCollider(const glm::mat4 &model, const glm::vec3 &halfSize) : model(model),
+                                                                             inverseModel(glm::inverse(model)),
+                                                                             halfSize(halfSize)
+{}
+
+/*
+ * Returns true if a position is inside the box
+ */
+bool BoxCollider::contains(const glm::vec3 &position) const
+{
+    glm::vec3 local = glm::vec3(this->inverseModel * glm::vec4(position, 1.f));
+    return glm::all(glm::lessThan(glm::abs(local), this->halfSize));
+}
+
+/*
+ * Returns the center of the box
+ */
+glm::vec3 BoxCollider::boundingCenter() const
+{
+    return glm::vec3(this->model[3]);
+}
+
+/*
+ * Returns the distance from the center of the box to its corners
+ */
+float BoxCollider::boundingRadius() const
+{
+    glm::vec3 extent;
+    for (int a = 0; a < 3; a++) {
+        extent[a] = this->halfSize[a] * glm::length(glm::vec3(this->model[a]));
+    }
+    return glm::length(extent);
+}
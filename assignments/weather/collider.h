@@ -0,0 +1,79 @@
+#ifndef __COLLIDER_H__
+#define __COLLIDER_H__
+
+/**
+ * \file collider.h
+ */
+
+#include <glm/glm.hpp>
+
+/**
+ * \class Collider
+ * A solid shape of the scene that particles can not go into
+ */
+class Collider {
+public:
+    virtual ~Collider() = default;
+
+    /**
+     * Returns true if a position is inside the shape
+     */
+    virtual bool contains(const glm::vec3 &position) const = 0;
+
+    /**
+     * Returns the center of a sphere around the shape, to find the particles near it
+     */
+    virtual glm::vec3 boundingCenter() const = 0;
+
+    /**
+     * Returns the radius of a sphere around the shape, infinite if the shape is unbounded
+     */
+    virtual float boundingRadius() const = 0;
+};
+
+/**
+ * \class PlaneCollider
+ * Everything below a plane, like the floor
+ */
+class PlaneCollider : public Collider {
+public:
+    /**
+     * Parameterized constructor
+     * \param point - a point of the plane
+     * \param normal - the direction out of the solid side
+     */
+    PlaneCollider(const glm::vec3 &point, const glm::vec3 &normal);
+
+    bool contains(const glm::vec3 &position) const override;
+    glm::vec3 boundingCenter() const override;
+    float boundingRadius() const override;
+
+private:
+    glm::vec3 point;
+    glm::vec3 normal;
+};
+
+/**
+ * \class BoxCollider
+ * A box moved, rotated and scaled by a model matrix, like the cubes of the scene
+ */
+class BoxCollider : public Collider {
+public:
+    /**
+     * Parameterized constructor
+     * \param model - the model matrix of the box, without shear
+     * \param halfSize - half the size of the box along each of its axes, before the model matrix
+     */
+    explicit BoxCollider(const glm::mat4 &model, const glm::vec3 &halfSize = glm::vec3(1.f));
+
+    bool contains(const glm::vec3 &position) const override;
+    glm::vec3 boundingCenter() const override;
+    float boundingRadius() const override;
+
+private:
+    glm::mat4 model;
+    glm::mat4 inverseModel;
+    glm::vec3 halfSize;
+};
+
+#endif
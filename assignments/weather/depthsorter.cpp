@@ -0,0 +1,236 @@
+#include "depthsorter.h"
+
+#include <algorithm>
+
+
+// the radix sort runs on one thread below this many particles, waking the threads up would cost more than it saves
+static const size_t parallelThreshold = 1 << 16;
+// after the order of the last frame was too far off, it is not tried again for this many frames
+static const unsigned int retryFrames = 8;
+
+/*
+ * \class DepthSorter
+ * Sorts particles back to front with 16 bit keys, incrementally when the order barely changed.
+ */
+
+/*
+ * Parameterized constructor creates an empty sorter
+ * \param threadCount - the number of threads of the radix sort, 0 uses one per hardware thread
+ */
+DepthSorter::DepthSorter(unsigned int threadCount) : threadCount(threadCount), incremental(false), retryIn(0),
+                                                     job(nullptr), generation(0), running(0), stopping(false)
+{
+    if (this->threadCount == 0) {
+        this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+/*
+ * Destructor stops the threads
+ */
+DepthSorter::~DepthSorter()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->stopping = true;
+    }
+    this->wakeUp.notify_all();
+    for (auto &worker : this->workers) {
+        worker.join();
+    }
+}
+
+/*
+ * Sorts the particles, farthest first
+ * \param depths - the depth of each particle along the view direction, larger is farther
+ * \return the indices of the particles, in drawing order
+ */
+const std::vector<unsigned int> &DepthSorter::sort(const std::vector<float> &depths)
+{
+    size_t count = depths.size();
+    float nearest = 0.f, farthest = 0.f;
+    if (count > 0) {
+        auto range = std::minmax_element(depths.begin(), depths.end());
+        nearest = *range.first;
+        farthest = *range.second;
+    }
+
+    // the keys span the depths of this frame, the farthest particle gets key 0
+    float scale = farthest > nearest ? 65535.f / (farthest - nearest) : 0.f;
+    this->keys.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        this->keys[i] = (unsigned short) ((farthest - depths[i]) * scale);
+    }
+
+    // the order of the last frame is only worth fixing if few of its neighbours swapped, and a new set of
+    // particles has no order to start from
+    this->incremental = false;
+    if (this->order.size() == count && this->retryIn == 0) {
+        size_t swapped = 0;
+        for (size_t i = 1; i < count; i++) {
+            swapped += this->keys[this->order[i - 1]] > this->keys[this->order[i]] ? 1 : 0;
+        }
+        // the insertion sort gives up after about as much work as the radix sort does
+        this->incremental = swapped <= count / 64 && this->insertionSort(count * 2);
+        this->retryIn = this->incremental ? 0 : retryFrames;
+    } else if (this->retryIn > 0) {
+        this->retryIn--;
+    }
+    if (!this->incremental) {
+        this->radixSort();
+    }
+    return this->order;
+}
+
+/*
+ * Returns true if the last sort only had to fix the order of the frame before with the insertion sort
+ */
+bool DepthSorter::wasIncremental() const
+{
+    return this->incremental;
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * Fixes the order of the last sort with an insertion sort
+ * \param maxMoves - the number of moves to give up after
+ * \return true if the order is sorted, false if it gave up
+ */
+bool DepthSorter::insertionSort(size_t maxMoves)
+{
+    size_t moves = 0;
+    for (size_t i = 1; i < this->order.size(); i++) {
+        unsigned int particle = this->order[i];
+        unsigned short key = this->keys[particle];
+        size_t j = i;
+        while (j > 0 && this->keys[this->order[j - 1]] > key) {
+            this->order[j] = this->order[j - 1];
+            j--;
+        }
+        this->order[j] = particle;
+        moves += i - j;
+        if (moves > maxMoves) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Sorts the particles with a radix sort, whatever the order was
+ */
+void DepthSorter::radixSort()
+{
+    // the keys go with the particles, so the passes read and write sequentially instead of looking the keys up
+    size_t count = this->keys.size();
+    this->pairs.resize(count);
+    this->scratch.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        this->pairs[i] = ((unsigned long long) this->keys[i] << 32) | i;
+    }
+
+    unsigned int threads = count < parallelThreshold ? 1 : this->threadCount;
+    size_t block = (count + threads - 1) / threads;
+    std::vector<size_t> histograms(threads * 256);
+
+    // each thread takes a contiguous block, and the blocks keep their order in every bucket, so the sort is stable
+
+    for (int shift = 32; shift < 48; shift += 8) {
+        const std::vector<unsigned long long> &from = this->pairs;
+        std::vector<unsigned long long> &to = this->scratch;
+
+        std::fill(histograms.begin(), histograms.end(), 0);
+        this->runOnThreads(threads, [&](unsigned int t) {
+            size_t *histogram = &histograms[t * 256];
+            size_t end = std::min(count, (t + 1) * block);
+            for (size_t i = t * block; i < end; i++) {
+                histogram[(from[i] >> shift) & 255]++;
+            }
+        });
+
+        // bucket by bucket, and thread by thread inside a bucket
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            for (unsigned int t = 0; t < threads; t++) {
+                size_t bucket = histograms[t * 256 + digit];
+                histograms[t * 256 + digit] = offset;
+                offset += bucket;
+            }
+        }
+
+        this->runOnThreads(threads, [&](unsigned int t) {
+            size_t *next = &histograms[t * 256];
+            size_t end = std::min(count, (t + 1) * block);
+            for (size_t i = t * block; i < end; i++) {
+                to[next[(from[i] >> shift) & 255]++] = from[i];
+            }
+        });
+        this->pairs.swap(this->scratch);
+    }
+
+    this->order.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        this->order[i] = (unsigned int) this->pairs[i];
+    }
+}
+
+/*
+ * Runs a job on a number of threads, job(t) on thread t, the calling thread is thread 0, and returns when all of
+ * them are done
+ */
+void DepthSorter::runOnThreads(unsigned int threads, const std::function<void(unsigned int)> &job)
+{
+    if (threads <= 1) {
+        job(0);
+        return;
+    }
+    // the threads are started once, by the first sort with enough particles
+    if (this->workers.empty()) {
+        for (unsigned int t = 1; t < this->threadCount; t++) {
+            this->workers.emplace_back(&DepthSorter::workerLoop, this, t);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->job = &job;
+        this->running = (unsigned int) this->workers.size();
+        this->generation++;
+    }
+    this->wakeUp.notify_all();
+    job(0);
+
+    // job must outlive the workers still running it
+    std::unique_lock<std::mutex> guard(this->lock);
+    this->done.wait(guard, [this]() { return this->running == 0; });
+    this->job = nullptr;
+}
+
+/*
+ * The loop of a worker thread, which runs the jobs of runOnThreads() as thread index
+ */
+void DepthSorter::workerLoop(unsigned int index)
+{
+    unsigned long long seen = 0;
+    while (true) {
+        const std::function<void(unsigned int)> *current;
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->wakeUp.wait(guard, [this, seen]() { return this->stopping || this->generation != seen; });
+            if (this->stopping) {
+                return;
+            }
+            seen = this->generation;
+            current = this->job;
+        }
+        (*current)(index);
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->running--;
+        }
+        this->done.notify_one();
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef __DEPTH_SORTER_H__
+#define __DEPTH_SORTER_H__
+
+/**
+ * \file depthsorter.h
+ */
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \class DepthSorter
+ * Sorts particles back to front by their depth along the view direction, so alpha blended particles are drawn
+ * in the same, correct order every frame instead of in the order of the vertex buffer.
+ *
+ * The depths are quantized to 16 bit keys and sorted with a least significant digit radix sort, two passes of
+ * 8 bits, each one split over a few threads when there are many particles. The threads are started by the first
+ * sort that needs them and wait for the next passes, so a sort does not start any. The particles move little from
+ * one frame to the next, so the order of the last frame is tried first: an insertion sort fixes it in one pass when
+ * only a few particles moved out of place, and gives up for the radix sort when too many did, for a few frames.
+ */
+class DepthSorter {
+public:
+    /**
+     * Parameterized constructor creates an empty sorter
+     * \param threadCount - the number of threads of the radix sort, 0 uses one per hardware thread
+     */
+    explicit DepthSorter(unsigned int threadCount = 0);
+
+    /**
+     * Destructor stops the threads
+     */
+    ~DepthSorter();
+
+    /**
+     * Sorts the particles, farthest first
+     * \param depths - the depth of each particle along the view direction, larger is farther
+     * \return the indices of the particles, in drawing order
+     */
+    const std::vector<unsigned int> &sort(const std::vector<float> &depths);
+
+    /**
+     * Returns true if the last sort only had to fix the order of the frame before with the insertion sort
+     */
+    bool wasIncremental() const;
+
+private:
+    /**
+     * Fixes the order of the last sort with an insertion sort
+     * \param maxMoves - the number of moves to give up after
+     * \return true if the order is sorted, false if it gave up
+     */
+    bool insertionSort(std::size_t maxMoves);
+
+    /**
+     * Sorts the particles with a radix sort, whatever the order was
+     */
+    void radixSort();
+
+    /**
+     * Runs a job on a number of threads, job(t) on thread t, the calling thread is thread 0, and returns when all of
+     * them are done
+     */
+    void runOnThreads(unsigned int threads, const std::function<void(unsigned int)> &job);
+
+    /**
+     * The loop of a worker thread, which runs the jobs of runOnThreads() as thread index
+     */
+    void workerLoop(unsigned int index);
+
+    unsigned int threadCount;
+    bool incremental;
+    // the frames left before the order of the last frame is tried again
+    unsigned int retryIn;
+
+    /**
+     * The key of each particle, 0 is the farthest, and the particles in drawing order
+     */
+    std::vector<unsigned short> keys;
+    std::vector<unsigned int> order;
+
+    /**
+     * The keys of the radix sort, shifted up by 32 bits, each one with its particle in the low bits
+     */
+    std::vector<unsigned long long> pairs;
+    std::vector<unsigned long long> scratch;
+
+    /**
+     * The worker threads, threads 1 to threadCount - 1, and the job they run, which changes with the generation
+     */
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wakeUp;
+    std::condition_variable done;
+    const std::function<void(unsigned int)> *job;
+    unsigned long long generation;
+    unsigned int running;
+    bool stopping;
+};
+
+#endif
@@ -7,6 +7,9 @@
 
 #include "shader.h"
 #include "glmutils.h"
+#include "depthsorter.h"
+#include "spatialhash.h"
+#include "collider.h"
 
 #include "plane_model.h"
 #include "primitives.h"
@@ -48,6 +51,9 @@ void drawCube(glm::mat4 model);
 void drawPlane(glm::mat4 model);
 void createRainLines(int amount);
 void drawRainLines();
+void placeRainLines(vec3 offset);
+void collideRainLines();
+void sortRainLines();
 
 // screen settings
 // ---------------
@@ -83,6 +89,19 @@ vector<float> rainColors{};
 vector<unsigned int> rainIndices{};
 vector<Line> lines;
 
+// the rain is blended, so the lines are drawn back to front, in the order of the index buffer
+DepthSorter rainSorter;
+vector<float> rainDepths;
+vector<unsigned int> sortedRainIndices;
+int rainIndexBuffer;
+
+// where the lines are this frame, hashed to find the ones near the solid parts of the scene, which are not drawn
+vector<vec3> rainPositions;
+vector<char> rainHidden;
+SpatialHash rainHash(1.0f);
+vector<mat4> cubeModels;
+vector<Collider*> colliders;
+
 // global variables used for control
 // ---------------------------------
 float currentTime;
@@ -192,6 +211,8 @@ int main()
     }
 
     delete shaderProgram;
+    for (Collider *collider : colliders)
+        delete collider;
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -219,8 +240,8 @@ void drawObjects(){
 
     // draw 2 cubes and 2 planes in different locations and with different orientations
 
-    drawCube(viewProjection * glm::translate(2.0f, 1.f, 2.0f) * glm::rotateY(glm::half_pi<float>()) * scale);
-    drawCube(viewProjection * glm::translate(-2.0f, 1.f, -2.0f) * glm::rotateY(glm::quarter_pi<float>()) * scale);
+    for (const mat4 &cubeModel : cubeModels)
+        drawCube(viewProjection * cubeModel * scale);
 
     drawPlane(viewProjection * glm::translate(-2.0f, .5f, 2.0f) * glm::rotateX(glm::quarter_pi<float>()) * scale);
     drawPlane(viewProjection * glm::translate(2.0f, .5f, -2.0f) * glm::rotateX(glm::quarter_pi<float>() * 3.f) * scale);
@@ -259,10 +280,63 @@ void drawRainLines(){
     rainShader->setFloat("boxSize", boxSize);
     rainShader->setFloat("motionBlurMultiplier", motionBlur); // reduce hyper-space effect
 
+    placeRainLines(offset);
+    collideRainLines();
+    sortRainLines();
     rain.drawLineObject();
     prevModel = viewProjection;
 }
 
+// places the lines where rain.vert does, at the bottom of each line
+void placeRainLines(vec3 offset){
+    rainPositions.resize(lines.size());
+    vec3 boxCorner = camPosition + camForward - vec3(boxSize/2);
+    for (size_t i = 0; i < lines.size(); i++)
+        rainPositions[i] = mod(lines[i].getOffset() + offset, vec3(boxSize)) + boxCorner;
+}
+
+// hides the lines inside the colliders, only the lines the hash finds near a collider are tested against it
+void collideRainLines(){
+    rainHash.build(rainPositions);
+    rainHidden.assign(rainPositions.size(), 0);
+    vector<unsigned int> nearby;
+    for (const Collider *collider : colliders) {
+        if (std::isinf(collider->boundingRadius())) {
+            for (size_t i = 0; i < rainPositions.size(); i++)
+                rainHidden[i] |= collider->contains(rainPositions[i]) ? 1 : 0;
+            continue;
+        }
+        rainHash.query(collider->boundingCenter(), collider->boundingRadius(), nearby);
+        for (unsigned int i : nearby)
+            rainHidden[i] |= collider->contains(rainPositions[i]) ? 1 : 0;
+    }
+}
+
+// sorts the lines by their distance along the view direction, and writes the indices of the lines not hidden, sorted,
+// to the index buffer of the rain
+void sortRainLines(){
+    rainDepths.resize(rainPositions.size());
+    for (size_t i = 0; i < rainPositions.size(); i++)
+        rainDepths[i] = dot(rainPositions[i] - camPosition, camForward);
+
+    // all the lines are sorted, so the order of the last frame is still close when lines are hidden or shown
+    const vector<unsigned int> &order = rainSorter.sort(rainDepths);
+    sortedRainIndices.clear();
+    for (unsigned int line : order) {
+        if (rainHidden[line])
+            continue;
+        sortedRainIndices.push_back(line * 2);
+        sortedRainIndices.push_back(line * 2 + 1);
+    }
+    rain.vertexCount = sortedRainIndices.size();
+    // a new store every frame, so the driver does not wait for the draw of the last frame to finish with the old one.
+    // the element array binding belongs to the vertex array object, the one of the rain has to be bound first
+    glBindVertexArray(rain.VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rainIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sortedRainIndices.size() * sizeof(unsigned int),
+                 sortedRainIndices.data(), GL_STREAM_DRAW);
+}
+
 void createRainLines(int amount){
     for(int i = 0; i < amount; i++){
         glm::vec3 offset = vec3(
@@ -357,6 +431,15 @@ void setup(){
     // rain :-)
     rain.VAO = createVertexArray(rainVertices, rainColors, rainIndices, rainShader);
     rain.vertexCount = rainIndices.size();
+    // the index buffer the vertex array object was left with, rewritten in sorted order every frame
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &rainIndexBuffer);
+
+    // the floor and the cubes are solid, the half size of the cube is 1
+    cubeModels.push_back(glm::translate(2.0f, 1.f, 2.0f) * glm::rotateY(glm::half_pi<float>()));
+    cubeModels.push_back(glm::translate(-2.0f, 1.f, -2.0f) * glm::rotateY(glm::quarter_pi<float>()));
+    colliders.push_back(new PlaneCollider(vec3(0.f), vec3(0.f, 1.f, 0.f)));
+    for (const mat4 &cubeModel : cubeModels)
+        colliders.push_back(new BoxCollider(cubeModel));
 
 }
 
@@ -0,0 +1,147 @@
+#include "spatialhash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+/*
+ * \class SpatialHash
+ * Sorts particles into hashed cells with a counting sort, for queries that only read the cells nearby.
+ */
+
+/*
+ * Parameterized constructor creates an empty hash
+ * \param cellSize - the size of the cells, about the radius of the usual query
+ * \param bucketCount - the number of buckets, rounded up to a power of 2
+ */
+SpatialHash::SpatialHash(float cellSize, std::size_t bucketCount) : cellSize(cellSize)
+{
+    if (!(cellSize > 0.f)) {
+        throw std::runtime_error("SpatialHash::SpatialHash(): The cell size must be positive");
+    }
+    std::size_t buckets = 1;
+    while (buckets < bucketCount) {
+        buckets *= 2;
+    }
+    this->mask = buckets - 1;
+    this->bucketStart.assign(buckets + 1, 0);
+}
+
+/*
+ * Sorts the particles into the buckets, replacing the ones before
+ * \param positions - the position of each particle
+ */
+void SpatialHash::build(const std::vector<glm::vec3> &positions)
+{
+    std::size_t count = positions.size();
+    this->buckets.resize(count);
+    this->x.resize(count);
+    this->y.resize(count);
+    this->z.resize(count);
+    this->particles.resize(count);
+
+    // count the particles of each bucket, shifted by one so the sums below give the first slot of each bucket
+    std::fill(this->bucketStart.begin(), this->bucketStart.end(), 0);
+    for (std::size_t i = 0; i < count; i++) {
+        this->buckets[i] = (unsigned int) this->bucketOf(this->cellOf(positions[i]));
+        this->bucketStart[this->buckets[i] + 1]++;
+    }
+    for (std::size_t b = 1; b < this->bucketStart.size(); b++) {
+        this->bucketStart[b] += this->bucketStart[b - 1];
+    }
+
+    // then every particle goes to the next free slot of its bucket, which leaves bucketStart one bucket ahead
+    for (std::size_t i = 0; i < count; i++) {
+        unsigned int slot = this->bucketStart[this->buckets[i]]++;
+        this->x[slot] = positions[i].x;
+        this->y[slot] = positions[i].y;
+        this->z[slot] = positions[i].z;
+        this->particles[slot] = (unsigned int) i;
+    }
+    for (std::size_t b = this->bucketStart.size() - 1; b > 0; b--) {
+        this->bucketStart[b] = this->bucketStart[b - 1];
+    }
+    this->bucketStart[0] = 0;
+}
+
+/*
+ * Finds the particles within a distance of a point
+ * \param center - the center of the sphere
+ * \param radius - the radius of the sphere
+ * \param found - gets the indices of the particles in the sphere, in no particular order
+ * \return the number of particles found
+ */
+std::size_t SpatialHash::query(const glm::vec3 &center, float radius, std::vector<unsigned int> &found)
+{
+    found.clear();
+    glm::ivec3 low = this->cellOf(center - glm::vec3(radius));
+    glm::ivec3 high = this->cellOf(center + glm::vec3(radius));
+    double cells = double(high.x - low.x + 1) * double(high.y - low.y + 1) * double(high.z - low.z + 1);
+    std::size_t bucketCount = this->mask + 1;
+
+    // a few cells can hash to the same bucket, which is read once; a sphere over more cells than there are
+    // buckets reads all of them
+    std::vector<std::size_t> &visit = this->visit;
+    visit.clear();
+    if (cells >= (double) bucketCount) {
+        for (std::size_t b = 0; b < bucketCount; b++) {
+            visit.push_back(b);
+        }
+    } else {
+        for (int i = low.x; i <= high.x; i++) {
+            for (int j = low.y; j <= high.y; j++) {
+                for (int k = low.z; k <= high.z; k++) {
+                    visit.push_back(this->bucketOf(glm::ivec3(i, j, k)));
+                }
+            }
+        }
+        std::sort(visit.begin(), visit.end());
+        visit.erase(std::unique(visit.begin(), visit.end()), visit.end());
+    }
+
+    // the buckets hold the particles of other cells too, the distance leaves them out
+    float radiusSquared = radius * radius;
+    for (std::size_t bucket : visit) {
+        for (unsigned int slot = this->bucketStart[bucket]; slot < this->bucketStart[bucket + 1]; slot++) {
+            float dx = this->x[slot] - center.x;
+            float dy = this->y[slot] - center.y;
+            float dz = this->z[slot] - center.z;
+            if (dx * dx + dy * dy + dz * dz <= radiusSquared) {
+                found.push_back(this->particles[slot]);
+            }
+        }
+    }
+    return found.size();
+}
+
+/*
+ * Returns the number of particles in the hash
+ */
+std::size_t SpatialHash::size() const
+{
+    return this->particles.size();
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * Returns the cell of a position
+ */
+glm::ivec3 SpatialHash::cellOf(const glm::vec3 &position) const
+{
+    return glm::ivec3(glm::floor(position / this->cellSize));
+}
+
+/*
+ * Returns the bucket of a cell
+ */
+std::size_t SpatialHash::bucketOf(const glm::ivec3 &cell) const
+{
+    // large primes, so the cells next to each other land in buckets far apart
+    unsigned int hash = ((unsigned int) cell.x * 73856093u) ^ ((unsigned int) cell.y * 19349663u)
+                        ^ ((unsigned int) cell.z * 83492791u);
+    return hash & this->mask;
+}
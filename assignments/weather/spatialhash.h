@@ -0,0 +1,90 @@
+#ifndef __SPATIAL_HASH_H__
+#define __SPATIAL_HASH_H__
+
+/**
+ * \file spatialhash.h
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+ * \class SpatialHash
+ * Finds the particles near a point without testing all of them, for collisions between particles and with the scene.
+ *
+ * Space is divided into cubic cells, and each cell is hashed to one of a fixed number of buckets, so the particles can
+ * be anywhere. The hash is rebuilt every frame with a counting sort: the particles are counted per bucket, the counts
+ * become the first slot of each bucket, and the positions are copied to arrays sorted by bucket, one array per
+ * coordinate. A query only reads the buckets of the cells the sphere overlaps, so its cost depends on the particles
+ * nearby rather than on all particles.
+ */
+class SpatialHash {
+public:
+    /**
+     * Parameterized constructor creates an empty hash
+     * \param cellSize - the size of the cells, about the radius of the usual query
+     * \param bucketCount - the number of buckets, rounded up to a power of 2
+     */
+    explicit SpatialHash(float cellSize, std::size_t bucketCount = 1 << 16);
+
+    /**
+     * Sorts the particles into the buckets, replacing the ones before
+     * \param positions - the position of each particle
+     */
+    void build(const std::vector<glm::vec3> &positions);
+
+    /**
+     * Finds the particles within a distance of a point
+     * \param center - the center of the sphere
+     * \param radius - the radius of the sphere
+     * \param found - gets the indices of the particles in the sphere, in no particular order
+     * \return the number of particles found
+     */
+    std::size_t query(const glm::vec3 &center, float radius, std::vector<unsigned int> &found);
+
+    /**
+     * Returns the number of particles in the hash
+     */
+    std::size_t size() const;
+
+private:
+    /**
+     * Returns the cell of a position
+     */
+    glm::ivec3 cellOf(const glm::vec3 &position) const;
+
+    /**
+     * Returns the bucket of a cell
+     */
+    std::size_t bucketOf(const glm::ivec3 &cell) const;
+
+    float cellSize;
+    std::size_t mask;
+
+    /**
+     * The first slot of each bucket in the sorted arrays, and one past the last slot
+     */
+    std::vector<unsigned int> bucketStart;
+
+    /**
+     * The particles sorted by bucket: their positions, and their indices in the positions of build()
+     */
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<unsigned int> particles;
+
+    /**
+     * The bucket of each particle, kept between the two passes of build()
+     */
+    std::vector<unsigned int> buckets;
+
+    /**
+     * The buckets a query reads, kept so the queries do not allocate
+     */
+    std::vector<std::size_t> visit;
+};
+
+#endif
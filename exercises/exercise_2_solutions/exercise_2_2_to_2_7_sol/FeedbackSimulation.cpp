@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "FeedbackSimulation.h"
+
+// position, velocity and time of birth
+static const unsigned int particleFloats = 5;
+
+FeedbackSimulation::FeedbackSimulation(unsigned int capacity, const char *updateShaderPath) : capacity(capacity){
+    std::string source = readFile(updateShaderPath);
+    const char *code = source.c_str();
+    unsigned int shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+    int success;
+    char infoLog[1024];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        glDeleteShader(shader);
+        throw std::runtime_error(std::string("FeedbackSimulation::FeedbackSimulation(): Could not compile ")
+                                 + updateShaderPath + "\n" + infoLog);
+    }
+
+    // the outputs are captured in the layout of the inputs, and there is nothing to rasterize
+    program = glCreateProgram();
+    glAttachShader(program, shader);
+    const char *outputs[] = {"outPos", "outVelocity", "outTimeOfBirth"};
+    glTransformFeedbackVaryings(program, 3, outputs, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        glDeleteProgram(program);
+        throw std::runtime_error(std::string("FeedbackSimulation::FeedbackSimulation(): Could not link ")
+                                 + updateShaderPath + "\n" + infoLog);
+    }
+
+    std::vector<float> zeros(capacity * particleFloats, 0.0f);
+    GLsizei stride = particleFloats * sizeof(float);
+    glGenBuffers(2, vertexBuffers);
+    glGenVertexArrays(2, vertexArrays);
+    for (int i = 0; i < 2; i++) {
+        glBindVertexArray(vertexArrays[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, zeros.size() * sizeof(float), zeros.data(), GL_DYNAMIC_COPY);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*) (2 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*) (4 * sizeof(float)));
+    }
+    glBindVertexArray(0);
+}
+
+FeedbackSimulation::~FeedbackSimulation(){
+    glDeleteVertexArrays(2, vertexArrays);
+    glDeleteBuffers(2, vertexBuffers);
+    glDeleteProgram(program);
+}
+
+void FeedbackSimulation::emit(unsigned int count, float x, float y, float velocityX, float velocityY, float spread,
+                              unsigned long long key){
+    pending = {count, x, y, velocityX, velocityY, spread, key};
+}
+
+void FeedbackSimulation::update(float currentTime, float deltaTime){
+    // the burst goes in the slots after the newest particle
+    unsigned int emitFirst = (unsigned int) (emitted % capacity);
+    unsigned int emitCount = std::min(pending.count, capacity);
+    if (emitCount != 0) {
+        emitted += emitCount;
+        bursts.emplace_back(emitted, currentTime);
+    }
+    pending.count = 0;
+
+    // drop the expired bursts, with the same test as the shaders, and the particles written over
+    while (!bursts.empty() && currentTime - bursts.front().second > maxAge) {
+        oldest = bursts.front().first;
+        bursts.pop_front();
+    }
+    oldest = std::max(oldest, emitted > capacity ? emitted - capacity : 0);
+
+    glUseProgram(program);
+    glUniform1f(glGetUniformLocation(program, "currentTime"), currentTime);
+    glUniform1f(glGetUniformLocation(program, "deltaTime"), deltaTime);
+    glUniform1f(glGetUniformLocation(program, "maxAge"), maxAge);
+    glUniform1f(glGetUniformLocation(program, "damping"), std::exp(-drag * deltaTime));
+    glUniform1f(glGetUniformLocation(program, "fall"), gravity * deltaTime);
+    glUniform1ui(glGetUniformLocation(program, "capacity"), capacity);
+    glUniform1ui(glGetUniformLocation(program, "emitFirst"), emitFirst);
+    glUniform1ui(glGetUniformLocation(program, "emitCount"), emitCount);
+    glUniform1ui(glGetUniformLocation(program, "burstKey"), (unsigned int) (pending.key ^ (pending.key >> 32)));
+    glUniform2f(glGetUniformLocation(program, "emitPosition"), pending.x, pending.y);
+    glUniform2f(glGetUniformLocation(program, "emitVelocity"), pending.velocityX, pending.velocityY);
+    glUniform1f(glGetUniformLocation(program, "emitSpread"), pending.spread);
+
+    // only the live window, with the new particles, is moved, the slots out of it are not drawn either
+    unsigned int first[2], count[2];
+    unsigned int ranges = liveRanges(first, count);
+    unsigned int target = 1 - current;
+    GLsizeiptr stride = particleFloats * sizeof(float);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(vertexArrays[current]);
+    for (unsigned int i = 0; i < ranges; i++) {
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vertexBuffers[target],
+                          first[i] * stride, count[i] * stride);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, first[i], count[i]);
+        glEndTransformFeedback();
+    }
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    current = target;
+}
+
+unsigned int FeedbackSimulation::currentBuffer() const{
+    return current;
+}
+
+unsigned int FeedbackSimulation::liveRanges(unsigned int first[2], unsigned int count[2]) const{
+    unsigned int live = liveCount();
+    if (live == 0)
+        return 0;
+    first[0] = (unsigned int) (oldest % capacity);
+    count[0] = std::min(live, capacity - first[0]);
+    if (count[0] == live)
+        return 1;
+    first[1] = 0;
+    count[1] = live - count[0];
+    return 2;
+}
+
+unsigned int FeedbackSimulation::liveCount() const{
+    return (unsigned int) (emitted - oldest);
+}
+
+std::string FeedbackSimulation::readFile(const char *path){
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error(std::string("FeedbackSimulation::readFile(): Could not read ") + path);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
@@ -0,0 +1,66 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_FEEDBACKSIMULATION_H
+#define ITU_GRAPHICS_PROGRAMMING_FEEDBACKSIMULATION_H
+
+#include <glad/glad.h>
+#include <deque>
+#include <string>
+
+// simulates the particles on the GPU: every frame a vertex program (shaders/feedback.vert) reads the particles from
+// one vertex buffer and writes them, moved, to the other one with transform feedback, and the buffers swap. the
+// particles never leave the GPU, and the CPU uploads nothing: emitting is a few uniforms, the program makes the new
+// particles in the slots of the ring after the newest one (over the oldest ones when it is full), from a hash of
+// their index. the CPU keeps the position of the ring and the time of every burst, which gives the live window of
+// the ring, as in ParticleStream, and only that window is moved and drawn.
+// the particles have the layout of the other modes: position, velocity and time of birth, 5 floats.
+class FeedbackSimulation {
+public:
+    // compiles the update program and allocates the two buffers of capacity particles, all zeros
+    explicit FeedbackSimulation(unsigned int capacity, const char *updateShaderPath = "shaders/feedback.vert");
+    ~FeedbackSimulation();
+
+    // makes count particles in the next update, at (x, y) and moving at (velocityX, velocityY), each one moved
+    // away by up to spread in both. a second burst before the update replaces the first. key picks the random
+    // numbers, and should be different for every burst
+    void emit(unsigned int count, float x, float y, float velocityX, float velocityY, float spread,
+              unsigned long long key);
+    // moves the live particles deltaTime seconds forward, makes the new ones, and swaps the buffers
+    void update(float currentTime, float deltaTime);
+
+    // the index of the buffer with the particles of the last update, to draw
+    unsigned int currentBuffer() const;
+    // the live window as at most two ranges of slots (two when it wraps around), returns the number of ranges
+    unsigned int liveRanges(unsigned int first[2], unsigned int count[2]) const;
+    unsigned int liveCount() const;
+
+    unsigned int capacity;
+    unsigned int vertexBuffers[2];
+    // as in ParticleSystem
+    float gravity = 0.0f;
+    float drag = 0.0f;
+    float maxAge = 10.0f;
+
+private:
+    struct Burst {
+        unsigned int count;
+        float x, y, velocityX, velocityY, spread;
+        unsigned long long key;
+    };
+
+    // reads a shader file, throws if it can not
+    static std::string readFile(const char *path);
+
+    unsigned int program;
+    // the attributes of the update program, one vertex array object per buffer it reads
+    unsigned int vertexArrays[2];
+    unsigned int current = 0;
+
+    Burst pending = {};
+    // particles emitted so far, the oldest one alive, and the index after the last particle of each burst alive,
+    // with its time of birth
+    unsigned long long emitted = 0;
+    unsigned long long oldest = 0;
+    std::deque<std::pair<unsigned long long, float>> bursts;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_FEEDBACKSIMULATION_H
@@ -0,0 +1,72 @@
+#include "JobSystem.h"
+
+JobSystem::JobSystem(unsigned int threadCount) : next(0){
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    // hardware_concurrency() returns 0 when it does not know
+    for (unsigned int i = 1; i < threadCount; i++)
+        workers.emplace_back(&JobSystem::workerLoop, this);
+}
+
+JobSystem::~JobSystem(){
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void JobSystem::parallelFor(unsigned int count, const std::function<void(unsigned int)> &job){
+    // not worth waking anyone up
+    if (count <= 1 || workers.empty()) {
+        for (unsigned int i = 0; i < count; i++)
+            job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        this->job = &job;
+        jobCount = count;
+        next = 0;
+        left = 0;
+        generation++;
+    }
+    wakeUp.notify_all();
+    work();
+
+    // the workers may still be running their last iterations, and job must outlive them
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this]() { return left == workers.size(); });
+    this->job = nullptr;
+}
+
+unsigned int JobSystem::size() const{
+    return (unsigned int) workers.size() + 1;
+}
+
+void JobSystem::workerLoop(){
+    unsigned long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wakeUp.wait(guard, [this, seen]() { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        work();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            left++;
+        }
+        done.notify_one();
+    }
+}
+
+void JobSystem::work(){
+    for (unsigned int i = next++; i < jobCount; i = next++)
+        (*job)(i);
+}
@@ -0,0 +1,47 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_JOBSYSTEM_H
+#define ITU_GRAPHICS_PROGRAMMING_JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed set of threads that run the iterations of a loop, e.g. one chunk of particles per iteration. the threads
+// claim the iterations from an atomic counter, so they share the work without locks, and the calling thread works
+// too. the iterations are not tied to threads, so a loop over fixed chunks gives the same result on any number of
+// threads.
+class JobSystem {
+public:
+    // threadCount threads in total, with the calling one, 0 uses one per hardware thread
+    explicit JobSystem(unsigned int threadCount = 0);
+    ~JobSystem();
+
+    // runs job(0) to job(count - 1) and returns when all of them are done
+    void parallelFor(unsigned int count, const std::function<void(unsigned int)> &job);
+    // the number of threads, with the calling one
+    unsigned int size() const;
+
+private:
+    void workerLoop();
+    // runs iterations of the current loop until there are none left
+    void work();
+
+    std::vector<std::thread> workers;
+
+    // the current loop, set under the lock before the workers are woken up
+    const std::function<void(unsigned int)> *job = nullptr;
+    unsigned int jobCount = 0;
+    std::atomic<unsigned int> next;
+
+    // every worker takes part in every loop, the loop is done when all of them left it
+    std::mutex lock;
+    std::condition_variable wakeUp, done;
+    unsigned long long generation = 0;
+    unsigned int left = 0;
+    bool stopping = false;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_JOBSYSTEM_H
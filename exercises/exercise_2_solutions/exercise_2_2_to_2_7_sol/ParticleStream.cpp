@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "ParticleStream.h"
+
+ParticleStream::ParticleStream(unsigned int capacity, unsigned int particleSize, unsigned int birthAttribute,
+                               unsigned int ringSize)
+        : capacity(capacity), particleSize(particleSize), birthAttribute(birthAttribute){
+    if (birthAttribute >= particleSize)
+        throw std::runtime_error("ParticleStream::ParticleStream(): The time of birth is not in the particle");
+    staging.assign(capacity * particleSize, 0.0f);
+    uploaded.assign(ringSize, 0);
+    fences.assign(ringSize, nullptr);
+
+    vertexBuffers.resize(ringSize);
+    glGenBuffers(ringSize, vertexBuffers.data());
+    for (unsigned int vertexBuffer : vertexBuffers) {
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, staging.size() * sizeof(float), staging.data(), GL_DYNAMIC_DRAW);
+    }
+}
+
+ParticleStream::~ParticleStream(){
+    for (GLsync fence : fences)
+        if (fence != nullptr)
+            glDeleteSync(fence);
+    glDeleteBuffers((GLsizei) vertexBuffers.size(), vertexBuffers.data());
+}
+
+unsigned int ParticleStream::emit(const float *particle){
+    unsigned int slot = (unsigned int) (emitted % capacity);
+    std::copy(particle, particle + particleSize, staging.begin() + slot * particleSize);
+    emitted++;
+    return slot;
+}
+
+unsigned int ParticleStream::flush(){
+    waitForBuffer(current);
+
+    // the particles emitted since this buffer was last drawn, a few frames ago, or all of them if they wrapped
+    unsigned long long missing = std::min(emitted - uploaded[current], (unsigned long long) capacity);
+    if (missing != 0) {
+        unsigned int first = (unsigned int) ((emitted - missing) % capacity);
+        unsigned int untilEnd = std::min((unsigned int) missing, capacity - first);
+        upload(first, untilEnd);
+        if (missing > untilEnd)
+            upload(0, (unsigned int) missing - untilEnd);
+        uploaded[current] = emitted;
+    }
+    return current;
+}
+
+void ParticleStream::fenceDraws(){
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    current = (current + 1) % vertexBuffers.size();
+}
+
+void ParticleStream::expire(float currentTime, float maxAge){
+    // the particles overwritten by newer ones are gone too
+    oldest = std::max(oldest, emitted > capacity ? emitted - capacity : 0);
+    while (oldest < emitted && currentTime - staging[(oldest % capacity) * particleSize + birthAttribute] > maxAge)
+        oldest++;
+}
+
+unsigned int ParticleStream::liveRanges(unsigned int first[2], unsigned int count[2]) const{
+    unsigned int live = liveCount();
+    if (live == 0)
+        return 0;
+    first[0] = (unsigned int) (oldest % capacity);
+    count[0] = std::min(live, capacity - first[0]);
+    if (count[0] == live)
+        return 1;
+    first[1] = 0;
+    count[1] = live - count[0];
+    return 2;
+}
+
+unsigned int ParticleStream::liveCount() const{
+    return (unsigned int) (emitted - oldest);
+}
+
+void ParticleStream::waitForBuffer(unsigned int index){
+    if (fences[index] == nullptr)
+        return;
+    // flush on the first wait, so the fence is guaranteed to signal
+    GLenum result = glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fences[index], 0, 1000000000);
+    glDeleteSync(fences[index]);
+    fences[index] = nullptr;
+}
+
+void ParticleStream::upload(unsigned int first, unsigned int count){
+    // the fence guarantees that the GPU is not reading this buffer anymore, so it is mapped unsynchronized
+    GLintptr offset = first * particleSize * sizeof(float);
+    GLsizeiptr size = count * particleSize * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[current]);
+    void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped == nullptr)
+        throw std::runtime_error("ParticleStream::upload(): Could not map the vertex buffer");
+    memcpy(mapped, staging.data() + first * particleSize, size);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+}
@@ -0,0 +1,55 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_PARTICLESTREAM_H
+#define ITU_GRAPHICS_PROGRAMMING_PARTICLESTREAM_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// streams the particles emitted on the CPU to a ring of vertex buffers, with one upload per frame instead of one
+// glBufferSubData per particle. the particles are staged in a CPU copy of the ring, and flush() uploads the ones
+// emitted since the last upload as at most two contiguous ranges (two when they wrap around the end of the ring).
+// OpenGL 3.3 has no persistent mapping (GL_ARB_buffer_storage is 4.4), so the buffers are mapped unsynchronized
+// instead, and take turns like the pixel buffers of a texture upload: a buffer is written only after the fence of
+// the last frame that drew it signals, so neither the GPU nor the CPU waits in practice.
+// the particles are emitted in order of birth, so the ones still alive are a window of the ring, from the oldest
+// one that has not expired to the newest one, and only that window needs to be drawn.
+class ParticleStream {
+public:
+    // allocates ringSize vertex buffers of capacity particles of particleSize floats, all zeros. the float at
+    // birthAttribute in each particle is its time of birth
+    ParticleStream(unsigned int capacity, unsigned int particleSize, unsigned int birthAttribute,
+                   unsigned int ringSize = 3);
+    ~ParticleStream();
+
+    // copies a particle to the staging ring, over the oldest one when the ring is full, and returns its slot
+    unsigned int emit(const float *particle);
+    // uploads the particles the current buffer is missing, returns the index of the buffer to draw this frame
+    unsigned int flush();
+    // fences the draws of the current buffer, after the last one of the frame, and moves to the next buffer
+    void fenceDraws();
+
+    // drops the particles older than maxAge from the live window, with the same test as the vertex shader
+    void expire(float currentTime, float maxAge);
+    // the live window as at most two ranges of slots (two when it wraps around), returns the number of ranges
+    unsigned int liveRanges(unsigned int first[2], unsigned int count[2]) const;
+    unsigned int liveCount() const;
+
+    unsigned int capacity, particleSize, birthAttribute;
+    std::vector<unsigned int> vertexBuffers;
+
+private:
+    // waits until the GPU is done with the draws of a buffer
+    void waitForBuffer(unsigned int index);
+    // copies count particles, from slot first on, to the current buffer
+    void upload(unsigned int first, unsigned int count);
+
+    std::vector<float> staging;
+    // number of particles emitted so far, the oldest one that is alive, and when each buffer was brought up to date
+    unsigned long long emitted = 0;
+    unsigned long long oldest = 0;
+    std::vector<unsigned long long> uploaded;
+    std::vector<GLsync> fences;
+    unsigned int current = 0;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_PARTICLESTREAM_H
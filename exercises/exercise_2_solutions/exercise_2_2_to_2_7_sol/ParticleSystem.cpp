@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cmath>
+#include "ParticleSystem.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+static_assert(sizeof(ParticleSystem::Vertex) == 4 * sizeof(float), "a vertex is packed as 4 floats");
+
+const unsigned int ParticleSystem::chunkSize;
+
+namespace {
+// the few vector operations of the update, on the widest registers available
+#if defined(__AVX2__)
+    typedef __m256 Batch;
+    const unsigned int batchSize = 8;
+    inline Batch load(const float *p) { return _mm256_loadu_ps(p); }
+    inline void store(float *p, Batch b) { _mm256_storeu_ps(p, b); }
+    inline Batch broadcast(float f) { return _mm256_set1_ps(f); }
+    inline Batch add(Batch a, Batch b) { return _mm256_add_ps(a, b); }
+    inline Batch sub(Batch a, Batch b) { return _mm256_sub_ps(a, b); }
+    inline Batch mul(Batch a, Batch b) { return _mm256_mul_ps(a, b); }
+    // one bit per lane where a > b
+    inline unsigned int greater(Batch a, Batch b) { return (unsigned int) _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+    inline void copy(unsigned int *to, const unsigned int *from) {
+        _mm256_storeu_si256((__m256i *) to, _mm256_loadu_si256((const __m256i *) from));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    typedef __m128 Batch;
+    const unsigned int batchSize = 4;
+    inline Batch load(const float *p) { return _mm_loadu_ps(p); }
+    inline void store(float *p, Batch b) { _mm_storeu_ps(p, b); }
+    inline Batch broadcast(float f) { return _mm_set1_ps(f); }
+    inline Batch add(Batch a, Batch b) { return _mm_add_ps(a, b); }
+    inline Batch sub(Batch a, Batch b) { return _mm_sub_ps(a, b); }
+    inline Batch mul(Batch a, Batch b) { return _mm_mul_ps(a, b); }
+    inline unsigned int greater(Batch a, Batch b) { return (unsigned int) _mm_movemask_ps(_mm_cmpgt_ps(a, b)); }
+    inline void copy(unsigned int *to, const unsigned int *from) {
+        _mm_storeu_si128((__m128i *) to, _mm_loadu_si128((const __m128i *) from));
+    }
+#endif
+}
+
+ParticleSystem::ParticleSystem(unsigned int capacity) : capacity(capacity),
+        positionX(capacity), positionY(capacity), velocityX(capacity), velocityY(capacity),
+        timeOfBirth(capacity), color(capacity){
+}
+
+bool ParticleSystem::emit(float x, float y, float vx, float vy, float birth, unsigned int rgba){
+    if (count == capacity)
+        return false;
+    positionX[count] = x;
+    positionY[count] = y;
+    velocityX[count] = vx;
+    velocityY[count] = vy;
+    timeOfBirth[count] = birth;
+    color[count] = rgba;
+    count++;
+    return true;
+}
+
+void ParticleSystem::update(float currentTime, float deltaTime){
+    count = integrate(arrays(), arrays(), 0, count, 0, currentTime, deltaTime);
+}
+
+void ParticleSystem::update(float currentTime, float deltaTime, JobSystem &jobs){
+    if (sparePositionX.empty()) {
+        sparePositionX.resize(capacity);
+        sparePositionY.resize(capacity);
+        spareVelocityX.resize(capacity);
+        spareVelocityY.resize(capacity);
+        spareTimeOfBirth.resize(capacity);
+        spareColor.resize(capacity);
+    }
+    unsigned int chunks = (count + chunkSize - 1) / chunkSize;
+    chunkKept.resize(chunks);
+
+    // first count the live particles of each chunk, which gives every chunk the place of its particles in the
+    // spare arrays, then move the chunks, each to its own place, so the threads never write to the same particles
+    jobs.parallelFor(chunks, [this, currentTime](unsigned int chunk) {
+        unsigned int end = std::min(count, (chunk + 1) * chunkSize), alive = 0;
+        for (unsigned int i = chunk * chunkSize; i < end; i++)
+            alive += currentTime - timeOfBirth[i] > maxAge ? 0 : 1;
+        chunkKept[chunk] = alive;
+    });
+    unsigned int kept = 0;
+    for (unsigned int &alive : chunkKept) {
+        unsigned int first = kept;
+        kept += alive;
+        alive = first;
+    }
+
+    Arrays from = arrays(), to = spareArrays();
+    jobs.parallelFor(chunks, [this, &from, &to, currentTime, deltaTime](unsigned int chunk) {
+        unsigned int begin = chunk * chunkSize, end = std::min(count, begin + chunkSize);
+        integrate(from, to, begin, end, chunkKept[chunk], currentTime, deltaTime);
+    });
+
+    positionX.swap(sparePositionX);
+    positionY.swap(sparePositionY);
+    velocityX.swap(spareVelocityX);
+    velocityY.swap(spareVelocityY);
+    timeOfBirth.swap(spareTimeOfBirth);
+    color.swap(spareColor);
+    count = kept;
+}
+
+unsigned int ParticleSystem::emit(unsigned int burst, unsigned long long key, const Emitter &emitter,
+                                  JobSystem &jobs){
+    unsigned int chunks = (burst + chunkSize - 1) / chunkSize;
+    if (chunkParticles.size() < chunks)
+        chunkParticles.resize(chunks);
+
+    // every chunk makes its particles into its own buffer, without locks
+    jobs.parallelFor(chunks, [this, burst, key, &emitter](unsigned int chunk) {
+        std::vector<Particle> &made = chunkParticles[chunk];
+        made.clear();
+        unsigned int end = std::min(burst, (chunk + 1) * chunkSize);
+        for (unsigned int i = chunk * chunkSize; i < end; i++) {
+            Random random(key, i);
+            Particle particle;
+            if (emitter(random, particle))
+                made.push_back(particle);
+        }
+    });
+
+    // then the buffers are appended in chunk order, each one to its own place, as many as fit
+    std::vector<unsigned int> first(chunks);
+    unsigned int added = 0;
+    for (unsigned int chunk = 0; chunk < chunks; chunk++) {
+        first[chunk] = count + added;
+        added += (unsigned int) chunkParticles[chunk].size();
+    }
+    added = std::min(added, capacity - count);
+    unsigned int end = count + added;
+    jobs.parallelFor(chunks, [this, end, &first](unsigned int chunk) {
+        const std::vector<Particle> &made = chunkParticles[chunk];
+        for (unsigned int i = 0; i < made.size() && first[chunk] + i < end; i++) {
+            unsigned int slot = first[chunk] + i;
+            positionX[slot] = made[i].x;
+            positionY[slot] = made[i].y;
+            velocityX[slot] = made[i].velocityX;
+            velocityY[slot] = made[i].velocityY;
+            timeOfBirth[slot] = made[i].timeOfBirth;
+            color[slot] = made[i].color;
+        }
+    });
+    count = end;
+    return added;
+}
+
+void ParticleSystem::pack(Vertex *vertices) const{
+    unsigned int i = 0;
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    // 4 particles are 4 vertices of 4 floats, a 4x4 transpose of the arrays
+    float *out = &vertices[0].x;
+    for (; i + 4 <= count; i += 4, out += 16) {
+        __m128 x = _mm_loadu_ps(&positionX[i]);
+        __m128 y = _mm_loadu_ps(&positionY[i]);
+        __m128 birth = _mm_loadu_ps(&timeOfBirth[i]);
+        __m128 rgba = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) &color[i]));
+        _MM_TRANSPOSE4_PS(x, y, birth, rgba);
+        _mm_storeu_ps(out, x);
+        _mm_storeu_ps(out + 4, y);
+        _mm_storeu_ps(out + 8, birth);
+        _mm_storeu_ps(out + 12, rgba);
+    }
+#endif
+    for (; i < count; i++) {
+        vertices[i].x = positionX[i];
+        vertices[i].y = positionY[i];
+        vertices[i].timeOfBirth = timeOfBirth[i];
+        vertices[i].color = color[i];
+    }
+}
+
+unsigned int ParticleSystem::size() const{
+    return count;
+}
+
+void ParticleSystem::clear(){
+    count = 0;
+}
+
+ParticleSystem::Arrays ParticleSystem::arrays(){
+    return {positionX.data(), positionY.data(), velocityX.data(), velocityY.data(), timeOfBirth.data(), color.data()};
+}
+
+ParticleSystem::Arrays ParticleSystem::spareArrays(){
+    return {sparePositionX.data(), sparePositionY.data(), spareVelocityX.data(), spareVelocityY.data(),
+            spareTimeOfBirth.data(), spareColor.data()};
+}
+
+unsigned int ParticleSystem::integrate(const Arrays &from, const Arrays &to, unsigned int begin, unsigned int end,
+                                       unsigned int kept, float currentTime, float deltaTime) const{
+    // semi-implicit Euler: the forces change the velocity first, and the new velocity moves the particle
+    const float damping = std::exp(-drag * deltaTime);
+    const float fall = gravity * deltaTime;
+
+    unsigned int i = begin;
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    const Batch dampingBatch = broadcast(damping), fallBatch = broadcast(fall), deltaBatch = broadcast(deltaTime);
+    const Batch timeBatch = broadcast(currentTime), maxAgeBatch = broadcast(maxAge);
+    for (; i + batchSize <= end; i += batchSize) {
+        Batch vx = mul(load(from.velocityX + i), dampingBatch);
+        Batch vy = add(mul(load(from.velocityY + i), dampingBatch), fallBatch);
+        Batch x = add(load(from.positionX + i), mul(vx, deltaBatch));
+        Batch y = add(load(from.positionY + i), mul(vy, deltaBatch));
+        Batch birth = load(from.timeOfBirth + i);
+        // the same test as the shaders, expired if currentTime - timeOfBirth > maxAge
+        unsigned int expired = greater(sub(timeBatch, birth), maxAgeBatch);
+
+        if (expired == 0) {
+            // the usual case, the whole batch is kept, and written as a batch
+            copy(to.color + kept, from.color + i);
+            store(to.timeOfBirth + kept, birth);
+            store(to.positionX + kept, x);
+            store(to.positionY + kept, y);
+            store(to.velocityX + kept, vx);
+            store(to.velocityY + kept, vy);
+            kept += batchSize;
+        } else {
+            float lanes[4][batchSize];
+            store(lanes[0], x);
+            store(lanes[1], y);
+            store(lanes[2], vx);
+            store(lanes[3], vy);
+            for (unsigned int l = 0; l < batchSize; l++) {
+                if (expired & (1u << l))
+                    continue;
+                to.positionX[kept] = lanes[0][l];
+                to.positionY[kept] = lanes[1][l];
+                to.velocityX[kept] = lanes[2][l];
+                to.velocityY[kept] = lanes[3][l];
+                to.timeOfBirth[kept] = from.timeOfBirth[i + l];
+                to.color[kept] = from.color[i + l];
+                kept++;
+            }
+        }
+    }
+#endif
+    for (; i < end; i++) {
+        if (currentTime - from.timeOfBirth[i] > maxAge)
+            continue;
+        float vx = from.velocityX[i] * damping;
+        float vy = from.velocityY[i] * damping + fall;
+        to.positionX[kept] = from.positionX[i] + vx * deltaTime;
+        to.positionY[kept] = from.positionY[i] + vy * deltaTime;
+        to.velocityX[kept] = vx;
+        to.velocityY[kept] = vy;
+        to.timeOfBirth[kept] = from.timeOfBirth[i];
+        to.color[kept] = from.color[i];
+        kept++;
+    }
+    return kept;
+}
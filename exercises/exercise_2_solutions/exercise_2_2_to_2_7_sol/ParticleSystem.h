@@ -0,0 +1,103 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_PARTICLESYSTEM_H
+#define ITU_GRAPHICS_PROGRAMMING_PARTICLESYSTEM_H
+
+#include <functional>
+#include <vector>
+#include "JobSystem.h"
+#include "Random.h"
+
+// simulates the particles on the CPU, instead of evaluating pos + velocity * elapsedTime in the vertex shader, so
+// they can be pushed around by forces. the state is a structure of arrays, one array per attribute, so the update
+// runs on 8 (AVX2) or 4 (SSE2) particles at a time, and the expired particles are removed in the same pass by
+// moving the live ones down, in order. the live particles are always the first size() ones, and pack() writes
+// them as interleaved vertices, e.g. straight to a mapped vertex buffer for one upload per frame.
+// the update and the emission of bursts also run on a JobSystem, split in chunks of a fixed size, which gives the
+// same particles in the same order on any number of threads.
+// nothing here depends on OpenGL, so it also runs without a window.
+class ParticleSystem {
+public:
+    // a live particle as drawn: position, time of birth and color, 16 bytes
+    struct Vertex {
+        float x, y;
+        float timeOfBirth;
+        unsigned int color;
+    };
+
+    // a particle as made by an emitter
+    struct Particle {
+        float x, y;
+        float velocityX, velocityY;
+        float timeOfBirth;
+        unsigned int color;
+    };
+
+    // makes particle i of a burst with the numbers of its own generator, Random(key, i). returns false to skip it
+    typedef std::function<bool(Random &random, Particle &particle)> Emitter;
+
+    // particles per job of the parallel update and emission, a multiple of the SIMD width
+    static const unsigned int chunkSize = 16384;
+
+    // allocates room for capacity particles. only the first parallel update and burst allocate after that
+    explicit ParticleSystem(unsigned int capacity);
+
+    // adds a particle, the times of birth must not decrease. the color is packed as 0xAABBGGRR, i.e. RGBA bytes in
+    // memory. returns false, and drops the particle, if the system is full
+    bool emit(float x, float y, float velocityX, float velocityY, float timeOfBirth, unsigned int color);
+    // adds a burst of up to count particles made by emitter, in parallel, with their generators keyed by key, which
+    // should be different for every burst. the particles that do not fit are dropped, returns the number added
+    unsigned int emit(unsigned int count, unsigned long long key, const Emitter &emitter, JobSystem &jobs);
+    // moves the particles deltaTime seconds forward, and removes the ones older than maxAge at currentTime
+    void update(float currentTime, float deltaTime);
+    // the same, in parallel
+    void update(float currentTime, float deltaTime, JobSystem &jobs);
+    // writes the size() live particles to vertices
+    void pack(Vertex *vertices) const;
+    unsigned int size() const;
+    // removes all the particles
+    void clear();
+
+    unsigned int capacity;
+    // acceleration along y, in units per second squared, and the decay rate of the velocity, which is scaled by
+    // exp(-drag) every second
+    float gravity = 0.0f;
+    float drag = 0.0f;
+    // seconds a particle is alive
+    float maxAge = 10.0f;
+
+    // the state of the particles, only the first size() entries are live
+    std::vector<float> positionX, positionY;
+    std::vector<float> velocityX, velocityY;
+    std::vector<float> timeOfBirth;
+    std::vector<unsigned int> color;
+
+private:
+    // the state arrays, of this system or of the spare set
+    struct Arrays {
+        float *positionX, *positionY;
+        float *velocityX, *velocityY;
+        float *timeOfBirth;
+        unsigned int *color;
+    };
+    Arrays arrays();
+    Arrays spareArrays();
+
+    // moves the particles [begin, end) of from, and writes the live ones to to, in order, from index kept on.
+    // from and to can be the same arrays, the particles are read before anything is written over them. returns the
+    // index after the last particle written
+    unsigned int integrate(const Arrays &from, const Arrays &to, unsigned int begin, unsigned int end,
+                           unsigned int kept, float currentTime, float deltaTime) const;
+
+    unsigned int count = 0;
+
+    // the parallel update writes to a second set of arrays, which are then swapped with the state
+    std::vector<float> sparePositionX, sparePositionY;
+    std::vector<float> spareVelocityX, spareVelocityY;
+    std::vector<float> spareTimeOfBirth;
+    std::vector<unsigned int> spareColor;
+    // the live particles of each chunk of the parallel update, and the particles made by each chunk of a burst
+    std::vector<unsigned int> chunkKept;
+    std::vector<std::vector<Particle>> chunkParticles;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_PARTICLESYSTEM_H
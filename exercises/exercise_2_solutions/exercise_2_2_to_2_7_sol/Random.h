@@ -0,0 +1,36 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_RANDOM_H
+#define ITU_GRAPHICS_PROGRAMMING_RANDOM_H
+
+// a counter-based random number generator: the numbers are a hash of a key and a counter (SplitMix64), instead of
+// the next step of a shared state like rand(). every particle of a burst gets its own generator from its index,
+// so the particles can be made on any thread, in any order, and still come out the same for the same key.
+class Random {
+public:
+    Random(unsigned long long key, unsigned long long counter) : state(mix(key + mix(counter))) {}
+
+    // 32 random bits
+    unsigned int next(){
+        state += 0x9e3779b97f4a7c15ull;
+        return (unsigned int) (mix(state) >> 32);
+    }
+    // uniform in [0, 1)
+    float uniform(){
+        return (float) (next() >> 8) * (1.0f / 16777216.0f);
+    }
+    // uniform in [min, max)
+    float uniform(float min, float max){
+        return min + (max - min) * uniform();
+    }
+
+private:
+    static unsigned long long mix(unsigned long long z){
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    unsigned long long state;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_RANDOM_H
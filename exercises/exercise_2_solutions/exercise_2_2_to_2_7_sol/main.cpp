@@ -2,13 +2,26 @@
 #include <GLFW/glfw3.h>
 
 #include <shader_s.h>
+#include "ParticleStream.h"
+#include "ParticleSystem.h"
+#include "FeedbackSimulation.h"
 
 #include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
 #include <vector>
 #include <chrono>
 
 void bindAttributes();
 void createVertexBufferObject();
+void createSimulationBuffers();
+void drawSimulatedParticles();
+void createFeedbackSimulation();
+void drawFeedbackParticles();
+unsigned int randomTint(Random &random);
+unsigned long long nextBurstKey();
+int runHeadless(int argc, char **argv);
 void emitParticle(float x, float y, float velocityX, float velocityY, float currentTime);
 // glfw functions
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
@@ -21,18 +34,52 @@ const unsigned int SCR_HEIGHT = 600;
 // application global variables
 float lastX, lastY;                             // used to compute delta movement of the mouse
 float currentTime;
-unsigned int VAO, VBO;                          // vertex array and buffer objects
+std::vector<unsigned int> VAOs;                 // vertex array objects, one per buffer of the particle stream
 const unsigned int vertexBufferSize = 65536;    // # of particles
+const float maxAge = 10.0f;                     // seconds a particle is alive, shared with the shaders
 
 // TODO 2.2 update the number of attributes in a particle
 const unsigned int particleSize = 5;            // particle attributes
 
 const unsigned int sizeOfFloat = 4;             // bytes in a float
-unsigned int particleId = 0;                    // keep track of last particle to be updated
 Shader *shaderProgram;                          // our shader program
-
-int main()
+ParticleStream *particleStream;                 // stages the emitted particles, uploaded once per frame
+
+// with --cpu, the particles are moved on the CPU, with gravity and drag, instead of in the vertex shader, and with
+// --gpu they are moved on the GPU, with transform feedback
+bool simulateOnCPU = false;
+bool simulateOnGPU = false;
+const unsigned int simulationCapacity = 1 << 20;
+const float simulationGravity = -0.2f;
+const float simulationDrag = 0.3f;
+ParticleSystem *particleSystem;
+Shader *simulationProgram;
+unsigned int simulationVAO, simulationVBO;
+FeedbackSimulation *feedbackSimulation;
+unsigned int feedbackVAOs[2];                   // to draw each buffer of the feedback simulation
+// the update and the emission run on threadCount threads (--threads, 0 is one per core), and the particles are the
+// same for the same --seed on any number of threads
+JobSystem *jobSystem;
+unsigned int threadCount = 0;
+unsigned int seed = 1;
+unsigned int bursts = 0;
+
+int main(int argc, char **argv)
 {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+            return runHeadless(argc, argv);
+        else if (arg == "--cpu")
+            simulateOnCPU = true;
+        else if (arg == "--gpu")
+            simulateOnGPU = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            threadCount = (unsigned int) std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = (unsigned int) std::strtoul(argv[++i], nullptr, 10);
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -78,11 +125,18 @@ int main()
     glBlendFunc(GL_SRC_ALPHA, GL_DST_ALPHA);
 
 
-    createVertexBufferObject();
+    if (simulateOnCPU)
+        createSimulationBuffers();
+    else if (simulateOnGPU)
+        createFeedbackSimulation();
+    else
+        createVertexBufferObject();
 
     // render every loopInterval seconds
     float loopInterval = 0.02f;
     auto begin = std::chrono::high_resolution_clock::now();
+    float lastTitleTime = 0.0f;
+    float lastFrameTime = 0.0f;
 
     // render loop
     // -----------
@@ -100,16 +154,43 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // set shader program and the uniform value "currentTime"
-        shaderProgram->use();
-
-        // TODO 2.3 set uniform variable related to current time
-        shaderProgram->setFloat("currentTime", currentTime);
-
+        if (simulateOnCPU) {
+            particleSystem->update(currentTime, currentTime - lastFrameTime, *jobSystem);
+            lastFrameTime = currentTime;
+            drawSimulatedParticles();
+        } else if (simulateOnGPU) {
+            feedbackSimulation->update(currentTime, currentTime - lastFrameTime);
+            lastFrameTime = currentTime;
+            drawFeedbackParticles();
+        } else {
+            // set shader program and the uniform value "currentTime"
+            shaderProgram->use();
+
+            // TODO 2.3 set uniform variable related to current time
+            shaderProgram->setFloat("currentTime", currentTime);
+            shaderProgram->setFloat("maxAge", maxAge);
+
+
+            // upload the particles emitted this frame, in one or two ranges, and render the live ones only,
+            // from the oldest to the newest, in one or two ranges too (nothing is drawn when all have expired)
+            particleStream->expire(currentTime, maxAge);
+            unsigned int current = particleStream->flush();
+            unsigned int first[2], count[2];
+            unsigned int ranges = particleStream->liveRanges(first, count);
+            glBindVertexArray(VAOs[current]);
+            for (unsigned int i = 0; i < ranges; i++)
+                glDrawArrays(GL_POINTS, first[i], count[i]);
+            particleStream->fenceDraws();
+        }
 
-        // render particles
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_POINTS, 0, vertexBufferSize);
+        // show the number of live particles, a few times per second
+        if (currentTime - lastTitleTime > 0.5f) {
+            unsigned int live = simulateOnCPU ? particleSystem->size() :
+                                simulateOnGPU ? feedbackSimulation->liveCount() : particleStream->liveCount();
+            std::string title = "LearnOpenGL - " + std::to_string(live) + " particles";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentTime;
+        }
 
         // show the frame buffer
         glfwSwapBuffers(window);
@@ -125,8 +206,18 @@ int main()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    if (simulateOnCPU) {
+        glDeleteVertexArrays(1, &simulationVAO);
+        glDeleteBuffers(1, &simulationVBO);
+        delete particleSystem;
+        delete jobSystem;
+    } else if (simulateOnGPU) {
+        glDeleteVertexArrays(2, feedbackVAOs);
+        delete feedbackSimulation;
+    } else {
+        glDeleteVertexArrays((GLsizei) VAOs.size(), VAOs.data());
+        delete particleStream;
+    }
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -156,25 +247,118 @@ void bindAttributes(){
 }
 
 void createVertexBufferObject(){
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    // the particle buffers are allocated at openGL controlled memory, with all values set to 0
+    // the time of birth is the 5th float of a particle
+    particleStream = new ParticleStream(vertexBufferSize, particleSize, 4);
+
+    // the buffers take turns from frame to frame, each one is drawn with its own vertex array object
+    VAOs.resize(particleStream->vertexBuffers.size());
+    glGenVertexArrays((GLsizei) VAOs.size(), VAOs.data());
+    for (unsigned int i = 0; i < VAOs.size(); i++) {
+        glBindVertexArray(VAOs[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, particleStream->vertexBuffers[i]);
+        bindAttributes();
+    }
+}
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+void createSimulationBuffers(){
+    particleSystem = new ParticleSystem(simulationCapacity);
+    particleSystem->maxAge = maxAge;
+    particleSystem->gravity = simulationGravity;
+    particleSystem->drag = simulationDrag;
+    jobSystem = new JobSystem(threadCount);
+    simulationProgram = new Shader("shaders/simulated.vert", "shaders/shader.frag");
+
+    // the buffer is rewritten every frame with the live particles, packed
+    glGenVertexArrays(1, &simulationVAO);
+    glGenBuffers(1, &simulationVBO);
+    glBindVertexArray(simulationVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, simulationVBO);
+    glBufferData(GL_ARRAY_BUFFER, simulationCapacity * sizeof(ParticleSystem::Vertex), NULL, GL_STREAM_DRAW);
+
+    GLsizei stride = sizeof(ParticleSystem::Vertex);
+    GLuint vertexLocation = glGetAttribLocation(simulationProgram->ID, "pos");
+    glEnableVertexAttribArray(vertexLocation);
+    glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, stride, 0);
+    GLuint timeBirthLocation = glGetAttribLocation(simulationProgram->ID, "timeOfBirth");
+    glEnableVertexAttribArray(timeBirthLocation);
+    glVertexAttribPointer(timeBirthLocation, 1, GL_FLOAT, GL_FALSE, stride, (void*) (2 * sizeOfFloat));
+    GLuint colorLocation = glGetAttribLocation(simulationProgram->ID, "color");
+    glEnableVertexAttribArray(colorLocation);
+    glVertexAttribPointer(colorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*) (3 * sizeOfFloat));
+}
 
-    // initialize particle buffer, set all values to 0
-    std::vector<float> data(vertexBufferSize * particleSize);
-    for(unsigned int i = 0; i < data.size(); i++)
-        data[i] = 0.0f;
+void drawSimulatedParticles(){
+    simulationProgram->use();
+    simulationProgram->setFloat("currentTime", currentTime);
+    simulationProgram->setFloat("maxAge", maxAge);
+
+    unsigned int live = particleSystem->size();
+    if (live == 0)
+        return;
+
+    // one upload per frame: the live particles are packed straight into the buffer, and invalidating the whole
+    // buffer lets the driver hand out fresh memory instead of waiting for the draws of the last frame
+    glBindVertexArray(simulationVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, simulationVBO);
+    void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, live * sizeof(ParticleSystem::Vertex),
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped == nullptr)
+        return;
+    particleSystem->pack((ParticleSystem::Vertex *) mapped);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glDrawArrays(GL_POINTS, 0, live);
+}
 
-    // allocate at openGL controlled memory
-    glBufferData(GL_ARRAY_BUFFER, vertexBufferSize * particleSize * sizeOfFloat, &data[0], GL_DYNAMIC_DRAW);
-    bindAttributes();
+void createFeedbackSimulation(){
+    feedbackSimulation = new FeedbackSimulation(simulationCapacity);
+    feedbackSimulation->maxAge = maxAge;
+    feedbackSimulation->gravity = simulationGravity;
+    feedbackSimulation->drag = simulationDrag;
+    simulationProgram = new Shader("shaders/simulated.vert", "shaders/shader.frag");
+
+    // the particles are drawn from the buffer the last update wrote to, which alternates
+    GLsizei stride = particleSize * sizeOfFloat;
+    GLuint vertexLocation = glGetAttribLocation(simulationProgram->ID, "pos");
+    GLuint timeBirthLocation = glGetAttribLocation(simulationProgram->ID, "timeOfBirth");
+    glGenVertexArrays(2, feedbackVAOs);
+    for (unsigned int i = 0; i < 2; i++) {
+        glBindVertexArray(feedbackVAOs[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, feedbackSimulation->vertexBuffers[i]);
+        glEnableVertexAttribArray(vertexLocation);
+        glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, stride, 0);
+        glEnableVertexAttribArray(timeBirthLocation);
+        glVertexAttribPointer(timeBirthLocation, 1, GL_FLOAT, GL_FALSE, stride, (void*) (4 * sizeOfFloat));
+    }
+}
+
+void drawFeedbackParticles(){
+    simulationProgram->use();
+    simulationProgram->setFloat("currentTime", currentTime);
+    simulationProgram->setFloat("maxAge", maxAge);
+    // these particles have no color, the attribute is left disabled and reads this white instead
+    glVertexAttrib4f(glGetAttribLocation(simulationProgram->ID, "color"), 1.0f, 1.0f, 1.0f, 1.0f);
+
+    unsigned int first[2], count[2];
+    unsigned int ranges = feedbackSimulation->liveRanges(first, count);
+    glBindVertexArray(feedbackVAOs[feedbackSimulation->currentBuffer()]);
+    for (unsigned int i = 0; i < ranges; i++)
+        glDrawArrays(GL_POINTS, first[i], count[i]);
+}
+
+// a warm white, packed as 0xAABBGGRR
+unsigned int randomTint(Random &random){
+    unsigned int green = 200 + (unsigned int) random.uniform(0.0f, 55.0f);
+    unsigned int blue = 150 + (unsigned int) random.uniform(0.0f, 105.0f);
+    return 0xff000000u | (blue << 16) | (green << 8) | 0xffu;
+}
+
+// a different key for every burst of particles, from the seed
+unsigned long long nextBurstKey(){
+    return ((unsigned long long) seed << 32) | bursts++;
 }
 
 void emitParticle(float x, float y, float velocityX, float velocityY, float timeOfBirth){
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
     float data[particleSize];
     data[0] = x;
     data[1] = y,
@@ -186,12 +370,72 @@ void emitParticle(float x, float y, float velocityX, float velocityY, float time
 
 
 
-    // upload only parts of the buffer
-    glBufferSubData(GL_ARRAY_BUFFER, particleId * particleSize * sizeOfFloat, particleSize * sizeOfFloat, data);
-    particleId = (particleId + 1) % vertexBufferSize;
+    // stage the particle, all the particles of the frame are uploaded together before drawing
+    particleStream->emit(data);
 }
 
 
+// runs the CPU simulation of a fountain without a window or an OpenGL context, and prints what it costs, and a
+// checksum of the final particles to compare runs
+int runHeadless(int argc, char **argv){
+    int frames = 500, particlesPerFrame = 10000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless") continue;
+        else if (arg == "--frames" && hasValue) frames = std::atoi(argv[++i]);
+        else if (arg == "--particles" && hasValue) particlesPerFrame = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) seed = (unsigned int) std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && hasValue) threadCount = (unsigned int) std::strtoul(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Unknown or incomplete argument: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0] << " --headless [--frames N] [--particles N] [--seed N] [--threads N]"
+                      << std::endl;
+            return -1;
+        }
+    }
+    if (frames < 0 || particlesPerFrame < 0) {
+        std::cerr << "Invalid frame or particle count" << std::endl;
+        return -1;
+    }
+
+    ParticleSystem system(simulationCapacity);
+    system.maxAge = maxAge;
+    system.gravity = simulationGravity;
+    system.drag = simulationDrag;
+    std::vector<ParticleSystem::Vertex> vertices(simulationCapacity);
+    JobSystem jobs(threadCount);
+
+    float deltaTime = 0.02f;
+    float time = 0.0f;
+    ParticleSystem::Emitter fountain = [&time](Random &random, ParticleSystem::Particle &particle) {
+        particle.x = 0.0f;
+        particle.y = -0.8f;
+        particle.velocityX = random.uniform(-.2f, .2f);
+        particle.velocityY = random.uniform(.5f, 1.0f);
+        particle.timeOfBirth = time;
+        particle.color = randomTint(random);
+        return true;
+    };
+    std::chrono::duration<double> simulationTime(0);
+    for (int frame = 1; frame <= frames; frame++) {
+        time = (float) frame * deltaTime;
+        auto start = std::chrono::high_resolution_clock::now();
+        system.emit((unsigned int) particlesPerFrame, nextBurstKey(), fountain, jobs);
+        system.update(time, deltaTime, jobs);
+        system.pack(vertices.data());
+        simulationTime += std::chrono::high_resolution_clock::now() - start;
+    }
+
+    double checksum = 0.0;
+    for (unsigned int i = 0; i < system.size(); i++)
+        checksum += vertices[i].x + vertices[i].y;
+    std::cout << "threads: " << jobs.size() << ", frames: " << frames << ", live particles: " << system.size() << ", emit, update and pack: "
+              << simulationTime.count() * 1000.0 / std::max(frames, 1) << " ms per frame, checksum: "
+              << checksum << std::endl;
+    return 0;
+}
+
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window)
@@ -214,17 +458,32 @@ void processInput(GLFWwindow *window)
         // compute velocity based on two consecutive updates
         float velocityX = xNdc - lastX;
         float velocityY = yNdc - lastY;
-        float max_rand = (float) (RAND_MAX);
-        // create 5 to 10 particles per frame
-        int i = (int) ((float) (rand()) / max_rand) * 5;
-        for (; i < 10; i++) {
+        // every particle draws its numbers from its own generator, instead of the shared state of rand()
+        ParticleSystem::Emitter emitter = [=](Random &random, ParticleSystem::Particle &particle) {
             // add some randomness to the movement parameters
-            float offsetX = ((float) (rand()) / max_rand - .5f) * .1f;
-            float offsetY = ((float) (rand()) / max_rand - .5f) * .1f;
-            float offsetVelX = ((float) (rand()) / max_rand - .5f) * .1f;
-            float offsetVelY = ((float) (rand()) / max_rand - .5f) * .1f;
-            // create the particle
-            emitParticle(xNdc + offsetX, yNdc + offsetY, velocityX + offsetVelX, velocityY + offsetVelY, currentTime);
+            particle.x = xNdc + random.uniform(-.05f, .05f);
+            particle.y = yNdc + random.uniform(-.05f, .05f);
+            particle.velocityX = velocityX + random.uniform(-.05f, .05f);
+            particle.velocityY = velocityY + random.uniform(-.05f, .05f);
+            particle.timeOfBirth = currentTime;
+            particle.color = randomTint(random);
+            return true;
+        };
+        // create 10 particles per frame
+        const unsigned int burst = 10;
+        unsigned long long key = nextBurstKey();
+        if (simulateOnCPU) {
+            particleSystem->emit(burst, key, emitter, *jobSystem);
+        } else if (simulateOnGPU) {
+            // the particles are made on the GPU, by the next update
+            feedbackSimulation->emit(burst, xNdc, yNdc, velocityX, velocityY, .05f, key);
+        } else {
+            for (unsigned int i = 0; i < burst; i++) {
+                Random random(key, i);
+                ParticleSystem::Particle particle;
+                emitter(random, particle);
+                emitParticle(particle.x, particle.y, particle.velocityX, particle.velocityY, particle.timeOfBirth);
+            }
         }
     }
     lastX = xNdc;
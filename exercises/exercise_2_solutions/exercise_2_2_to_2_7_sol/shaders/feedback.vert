@@ -0,0 +1,64 @@
+#version 330 core
+// moves the particles on the GPU, the outputs are written to the other vertex buffer with transform feedback
+layout (location = 0) in vec2 pos;
+layout (location = 1) in vec2 velocity;
+layout (location = 2) in float timeOfBirth;
+
+out vec2 outPos;
+out vec2 outVelocity;
+out float outTimeOfBirth;
+
+uniform float currentTime;
+uniform float deltaTime;
+uniform float maxAge;
+// the velocity is scaled by damping and then accelerated by fall, every update
+uniform float damping;
+uniform float fall;
+
+// the burst of this update: emitCount particles from slot emitFirst of the ring on
+uniform uint capacity;
+uniform uint emitFirst;
+uniform uint emitCount;
+uniform uint burstKey;
+uniform vec2 emitPosition;
+uniform vec2 emitVelocity;
+uniform float emitSpread;
+
+// an integer hash, the random numbers of a particle only depend on the burst and the index in it
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// uniform in [-1, 1)
+float random(inout uint state)
+{
+    state = hash(state);
+    return float(state >> 8) / 8388608.0 - 1.0;
+}
+
+void main()
+{
+    uint index = (uint(gl_VertexID) + capacity - emitFirst) % capacity;
+    if (index < emitCount) {
+        // a new particle
+        uint state = hash(burstKey ^ hash(index));
+        outPos = emitPosition + emitSpread * vec2(random(state), random(state));
+        outVelocity = emitVelocity + emitSpread * vec2(random(state), random(state));
+        outTimeOfBirth = currentTime;
+    } else if (timeOfBirth != 0 && currentTime - timeOfBirth <= maxAge) {
+        // semi-implicit Euler, as on the CPU
+        outVelocity = velocity * damping + vec2(0.0, fall);
+        outPos = pos + outVelocity * deltaTime;
+        outTimeOfBirth = timeOfBirth;
+    } else {
+        outPos = pos;
+        outVelocity = velocity;
+        outTimeOfBirth = timeOfBirth;
+    }
+}
@@ -4,13 +4,16 @@ out vec4 fragColor;
 
 // TODO 2.6: should receive the age of the particle as an input variable
 in float elapsedTimeFrag;
+// the color of the particle, multiplies the color of its age
+in vec4 tintFrag;
 
 const vec3 startCol = vec3(1.0, 1.0, 0.05);
 const vec3 midCol = vec3(1.0, 0.5, 0.01);
 const vec3 endCol = vec3(0.0, 0.0, 0.0);
 
 const float midAge = 5.0;
-const float maxAge = 10.0;
+// set from the application, which skips drawing the particles older than that
+uniform float maxAge;
 
 void main()
 {
@@ -26,6 +29,6 @@ void main()
 
     float alpha = mix(1.0 - distance, 0, elapsedTimeFrag / maxAge);
 
-    fragColor = vec4(color, alpha);
+    fragColor = vec4(color, alpha) * tintFrag;
 
 }
\ No newline at end of file
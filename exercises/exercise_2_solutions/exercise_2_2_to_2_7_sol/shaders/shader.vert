@@ -9,8 +9,11 @@ uniform float currentTime;
 
 // TODO 2.6 create out variable to send the age of the particle to the fragment shader
 out float elapsedTimeFrag;
+// these particles have no color of their own
+out vec4 tintFrag;
 
-const float maxAge = 10.0;
+// set from the application, which skips drawing the particles older than that
+uniform float maxAge;
 
 void main()
 {
@@ -25,6 +28,7 @@ void main()
 
     // TODO 2.6 send the age of the particle to the fragment shader using the out variable you have created
     elapsedTimeFrag = elapsedTime;
+    tintFrag = vec4(1.0);
 
     gl_Position = vec4(finalPos, 0.0, 1.0);
     gl_PointSize = (elapsedTime * 2.0) + 1.0;
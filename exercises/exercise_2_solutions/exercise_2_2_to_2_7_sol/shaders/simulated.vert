@@ -0,0 +1,20 @@
+#version 330 core
+// the particles moved on the CPU or with transform feedback, the position is the current one
+layout (location = 0) in vec2 pos;
+layout (location = 1) in float timeOfBirth;
+layout (location = 2) in vec4 color;
+
+uniform float currentTime;
+
+out float elapsedTimeFrag;
+out vec4 tintFrag;
+
+void main()
+{
+    float elapsedTime = currentTime - timeOfBirth;
+    elapsedTimeFrag = elapsedTime;
+    tintFrag = color;
+
+    gl_Position = vec4(pos, 0.0, 1.0);
+    gl_PointSize = (elapsedTime * 2.0) + 1.0;
+}
@@ -3,6 +3,7 @@
 //
 
 #include <assert.h>
+#include <algorithm>
 #include "CustomFrameBuffer.h"
 
 CustomFrameBuffer::CustomFrameBuffer(uint32_t width, uint32_t height) : W(width), H(height){
@@ -10,40 +11,113 @@ CustomFrameBuffer::CustomFrameBuffer(uint32_t width, uint32_t height) : W(width)
         delete buffer;
     int size = W * H * 3 * 3; // (the hardcoded 3s are the width and height of each "pixel")
     buffer = new Colors::color[size]; // ... and allocate one
+    depth = new float[W * H];
     clearBuffer();
+    clearDepth();
 }
 
 CustomFrameBuffer::~CustomFrameBuffer(){
     delete[] buffer; // clean our memory
+    delete[] depth;
 }
 
-void CustomFrameBuffer::clearBuffer(Colors::color col){
-    int size = W * H * 3 * 3;
-    for(int i = 0; i < size; i++)
-        buffer[i] = col;
+void CustomFrameBuffer::clearBuffer(Colors::color col, Colors::color gridCol){
+    if (cleared && col == clearColor && gridCol == gridColor) {
+        // everything but the painted regions already has these colors
+        for (const rect &r : painted) {
+            clearRegion(r);
+            addRegion(damage, r);
+        }
+    } else {
+        clearColor = col;
+        gridColor = gridCol;
+        clearRegion({0, 0, W, H});
+        addRegion(damage, {0, 0, W, H});
+    }
+    painted.clear();
+    cleared = true;
+}
+
+void CustomFrameBuffer::clearRegion(const rect &region){
+    for (uint32_t y = region.y0 * 3; y < region.y1 * 3; y++) {
+        Colors::color *row = buffer + y * W * 3;
+        std::fill_n(row + region.x0 * 3, (region.x1 - region.x0) * 3, gridColor);
+        // only the middle row of each 3x3 range has a center
+        if (y % 3 == 1 && clearColor != gridColor)
+            for (uint32_t x = region.x0; x < region.x1; x++)
+                row[x * 3 + 1] = clearColor;
+    }
+}
+
+void CustomFrameBuffer::clearDepth(float value){
+    std::fill_n(depth, W * H, value);
+}
+
+bool CustomFrameBuffer::depthTest(uint32_t x, uint32_t y, float z){
+    float &stored = depth[x + y * W];
+    if (z >= stored)
+        return false;
+    stored = z;
+    return true;
 }
 
 void CustomFrameBuffer::paintAt(uint32_t x, uint32_t y, Colors::color col, CustomFrameBuffer::fill fillOption){
-    assert (x < W && y < H); // ensure valid position, crash if not (sooo dramatic!)
-
-    // location of the center pixel in the buffer
-    int px = (x * 3 + 1) + (y * 3 + 1) * W * 3;
-
-    if (fillOption != CustomFrameBuffer::fill::center) {
-        // fill out the 3x3 range
-        for (int i = -1; i <= 1; i++) {
-            for (int j = -1; j <= 1; j++) {
-                if (fillOption == CustomFrameBuffer::fill::cross && abs(i) + abs(j) > 1)
-                    continue; // skip corners
-                if (fillOption == CustomFrameBuffer::fill::checkboard && abs(i) + abs(j) != 1)
-                    continue;
-                if (fillOption == CustomFrameBuffer::fill::frame && abs(i) + abs(j) == 0)
-                    continue;
-                int currentPx = px + j * 3 * W + i;
-                buffer[currentPx] = col;
-            }
+    markDamaged(x, y, x + 1, y + 1);
+    switch (fillOption) {
+        case fill::solid: paintAt<fill::solid>(x, y, col); break;
+        case fill::cross: paintAt<fill::cross>(x, y, col); break;
+        case fill::center: paintAt<fill::center>(x, y, col); break;
+        case fill::checkboard: paintAt<fill::checkboard>(x, y, col); break;
+        case fill::frame: paintAt<fill::frame>(x, y, col); break;
+    }
+}
+
+void CustomFrameBuffer::paintSpan(uint32_t y, uint32_t xBegin, uint32_t xEnd, Colors::color col, CustomFrameBuffer::fill fillOption){
+    switch (fillOption) {
+        case fill::solid: paintSpan<fill::solid>(y, xBegin, xEnd, col); break;
+        case fill::cross: paintSpan<fill::cross>(y, xBegin, xEnd, col); break;
+        case fill::center: paintSpan<fill::center>(y, xBegin, xEnd, col); break;
+        case fill::checkboard: paintSpan<fill::checkboard>(y, xBegin, xEnd, col); break;
+        case fill::frame: paintSpan<fill::frame>(y, xBegin, xEnd, col); break;
+    }
+}
+
+void CustomFrameBuffer::markDamaged(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1){
+    addRegion(damage, {x0, y0, x1, y1});
+    addRegion(painted, {x0, y0, x1, y1});
+}
+
+void CustomFrameBuffer::clearDamage(){
+    damage.clear();
+}
+
+void CustomFrameBuffer::addRegion(std::vector<rect> &regions, rect region){
+    // consecutive paints usually hit the last region that grew
+    if (!regions.empty()) {
+        const rect &last = regions.back();
+        if (region.x0 >= last.x0 && region.y0 >= last.y0 && region.x1 <= last.x1 && region.y1 <= last.y1)
+            return;
+    }
+
+    // merge every region that overlaps or touches the new one, until the rest is disjoint from it
+    for (size_t i = 0; i < regions.size(); ) {
+        const rect &r = regions[i];
+        if (r.x0 <= region.x1 && region.x0 <= r.x1 && r.y0 <= region.y1 && region.y0 <= r.y1) {
+            region = {std::min(r.x0, region.x0), std::min(r.y0, region.y0),
+                      std::max(r.x1, region.x1), std::max(r.y1, region.y1)};
+            regions.erase(regions.begin() + i);
+            i = 0; // the grown region may touch the ones already checked
+        } else {
+            i++;
         }
-    } else { // fill out only the center
-        buffer[px] = col;
     }
-}
\ No newline at end of file
+    regions.push_back(region);
+
+    if (regions.size() > MAX_REGIONS) {
+        rect bounds = regions[0];
+        for (const rect &r : regions)
+            bounds = {std::min(r.x0, bounds.x0), std::min(r.y0, bounds.y0),
+                      std::max(r.x1, bounds.x1), std::max(r.y1, bounds.y1)};
+        regions.assign(1, bounds);
+    }
+}
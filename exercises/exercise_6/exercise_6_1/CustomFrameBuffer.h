@@ -5,8 +5,11 @@
 #ifndef ITU_GRAPHICS_PROGRAMMING_CUSTOMFRAMEBUFFER_H
 #define ITU_GRAPHICS_PROGRAMMING_CUSTOMFRAMEBUFFER_H
 
+#include <assert.h>
+#include <algorithm>
 #include <cstdint>
 #include <stdlib.h>
+#include <vector>
 
 namespace Colors{
     // colors are 32 bits unsigned ints, so it is easy to upload to the GPU as a texture
@@ -20,6 +23,22 @@ namespace Colors{
     const color blue  = 0xFFFF0000;
     const color green = 0xFF00FF00;
     const color red   = 0xFF0000FF;
+
+    // packs color channels in the [0, 1] range
+    inline color fromFloats(float r, float g, float b, float a = 1.f){
+        auto channel = [](float c) { return (color) (c <= 0.f ? 0.f : (c >= 1.f ? 255.f : c * 255.f + .5f)); };
+        return channel(a) << 24 | channel(b) << 16 | channel(g) << 8 | channel(r);
+    }
+
+    // blends two colors channel by channel, t = 0 gives a and t = 1 gives b
+    inline color mix(color a, color b, float t){
+        color result = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            float ca = (float) ((a >> shift) & 0xFF), cb = (float) ((b >> shift) & 0xFF);
+            result |= (color) (ca + (cb - ca) * t + .5f) << shift;
+        }
+        return result;
+    }
 }
 
 
@@ -27,17 +46,105 @@ class CustomFrameBuffer {
 public:
     // solid paints in a 3x3 range, center paints only the pixel in the center, cross don't paint the corners
     enum fill {solid, cross, center, checkboard, frame};
+    // a rectangle of pixels (not of 3x3 ranges), x0 ... x1 - 1 and y0 ... y1 - 1
+    struct rect {
+        uint32_t x0, y0, x1, y1;
+    };
+    // damaged regions are kept disjoint, beyond this count they are merged into their bounding box
+    static const size_t MAX_REGIONS = 8;
     uint32_t W = 16;
     uint32_t H = 16;
-    Colors::color *buffer;
+    Colors::color *buffer = nullptr;
+    // one depth value per pixel (not per 3x3 range), 0 is the near and 1 the far plane
+    float *depth = nullptr;
 
     CustomFrameBuffer(uint32_t width, uint32_t height);
     ~CustomFrameBuffer();
 
-    void clearBuffer(Colors::color col = Colors::black);
+    void clearBuffer(Colors::color col = Colors::black) { clearBuffer(col, col); }
+    // clears to a grid, the center of each 3x3 range to col and the rest of it (fill::frame) to gridCol
+    void clearBuffer(Colors::color col, Colors::color gridCol);
+    void clearDepth(float value = 1.f);
+    // depth test (less) of a pixel, it stores z and returns true if z is closer than the stored depth
+    bool depthTest(uint32_t x, uint32_t y, float z);
     void paintAt(uint32_t x, uint32_t y, Colors::color col, fill fillOption = fill::center);
+    // paints the pixels xBegin ... xEnd - 1 of row y, with a single range check for the whole span
+    void paintSpan(uint32_t y, uint32_t xBegin, uint32_t xEnd, Colors::color col, fill fillOption = fill::center);
+    // the same, specialized on the fill option at compile time, so there is no branch on it per pixel.
+    // the ones above pick the specialization once per call. paintAt<F> is a bare write, it does not mark the
+    // damage: its callers paint many pixels and mark their bounding box once
+    template <fill F> void paintAt(uint32_t x, uint32_t y, Colors::color col);
+    template <fill F> void paintSpan(uint32_t y, uint32_t xBegin, uint32_t xEnd, Colors::color col);
+
+    // the 3x3 range painted by a fill option, bit (i + 1) + (j + 1) * 3 is set if the offset (i, j) is painted
+    static constexpr uint32_t fillPattern(fill fillOption){
+        return fillOption == fill::solid ? 0x1FF :      // all of them
+               fillOption == fill::cross ? 0x0BA :      // |i| + |j| <= 1
+               fillOption == fill::checkboard ? 0x0AA : // |i| + |j| == 1
+               fillOption == fill::frame ? 0x1EF :      // all but the center
+               0x010;                                   // only the center
+    }
+
+    // regions changed since the last clearDamage(), e.g. the ones to upload to the GPU.
+    // paintAt, paintSpan and clearBuffer track them, paintAt<F> and direct writes to buffer must call markDamaged
+    const std::vector<rect> &damagedRegions() const { return damage; }
+    bool isDamaged() const { return !damage.empty(); }
+    void markDamaged(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+    void clearDamage();
+
+private:
+    // adds a rectangle to a list of disjoint rectangles, merging the ones it touches
+    static void addRegion(std::vector<rect> &regions, rect region);
+    // writes the clear colors to a region
+    void clearRegion(const rect &region);
+
+    std::vector<rect> damage;
+    // regions painted since the last clearBuffer, the next clear only needs to restore them
+    std::vector<rect> painted;
+    Colors::color clearColor = Colors::black;
+    Colors::color gridColor = Colors::black;
+    bool cleared = false;
 
 };
 
 
+template <CustomFrameBuffer::fill F>
+void CustomFrameBuffer::paintAt(uint32_t x, uint32_t y, Colors::color col){
+    assert (x < W && y < H); // ensure valid position, crash if not (sooo dramatic!)
+
+    // location of the center pixel in the buffer, the pattern is a constant so the loops unroll to its writes
+    Colors::color *center = buffer + (x * 3 + 1) + (y * 3 + 1) * W * 3;
+    const uint32_t pattern = fillPattern(F);
+    for (int j = -1; j <= 1; j++)
+        for (int i = -1; i <= 1; i++)
+            if (pattern & (1u << ((i + 1) + (j + 1) * 3)))
+                center[j * 3 * (int) W + i] = col;
+}
+
+template <CustomFrameBuffer::fill F>
+void CustomFrameBuffer::paintSpan(uint32_t y, uint32_t xBegin, uint32_t xEnd, Colors::color col){
+    assert (y < H && xBegin <= xEnd && xEnd <= W); // ensure valid span, once for all its pixels
+    uint32_t count = xEnd - xBegin;
+    if (count == 0)
+        return;
+    markDamaged(xBegin, y, xEnd, y + 1);
+
+    // the span covers 3 rows of the buffer, each pixel of the span is 3 consecutive values in each of them
+    const uint32_t pattern = fillPattern(F);
+    for (int j = -1; j <= 1; j++) {
+        const uint32_t painted = (pattern >> ((j + 1) * 3)) & 7;
+        Colors::color *row = buffer + (y * 3 + 1 + j) * W * 3 + xBegin * 3;
+        if (painted == 7) {
+            // the whole row of each 3x3 range is painted, so this is a single contiguous write
+            std::fill_n(row, count * 3, col);
+        } else if (painted != 0) {
+            for (uint32_t k = 0; k < count; k++)
+                for (int i = 0; i < 3; i++)
+                    if (painted & (1u << i))
+                        row[k * 3 + i] = col;
+        }
+    }
+}
+
+
 #endif //ITU_GRAPHICS_PROGRAMMING_CUSTOMFRAMEBUFFER_H
\ No newline at end of file
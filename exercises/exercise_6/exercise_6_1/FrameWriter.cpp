@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <stdexcept>
+#include "FrameWriter.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+    uint8_t red(Colors::color c) { return c & 0xFF; }
+    uint8_t green(Colors::color c) { return (c >> 8) & 0xFF; }
+    uint8_t blue(Colors::color c) { return (c >> 16) & 0xFF; }
+    uint8_t alpha(Colors::color c) { return (c >> 24) & 0xFF; }
+
+    void appendBigEndian(std::vector<uint8_t> &bytes, uint32_t value){
+        for (int shift = 24; shift >= 0; shift -= 8)
+            bytes.push_back((value >> shift) & 0xFF);
+    }
+
+    void appendString(std::vector<uint8_t> &bytes, const std::string &text){
+        bytes.insert(bytes.end(), text.begin(), text.end());
+    }
+
+    uint32_t crc32(const uint8_t *data, size_t size){
+        static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> entries(256);
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[n] = c;
+            }
+            return entries;
+        }();
+        uint32_t c = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++)
+            c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    uint32_t adler32(const uint8_t *data, size_t size){
+        uint32_t a = 1, b = 0;
+        for (size_t i = 0; i < size; i++) {
+            a = (a + data[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        return b << 16 | a;
+    }
+
+    // appends a png chunk: length, type, data and the crc of type and data
+    void appendChunk(std::vector<uint8_t> &bytes, const char *type, const std::vector<uint8_t> &data){
+        appendBigEndian(bytes, (uint32_t) data.size());
+        size_t start = bytes.size();
+        appendString(bytes, type);
+        bytes.insert(bytes.end(), data.begin(), data.end());
+        appendBigEndian(bytes, crc32(bytes.data() + start, bytes.size() - start));
+    }
+}
+
+FrameWriter::FrameWriter(format fileFormat, const std::string &output, uint32_t width, uint32_t height, uint32_t fps)
+        : fileFormat(fileFormat), output(output), width(width), height(height), fps(fps){
+    size_t percent = output.find('%');
+    perFrameFiles = percent != std::string::npos;
+    if (perFrameFiles) {
+        // the frame number is put in the name here, the pattern is never given to printf
+        size_t end = percent + 1;
+        if (end < output.size() && output[end] == '0') {
+            numberPad = '0';
+            end++;
+        }
+        size_t digits = end;
+        while (end < output.size() && end - digits < 2 && output[end] >= '0' && output[end] <= '9')
+            numberWidth = numberWidth * 10 + (output[end++] - '0');
+        if (end >= output.size() || output[end] != 'd' || output.find('%', end) != std::string::npos)
+            throw std::runtime_error("FrameWriter::FrameWriter(): The pattern " + output +
+                                     " needs a single %d, %Nd or %0Nd and no other %");
+        namePrefix = output.substr(0, percent);
+        nameSuffix = output.substr(end + 1);
+    } else {
+        if (output == "-") {
+            stream = stdout;
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY); // no newline translation in the image data
+#endif
+        } else {
+            stream = fopen(output.c_str(), "wb");
+        }
+        if (stream == nullptr)
+            throw std::runtime_error("FrameWriter::FrameWriter(): Could not open " + output);
+    }
+    writer = std::thread(&FrameWriter::writerLoop, this);
+}
+
+FrameWriter::~FrameWriter(){
+    flush();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+    if (stream != nullptr && stream != stdout)
+        fclose(stream);
+}
+
+void FrameWriter::write(const Colors::color *pixels){
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this] { return !backFull || failed; });
+    if (failed)
+        throw std::runtime_error("FrameWriter::write(): Could not write to " + output);
+    back.assign(pixels, pixels + width * height);
+    backFull = true;
+    guard.unlock();
+    changed.notify_all();
+}
+
+void FrameWriter::flush(){
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this] { return (!backFull && !writing) || failed; });
+    if (stream != nullptr)
+        fflush(stream);
+}
+
+bool FrameWriter::parseFormat(const std::string &name, format &fileFormat){
+    const char *names[] = {"ppm", "png", "rgba", "y4m"};
+    for (int i = 0; i < 4; i++) {
+        if (name == names[i]) {
+            fileFormat = (format) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameWriter::writerLoop(){
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        changed.wait(guard, [this] { return backFull || stopping; });
+        if (!backFull)
+            return; // stopping, and every frame is written
+
+        // take the frame, so write() can fill the back buffer while this one is encoded
+        std::swap(front, back);
+        backFull = false;
+        writing = true;
+        uint32_t number = frameCount++;
+        guard.unlock();
+        changed.notify_all();
+
+        bool written = writeFrame(front, number);
+
+        guard.lock();
+        writing = false;
+        failed = failed || !written;
+        changed.notify_all();
+    }
+}
+
+bool FrameWriter::writeFrame(const std::vector<Colors::color> &pixels, uint32_t number){
+    bytes.clear();
+    switch (fileFormat) {
+        case ppm: encodePPM(pixels); break;
+        case png: encodePNG(pixels); break;
+        case rgba: encodeRGBA(pixels); break;
+        case y4m:
+            // the sequence header goes before the first frame of each stream
+            if (perFrameFiles || number == 0)
+                appendString(bytes, "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) +
+                                    " F" + std::to_string(fps) + ":1 Ip A1:1 C444\n");
+            encodeY4M(pixels);
+            break;
+    }
+
+    FILE *file = stream;
+    if (perFrameFiles) {
+        std::string digits = std::to_string(number);
+        if (digits.size() < numberWidth)
+            digits.insert(0, numberWidth - digits.size(), numberPad);
+        file = fopen((namePrefix + digits + nameSuffix).c_str(), "wb");
+        if (file == nullptr)
+            return false;
+    }
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    if (perFrameFiles)
+        written = fclose(file) == 0 && written;
+    return written;
+}
+
+// the buffer starts at the bottom row, the images at the top row
+void FrameWriter::encodePPM(const std::vector<Colors::color> &pixels){
+    appendString(bytes, "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n");
+    for (uint32_t y = height; y-- > 0; ) {
+        const Colors::color *row = &pixels[y * width];
+        for (uint32_t x = 0; x < width; x++) {
+            bytes.push_back(red(row[x]));
+            bytes.push_back(green(row[x]));
+            bytes.push_back(blue(row[x]));
+        }
+    }
+}
+
+void FrameWriter::encodePNG(const std::vector<Colors::color> &pixels){
+    // filter type 0 (none) and the RGB values of each row
+    std::vector<uint8_t> image;
+    image.reserve(height * (width * 3 + 1));
+    for (uint32_t y = height; y-- > 0; ) {
+        const Colors::color *row = &pixels[y * width];
+        image.push_back(0);
+        for (uint32_t x = 0; x < width; x++) {
+            image.push_back(red(row[x]));
+            image.push_back(green(row[x]));
+            image.push_back(blue(row[x]));
+        }
+    }
+
+    // zlib stream of stored (not compressed) deflate blocks, encoding speed matters more than file size
+    std::vector<uint8_t> data = {0x78, 0x01};
+    size_t offset = 0;
+    do {
+        size_t size = std::min<size_t>(image.size() - offset, 65535);
+        bool last = offset + size == image.size();
+        data.push_back(last ? 1 : 0);
+        data.push_back(size & 0xFF);
+        data.push_back(size >> 8);
+        data.push_back(~size & 0xFF);
+        data.push_back((~size >> 8) & 0xFF);
+        data.insert(data.end(), image.begin() + offset, image.begin() + offset + size);
+        offset += size;
+    } while (offset < image.size());
+    appendBigEndian(data, adler32(image.data(), image.size()));
+
+    // width, height, 8 bits per channel, RGB, default compression, filter and no interlacing
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+
+    const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    bytes.insert(bytes.end(), signature, signature + 8);
+    appendChunk(bytes, "IHDR", header);
+    appendChunk(bytes, "IDAT", data);
+    appendChunk(bytes, "IEND", {});
+}
+
+void FrameWriter::encodeRGBA(const std::vector<Colors::color> &pixels){
+    for (uint32_t y = height; y-- > 0; ) {
+        const Colors::color *row = &pixels[y * width];
+        for (uint32_t x = 0; x < width; x++) {
+            bytes.push_back(red(row[x]));
+            bytes.push_back(green(row[x]));
+            bytes.push_back(blue(row[x]));
+            bytes.push_back(alpha(row[x]));
+        }
+    }
+}
+
+void FrameWriter::encodeY4M(const std::vector<Colors::color> &pixels){
+    appendString(bytes, "FRAME\n");
+    // full resolution Y, U and V planes, BT.601 studio range
+    size_t planeSize = (size_t) width * height;
+    size_t start = bytes.size();
+    bytes.resize(start + planeSize * 3);
+    uint8_t *planeY = &bytes[start], *planeU = planeY + planeSize, *planeV = planeU + planeSize;
+    for (uint32_t y = height; y-- > 0; ) {
+        const Colors::color *row = &pixels[y * width];
+        for (uint32_t x = 0; x < width; x++) {
+            int r = red(row[x]), g = green(row[x]), b = blue(row[x]);
+            *planeY++ = (uint8_t) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            *planeU++ = (uint8_t) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            *planeV++ = (uint8_t) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
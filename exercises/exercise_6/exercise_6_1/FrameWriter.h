@@ -0,0 +1,68 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_FRAMEWRITER_H
+#define ITU_GRAPHICS_PROGRAMMING_FRAMEWRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CustomFrameBuffer.h"
+
+// writes the frames rendered to a CustomFrameBuffer as image files, or as a stream, without an OpenGL context.
+// frames are double buffered: write() copies the frame and returns, and a writer thread encodes it while the
+// next frame is rasterized.
+class FrameWriter {
+public:
+    // ppm (binary RGB), png (RGB, uncompressed), rgba (raw bytes, no header), y4m (4:4:4 video sequence)
+    enum format {ppm, png, rgba, y4m};
+
+    // output is a file name, "-" for stdout, or a pattern with a frame number (e.g. "frame_%05d.png"), which
+    // writes one file per frame. the pattern has a single %d, %Nd or %0Nd, and no other %; any other throws.
+    // without a pattern, all the frames are appended to the same stream.
+    // width and height are the size of the color buffer (3 times the size of the CustomFrameBuffer)
+    FrameWriter(format fileFormat, const std::string &output, uint32_t width, uint32_t height, uint32_t fps = 60);
+    ~FrameWriter();
+
+    // copies the frame, it blocks only while the writer thread is still busy with the frame before
+    void write(const Colors::color *pixels);
+    // waits until all the frames are written
+    void flush();
+
+    // format from its name, returns false if the name is unknown
+    static bool parseFormat(const std::string &name, format &fileFormat);
+
+private:
+    void writerLoop();
+    bool writeFrame(const std::vector<Colors::color> &pixels, uint32_t number);
+    void encodePPM(const std::vector<Colors::color> &pixels);
+    void encodePNG(const std::vector<Colors::color> &pixels);
+    void encodeRGBA(const std::vector<Colors::color> &pixels);
+    void encodeY4M(const std::vector<Colors::color> &pixels);
+
+    format fileFormat;
+    std::string output;
+    bool perFrameFiles;
+    // the file name of a frame is namePrefix, the frame number padded to numberWidth with numberPad, and nameSuffix
+    std::string namePrefix, nameSuffix;
+    size_t numberWidth = 0;
+    char numberPad = ' ';
+    uint32_t width, height, fps;
+    FILE *stream = nullptr;
+
+    // encoded bytes of the current frame
+    std::vector<uint8_t> bytes;
+
+    // front is encoded by the writer thread, back is filled by write()
+    std::vector<Colors::color> front, back;
+    bool backFull = false, writing = false, stopping = false, failed = false;
+    uint32_t frameCount = 0;
+    std::mutex lock;
+    std::condition_variable changed;
+    std::thread writer;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_FRAMEWRITER_H
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <assert.h>
+#include <stdexcept>
+#include "MultisampleBuffer.h"
+
+MultisampleBuffer::MultisampleBuffer(uint32_t width, uint32_t height, uint32_t samples)
+        : W(width), H(height), samples(samples){
+    if (samples != 2 && samples != 4 && samples != 8)
+        throw std::runtime_error("MultisampleBuffer::MultisampleBuffer(): Only 2, 4 or 8 samples are supported");
+    colors.resize(W * H * samples);
+    depths.resize(W * H * samples, 1.f);
+    written.resize(W * H, 0);
+    bounds = {0, 0, W, H};
+    clear();
+}
+
+void MultisampleBuffer::clear(float depthValue){
+    for (uint32_t y = bounds.y0; y < bounds.y1; y++) {
+        std::fill_n(written.begin() + y * W + bounds.x0, bounds.x1 - bounds.x0, 0);
+        std::fill_n(depths.begin() + (y * W + bounds.x0) * samples, (bounds.x1 - bounds.x0) * samples, depthValue);
+    }
+    bounds = {W, H, 0, 0};
+}
+
+bool MultisampleBuffer::depthTest(uint32_t x, uint32_t y, uint32_t sample, float z){
+    assert (x < W && y < H && sample < samples);
+    float &stored = depths[(x + y * W) * samples + sample];
+    if (z >= stored)
+        return false;
+    stored = z;
+    return true;
+}
+
+float MultisampleBuffer::farthestDepth(uint32_t x, uint32_t y) const{
+    assert (x < W && y < H);
+    const float *pixel = &depths[(x + y * W) * samples];
+    return *std::max_element(pixel, pixel + samples);
+}
+
+void MultisampleBuffer::writeSamples(uint32_t x, uint32_t y, uint32_t mask, Colors::color col){
+    assert (x < W && y < H);
+    Colors::color *pixel = &colors[(x + y * W) * samples];
+    for (uint32_t s = 0; s < samples; s++)
+        if (mask & (1u << s))
+            pixel[s] = col;
+    written[x + y * W] |= (uint8_t) mask;
+    bounds = {std::min(bounds.x0, x), std::min(bounds.y0, y), std::max(bounds.x1, x + 1), std::max(bounds.y1, y + 1)};
+}
+
+void MultisampleBuffer::resolve(CustomFrameBuffer &target) const{
+    assert (target.W == W && target.H == H);
+    if (bounds.x0 >= bounds.x1 || bounds.y0 >= bounds.y1)
+        return;
+    // the pixels are painted without tracking the damage, the bounds of the written samples cover them
+    target.markDamaged(bounds.x0, bounds.y0, bounds.x1, bounds.y1);
+    for (uint32_t y = bounds.y0; y < bounds.y1; y++) {
+        for (uint32_t x = bounds.x0; x < bounds.x1; x++) {
+            uint32_t mask = written[x + y * W];
+            if (mask == 0)
+                continue;
+            // the samples that were not written keep the color of the frame buffer (the center of the 3x3 range)
+            Colors::color background = target.buffer[(x * 3 + 1) + (y * 3 + 1) * W * 3];
+            const Colors::color *pixel = &colors[(x + y * W) * samples];
+            uint32_t sum[4] = {0, 0, 0, 0};
+            for (uint32_t s = 0; s < samples; s++) {
+                Colors::color col = (mask & (1u << s)) ? pixel[s] : background;
+                for (int c = 0; c < 4; c++)
+                    sum[c] += (col >> (c * 8)) & 0xFF;
+            }
+            Colors::color average = 0;
+            for (int c = 0; c < 4; c++)
+                average |= ((sum[c] + samples / 2) / samples) << (c * 8);
+            target.paintAt<CustomFrameBuffer::fill::solid>(x, y, average);
+        }
+    }
+}
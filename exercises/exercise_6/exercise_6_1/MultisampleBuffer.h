@@ -0,0 +1,41 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_MULTISAMPLEBUFFER_H
+#define ITU_GRAPHICS_PROGRAMMING_MULTISAMPLEBUFFER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CustomFrameBuffer.h"
+
+// color and depth of 2, 4 or 8 samples per pixel, for multisample anti-aliasing with the software pipeline.
+// triangles write the samples they cover, and resolve() averages them into a CustomFrameBuffer. the samples
+// that were never written take the color already in the frame buffer, so the edges blend with its content.
+class MultisampleBuffer {
+public:
+    // the samples are the standard pattern of halfspace_rasterizer::sample_pattern(samples)
+    MultisampleBuffer(uint32_t width, uint32_t height, uint32_t samples);
+
+    // marks all the samples as not written and resets their depth, it only touches the pixels written since
+    // the last clear
+    void clear(float depthValue = 1.f);
+    // depth test (less) of a sample, it stores z and returns true if z is closer than the stored depth
+    bool depthTest(uint32_t x, uint32_t y, uint32_t sample, float z);
+    // the farthest depth of the samples of a pixel
+    float farthestDepth(uint32_t x, uint32_t y) const;
+    // writes a color to the samples of a pixel, bit i of mask selects sample i
+    void writeSamples(uint32_t x, uint32_t y, uint32_t mask, Colors::color col);
+    // paints the average of the samples of each written pixel into target, the other pixels are left as they are
+    void resolve(CustomFrameBuffer &target) const;
+
+    uint32_t W, H;
+    uint32_t samples;
+
+private:
+    std::vector<Colors::color> colors; // samples consecutive values per pixel
+    std::vector<float> depths;
+    std::vector<uint8_t> written; // mask of the written samples of each pixel
+    // bounding box of the written pixels, x0 ... x1 - 1 and y0 ... y1 - 1
+    CustomFrameBuffer::rect bounds;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_MULTISAMPLEBUFFER_H
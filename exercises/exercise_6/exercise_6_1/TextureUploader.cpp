@@ -0,0 +1,95 @@
+#include <cstring>
+#include <stdexcept>
+#include "TextureUploader.h"
+
+TextureUploader::TextureUploader(const CustomFrameBuffer &frameBuffer, unsigned int ringSize)
+        : width(frameBuffer.W * 3), height(frameBuffer.H * 3){
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // set the texture wrapping parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    // set texture filtering parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // storage only, the first upload fills it (the whole buffer is damaged after it is created)
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    // every pixel buffer can hold a whole frame, the damaged regions never overlap
+    pixelBuffers.resize(ringSize);
+    fences.assign(ringSize, nullptr);
+    glGenBuffers(ringSize, pixelBuffers.data());
+    for (unsigned int pixelBuffer : pixelBuffers) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, width * height * sizeof(Colors::color), nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureUploader::~TextureUploader(){
+    for (GLsync fence : fences)
+        if (fence != nullptr)
+            glDeleteSync(fence);
+    glDeleteBuffers((GLsizei) pixelBuffers.size(), pixelBuffers.data());
+    glDeleteTextures(1, &texture);
+}
+
+bool TextureUploader::upload(CustomFrameBuffer &frameBuffer){
+    if (!frameBuffer.isDamaged())
+        return false;
+
+    const std::vector<CustomFrameBuffer::rect> &regions = frameBuffer.damagedRegions();
+    size_t size = 0;
+    for (const CustomFrameBuffer::rect &r : regions)
+        size += (r.x1 - r.x0) * (r.y1 - r.y0) * 9 * sizeof(Colors::color);
+
+    unsigned int slot = nextSlot;
+    nextSlot = (nextSlot + 1) % pixelBuffers.size();
+    waitForSlot(slot);
+
+    // the fence guarantees that the GPU is not reading this buffer anymore, so it is mapped unsynchronized
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[slot]);
+    auto *staging = (uint8_t *) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (staging == nullptr) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        throw std::runtime_error("TextureUploader::upload(): Could not map the pixel unpack buffer");
+    }
+
+    // pack the rows of every region one after the other ...
+    size_t offset = 0;
+    for (const CustomFrameBuffer::rect &r : regions) {
+        size_t rowSize = (r.x1 - r.x0) * 3 * sizeof(Colors::color);
+        for (uint32_t y = r.y0 * 3; y < r.y1 * 3; y++) {
+            memcpy(staging + offset, frameBuffer.buffer + y * width + r.x0 * 3, rowSize);
+            offset += rowSize;
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // ... and copy them to the texture, reading from the pixel buffer (the pointer is an offset in it)
+    glBindTexture(GL_TEXTURE_2D, texture);
+    offset = 0;
+    for (const CustomFrameBuffer::rect &r : regions) {
+        GLsizei regionWidth = (r.x1 - r.x0) * 3, regionHeight = (r.y1 - r.y0) * 3;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0 * 3, r.y0 * 3, regionWidth, regionHeight, GL_RGBA, GL_UNSIGNED_BYTE,
+                        (const void *) offset);
+        offset += regionWidth * regionHeight * sizeof(Colors::color);
+    }
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    frameBuffer.clearDamage();
+    return true;
+}
+
+void TextureUploader::waitForSlot(unsigned int slot){
+    if (fences[slot] == nullptr)
+        return;
+    // flush on the first wait, so the fence is guaranteed to signal
+    GLenum result = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fences[slot], 0, 1000000000);
+    glDeleteSync(fences[slot]);
+    fences[slot] = nullptr;
+}
@@ -0,0 +1,35 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_TEXTUREUPLOADER_H
+#define ITU_GRAPHICS_PROGRAMMING_TEXTUREUPLOADER_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+#include "CustomFrameBuffer.h"
+
+// keeps a texture in sync with a CustomFrameBuffer, uploading only its damaged regions.
+// the pixels are staged in a ring of pixel unpack buffers, so the copy of a frame does not wait for the GPU
+// to finish reading the previous ones: a buffer is reused only after the fence of its last upload signals.
+class TextureUploader {
+public:
+    // allocates the texture once (uploads update it in place) and ringSize pixel unpack buffers
+    TextureUploader(const CustomFrameBuffer &frameBuffer, unsigned int ringSize = 3);
+    ~TextureUploader();
+
+    // uploads the damaged regions and clears the damage of the frame buffer, false if nothing changed
+    bool upload(CustomFrameBuffer &frameBuffer);
+
+    unsigned int texture = 0;
+
+private:
+    // waits until the GPU is done with the pixel buffer of a ring slot
+    void waitForSlot(unsigned int slot);
+
+    uint32_t width, height; // in texels, 3 times the size of the frame buffer
+    std::vector<unsigned int> pixelBuffers;
+    std::vector<GLsync> fences;
+    unsigned int nextSlot = 0;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_TEXTUREUPLOADER_H
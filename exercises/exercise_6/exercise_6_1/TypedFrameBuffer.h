@@ -0,0 +1,163 @@
+#ifndef ITU_GRAPHICS_PROGRAMMING_TYPEDFRAMEBUFFER_H
+#define ITU_GRAPHICS_PROGRAMMING_TYPEDFRAMEBUFFER_H
+
+#include <algorithm>
+#include <assert.h>
+#include <cstdint>
+#include <vector>
+
+#include "CustomFrameBuffer.h"
+
+// pixel formats: how a value (a Colors::color or a float) is stored, and how it is shown
+namespace Formats{
+    // 8 bits per channel, the same as Colors::color
+    struct RGBA8 {
+        typedef Colors::color value;
+        typedef uint32_t storage;
+        static storage pack(value v) { return v; }
+        static value unpack(storage s) { return s; }
+        static Colors::color toColor(storage s) { return s; }
+    };
+
+    // 5 bits red, 6 bits green, 5 bits blue, half the memory of RGBA8
+    struct RGB565 {
+        typedef Colors::color value;
+        typedef uint16_t storage;
+        static storage pack(value v) {
+            return (storage) (((v & 0xF8) << 8) | ((v >> 5) & 0x07E0) | ((v >> 19) & 0x1F));
+        }
+        static value unpack(storage s) {
+            // replicate the high bits into the low ones, so 0 and the maximum map to 0 and 255
+            uint32_t r = (s >> 11) & 0x1F, g = (s >> 5) & 0x3F, b = s & 0x1F;
+            r = (r << 3) | (r >> 2); g = (g << 2) | (g >> 4); b = (b << 3) | (b >> 2);
+            return 0xFF000000 | b << 16 | g << 8 | r;
+        }
+        static Colors::color toColor(storage s) { return unpack(s); }
+    };
+
+    // a single float channel, shown as grey levels of the [0, 1] range
+    struct R32F {
+        typedef float value;
+        typedef float storage;
+        static storage pack(value v) { return v; }
+        static value unpack(storage s) { return s; }
+        static Colors::color toColor(storage s) { return Colors::fromFloats(s, s, s); }
+    };
+
+    // 24 bits fixed point depth in the [0, 1] range, shown as grey levels (near is dark). a float has 24 bits
+    // of mantissa too, so the conversions are done in double, or a packed depth would not unpack to itself
+    struct Depth24 {
+        typedef float value;
+        typedef uint32_t storage;
+        static const uint32_t MAX = 0xFFFFFF;
+        static storage pack(value v) { return v <= 0.f ? 0 : (v >= 1.f ? MAX : (storage) (v * (double) MAX + .5)); }
+        static value unpack(storage s) { return (float) ((double) s / MAX); }
+        static Colors::color toColor(storage s) { uint32_t c = s >> 16; return 0xFF000000 | c << 16 | c << 8 | c; }
+    };
+}
+
+// memory layouts: where pixel (x, y) is stored, for a buffer padded to the layout size
+namespace Layouts{
+    // row after row
+    struct Linear {
+        static const uint32_t TILE = 1;
+        static uint32_t index(uint32_t x, uint32_t y, uint32_t paddedWidth) { return x + y * paddedWidth; }
+    };
+
+    // 8x8 tiles stored row after row, and the pixels of a tile in Morton (z) order. a tile of RGBA8 is 4 cache
+    // lines, and square regions (e.g. the bins of the tiled rasterizer) touch only their own tiles
+    struct Tiled {
+        static const uint32_t TILE = 8;
+        static uint32_t index(uint32_t x, uint32_t y, uint32_t paddedWidth) {
+            uint32_t tile = (y >> 3) * (paddedWidth >> 3) + (x >> 3);
+            return tile << 6 | interleave(x & 7) | interleave(y & 7) << 1;
+        }
+        // spreads 3 bits to the even bits: abc -> a0b0c
+        static uint32_t interleave(uint32_t v) { return (v & 1) | (v & 2) << 1 | (v & 4) << 2; }
+    };
+}
+
+// a frame buffer of one pixel per value (no 3x3 magnified pixels), with a selectable format and layout.
+// toColors() converts it to a linear Colors::color image (detiling if needed) to present it or write it
+// out with FrameWriter. pixel (0, 0) is the bottom left, as in CustomFrameBuffer
+template <typename Format, typename Layout = Layouts::Linear>
+class TypedFrameBuffer {
+public:
+    typedef typename Format::value value;
+    typedef typename Format::storage storage;
+
+    const uint32_t W;
+    const uint32_t H;
+
+    TypedFrameBuffer(uint32_t width, uint32_t height)
+            : W(width), H(height), paddedW(padded(width)), paddedH(padded(height)),
+              data((size_t) padded(width) * padded(height)) {}
+
+    void clear(value v) { std::fill(data.begin(), data.end(), Format::pack(v)); }
+
+    void set(uint32_t x, uint32_t y, value v) {
+        assert (x < W && y < H);
+        data[Layout::index(x, y, paddedW)] = Format::pack(v);
+    }
+
+    value get(uint32_t x, uint32_t y) const {
+        assert (x < W && y < H);
+        return Format::unpack(data[Layout::index(x, y, paddedW)]);
+    }
+
+    // paints the pixels xBegin ... xEnd - 1 of row y
+    void setSpan(uint32_t y, uint32_t xBegin, uint32_t xEnd, value v) {
+        assert (y < H && xBegin <= xEnd && xEnd <= W);
+        storage s = Format::pack(v);
+        if (Layout::TILE == 1) {
+            std::fill_n(&data[Layout::index(xBegin, y, paddedW)], xEnd - xBegin, s);
+            return;
+        }
+        for (uint32_t x = xBegin; x < xEnd; x++)
+            data[Layout::index(x, y, paddedW)] = s;
+    }
+
+    // depth test (less) for the formats of float values, stores v and returns true if it is closer
+    bool depthTest(uint32_t x, uint32_t y, value v) {
+        assert (x < W && y < H);
+        storage &stored = data[Layout::index(x, y, paddedW)];
+        storage s = Format::pack(v);
+        if (s >= stored)
+            return false;
+        stored = s;
+        return true;
+    }
+
+    // writes W * H colors, row after row starting at the bottom
+    void toColors(Colors::color *out) const {
+        if (Layout::TILE == 1) {
+            for (uint32_t y = 0; y < H; y++)
+                std::transform(&data[y * paddedW], &data[y * paddedW] + W, out + y * W, Format::toColor);
+            return;
+        }
+        // detile one tile at a time, reading it sequentially
+        const uint32_t T = Layout::TILE;
+        for (uint32_t ty = 0; ty < paddedH; ty += T) {
+            for (uint32_t tx = 0; tx < paddedW; tx += T) {
+                const storage *tile = &data[Layout::index(tx, ty, paddedW)];
+                uint32_t xEnd = std::min(T, W - std::min(W, tx)), yEnd = std::min(T, H - std::min(H, ty));
+                for (uint32_t y = 0; y < yEnd; y++)
+                    for (uint32_t x = 0; x < xEnd; x++)
+                        out[(ty + y) * W + tx + x] = Format::toColor(tile[Layout::index(x, y, T)]);
+            }
+        }
+    }
+
+    // the raw storage, in the order of the layout
+    const std::vector<storage> &storageData() const { return data; }
+
+private:
+    static uint32_t padded(uint32_t size) { return (size + Layout::TILE - 1) / Layout::TILE * Layout::TILE; }
+
+    const uint32_t paddedW;
+    const uint32_t paddedH;
+    std::vector<storage> data;
+};
+
+
+#endif //ITU_GRAPHICS_PROGRAMMING_TYPEDFRAMEBUFFER_H
@@ -0,0 +1,400 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define HAS_CYCLE_COUNTER 1
+#else
+#define HAS_CYCLE_COUNTER 0
+#endif
+
+#include <glm/glm.hpp>
+
+#include "linerasterizer.h"
+#include "polylinerasterizer.h"
+#include "edgerasterizer.h"
+#include "trianglerasterizer.h"
+#include "halfspacerasterizer.h"
+#include "tiledrasterizer.h"
+#include "TypedFrameBuffer.h"
+
+// Standalone microbenchmark of the rasterizers of exercise 6. It generates reproducible random workloads
+// (same seed, same primitives), runs every engine on the workloads it supports several times, keeps the
+// fastest run, and reports fragments/sec, primitives/sec, cycles/fragment and the heap allocations made
+// while rasterizing. Use --json to write the results in a file that can be compared across commits.
+
+
+// count every allocation made through operator new (std::vector, std::function, ...)
+// ---------------------------------------------------------------------------------
+static std::atomic<unsigned long long> allocationCount(0);
+static std::atomic<unsigned long long> allocatedBytes(0);
+
+void *operator new(size_t size){
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+void *operator new[](size_t size){ return operator new(size); }
+void operator delete(void *p) noexcept{ free(p); }
+void operator delete[](void *p) noexcept{ free(p); }
+void operator delete(void *p, size_t) noexcept{ free(p); }
+void operator delete[](void *p, size_t) noexcept{ free(p); }
+
+
+uint64_t readCycles(){
+#if HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+
+// workloads: vertices of lines or edges (2 per primitive) or triangles (3 per primitive)
+// ---------------------------------------------------------------------------------
+enum Primitive {line, edge, triangle};
+
+struct Workload {
+    std::string name;
+    Primitive primitive;
+    int verticesPerPrimitive;
+    std::vector<glm::ivec2> vertices;
+};
+
+struct Settings {
+    unsigned int seed = 1;
+    int repeat = 5;
+    float scale = 1.f; // multiplies the number of primitives of every workload
+    int size = 1024;   // width and height of the screen the primitives are generated in
+    std::string json;
+};
+
+std::vector<Workload> makeWorkloads(const Settings &settings){
+    std::mt19937 random(settings.seed);
+    auto coordinate = [&](int low, int high) { return std::uniform_int_distribution<int>(low, high)(random); };
+    auto count = [&](int n) { return std::max(1, (int) (n * settings.scale)); };
+    int s = settings.size;
+    std::vector<Workload> workloads;
+
+    // long lines, cycling through the 8 octants
+    Workload lines = {"lines_all_octants", line, 2, {}};
+    for (int i = 0, n = count(20000); i < n; i++) {
+        float angle = (i % 8 + std::uniform_real_distribution<float>(.05f, .95f)(random)) * 3.14159265f / 4.f;
+        float length = s * .4f;
+        glm::ivec2 center(coordinate(s / 2 - s / 10, s / 2 + s / 10), coordinate(s / 2 - s / 10, s / 2 + s / 10));
+        glm::ivec2 end(center.x + (int) std::lround(std::cos(angle) * length),
+                       center.y + (int) std::lround(std::sin(angle) * length));
+        lines.vertices.push_back(center);
+        lines.vertices.push_back(end);
+    }
+    workloads.push_back(lines);
+
+    // the same lines as polygon edges, which run from their lower to their upper end
+    Workload edges = {"edges", edge, 2, lines.vertices};
+    for (size_t i = 0; i < edges.vertices.size(); i += 2)
+        if (edges.vertices[i].y > edges.vertices[i + 1].y)
+            std::swap(edges.vertices[i], edges.vertices[i + 1]);
+    workloads.push_back(edges);
+
+    // thin slivers: two vertices close to each other, the third one far away
+    Workload slivers = {"slivers", triangle, 3, {}};
+    for (int i = 0, n = count(20000); i < n; i++) {
+        glm::ivec2 a(coordinate(0, s - 1), coordinate(0, s - 1));
+        slivers.vertices.push_back(a);
+        slivers.vertices.push_back(glm::ivec2(glm::clamp(a.x + coordinate(-2, 2), 0, s - 1),
+                                              glm::clamp(a.y + coordinate(-2, 2), 0, s - 1)));
+        slivers.vertices.push_back(glm::ivec2(coordinate(0, s - 1), coordinate(0, s - 1)));
+    }
+    workloads.push_back(slivers);
+
+    // large triangles, spanning most of the screen
+    Workload large = {"large_triangles", triangle, 3, {}};
+    for (int i = 0, n = count(200); i < n; i++) {
+        large.vertices.push_back(glm::ivec2(coordinate(0, s / 4), coordinate(0, s / 4)));
+        large.vertices.push_back(glm::ivec2(coordinate(s * 3 / 4, s - 1), coordinate(0, s / 2)));
+        large.vertices.push_back(glm::ivec2(coordinate(0, s / 2), coordinate(s * 3 / 4, s - 1)));
+    }
+    workloads.push_back(large);
+
+    // many tiny triangles, a few pixels each
+    Workload tiny = {"tiny_triangles", triangle, 3, {}};
+    for (int i = 0, n = count(200000); i < n; i++) {
+        glm::ivec2 center(coordinate(4, s - 5), coordinate(4, s - 5));
+        for (int v = 0; v < 3; v++)
+            tiny.vertices.push_back(glm::ivec2(center.x + coordinate(-4, 4), center.y + coordinate(-4, 4)));
+    }
+    workloads.push_back(tiny);
+
+    return workloads;
+}
+
+
+// engines: rasterize one primitive, add its fragments to the count and their coordinates to the checksum
+// ---------------------------------------------------------------------------------
+struct Engine {
+    std::string name;
+    Primitive primitive;
+    std::function<void(const glm::ivec2 *, unsigned long long &, unsigned long long &)> rasterize;
+    // engines which take the whole workload at once (e.g. to spread it over threads) set this one instead
+    std::function<void(const std::vector<glm::ivec2> &, unsigned long long &, unsigned long long &)> rasterizeAll;
+};
+
+// draws every triangle with a flat depth and color of its own, keeping the nearest one of each pixel
+template <typename ColorBuffer>
+void drawWithDepth(const std::vector<glm::ivec2> &vertices, TypedFrameBuffer<Formats::Depth24> &depth,
+                   ColorBuffer &colors, unsigned long long &fragments, unsigned long long &sum){
+    depth.clear(1.f);
+    colors.clear(Colors::black);
+    for (size_t t = 0; t < vertices.size() / 3; t++) {
+        const glm::ivec2 *v = &vertices[t * 3];
+        halfspace_rasterizer rasterizer(v[0].x, v[0].y, v[1].x, v[1].y, v[2].x, v[2].y);
+        rasterizer.clip(0, 0, (int) colors.W - 1, (int) colors.H - 1);
+        float z = (float) (t * 2654435761u % 1000) / 1000.f;
+        Colors::color color = 0xFF000000 | (Colors::color) (t * 2654435761u);
+        auto visit = [&](int y, int xBegin, int xEnd) {
+            unsigned long long n = xEnd - xBegin;
+            fragments += n;
+            sum += n * y + (unsigned long long) (xBegin + xEnd - 1) * n / 2;
+            for (int x = xBegin; x < xEnd; x++)
+                if (depth.depthTest(x, y, z))
+                    colors.set(x, y, color);
+        };
+        rasterizer.for_each_span(visit);
+    }
+}
+
+std::vector<Engine> makeEngines(const Settings &settings){
+    std::vector<Engine> engines;
+    engines.push_back({"line", line, [](const glm::ivec2 *v, unsigned long long &fragments, unsigned long long &sum) {
+        LineRasterizer rasterizer(v[0].x, v[0].y, v[1].x, v[1].y);
+        for (; rasterizer.more_fragments(); rasterizer.next_fragment(), fragments++)
+            sum += rasterizer.x() + rasterizer.y();
+    }});
+    // the same pixels as "line", without constructing a rasterizer or calling through a pointer per fragment
+    engines.push_back({"polyline", line, [](const glm::ivec2 *v, unsigned long long &fragments, unsigned long long &sum) {
+        static const polyline_rasterizer rasterizer;
+        auto visit = [&](int y, int xBegin, int xEnd) {
+            unsigned long long n = xEnd - xBegin;
+            fragments += n;
+            sum += n * y + (unsigned long long) (xBegin + xEnd - 1) * n / 2;
+        };
+        rasterizer.for_each_span(v, 2, false, visit);
+    }});
+    engines.push_back({"edge", edge, [](const glm::ivec2 *v, unsigned long long &fragments, unsigned long long &sum) {
+        edge_rasterizer rasterizer;
+        rasterizer.init(v[0].x, v[0].y, v[1].x, v[1].y);
+        for (; rasterizer.more_fragments(); rasterizer.next_fragment(), fragments++)
+            sum += rasterizer.x() + rasterizer.y();
+    }});
+    engines.push_back({"triangle", triangle, [](const glm::ivec2 *v, unsigned long long &fragments, unsigned long long &sum) {
+        triangle_rasterizer rasterizer(v[0].x, v[0].y, v[1].x, v[1].y, v[2].x, v[2].y);
+        for (; rasterizer.more_fragments(); rasterizer.next_fragment(), fragments++)
+            sum += rasterizer.x() + rasterizer.y();
+    }});
+    // the half-space rasterizer outputs spans, so its cost per fragment does not include any per-pixel work
+    engines.push_back({"halfspace", triangle, [](const glm::ivec2 *v, unsigned long long &fragments, unsigned long long &sum) {
+        halfspace_rasterizer rasterizer(v[0].x, v[0].y, v[1].x, v[1].y, v[2].x, v[2].y);
+        auto visit = [&](int y, int xBegin, int xEnd) {
+            // the sum of x + y over the span, so the checksum matches the per-fragment engines
+            unsigned long long n = xEnd - xBegin;
+            fragments += n;
+            sum += n * y + (unsigned long long) (xBegin + xEnd - 1) * n / 2;
+        };
+        rasterizer.for_each_span(visit);
+    }});
+    // the half-space rasterizer on the tiles of the screen, in parallel; the workloads are inside the screen, so
+    // its checksum must match "halfspace"
+    const int tileSize = 64;
+    static tiled_rasterizer tiled(settings.size, settings.size, tileSize);
+    // every tile is visited by one thread only, so each one adds up its own fragments, padded to a cache line
+    struct TileSum { unsigned long long fragments, sum, padding[6]; };
+    static std::vector<TileSum> tileSums(tiled.tiles_x() * tiled.tiles_y());
+    engines.push_back({"tiled", triangle, nullptr, [](const std::vector<glm::ivec2> &vertices,
+                                                      unsigned long long &fragments, unsigned long long &sum) {
+        std::fill(tileSums.begin(), tileSums.end(), TileSum());
+        int tilesX = tiled.tiles_x();
+        auto visit = [tilesX](int, int x, int y) {
+            TileSum &tile = tileSums[y / tileSize * tilesX + x / tileSize];
+            tile.fragments++;
+            tile.sum += x + y;
+        };
+        tiled.rasterize(vertices, visit);
+        for (const TileSum &tile : tileSums) {
+            fragments += tile.fragments;
+            sum += tile.sum;
+        }
+    }});
+    // the half-space spans depth tested in a 24 bits depth buffer and written to an 8 bits color buffer, with the
+    // colors in 8x8 Morton tiles or in rows; the fragments and checksum are the ones of "halfspace"
+    static TypedFrameBuffer<Formats::Depth24, Layouts::Linear> depth(settings.size, settings.size);
+    static TypedFrameBuffer<Formats::RGBA8, Layouts::Tiled> tiledColors(settings.size, settings.size);
+    static TypedFrameBuffer<Formats::RGBA8, Layouts::Linear> linearColors(settings.size, settings.size);
+    engines.push_back({"rgba8_tiled", triangle, nullptr, [](const std::vector<glm::ivec2> &vertices,
+                                                            unsigned long long &fragments, unsigned long long &sum) {
+        drawWithDepth(vertices, depth, tiledColors, fragments, sum);
+    }});
+    engines.push_back({"rgba8_linear", triangle, nullptr, [](const std::vector<glm::ivec2> &vertices,
+                                                             unsigned long long &fragments, unsigned long long &sum) {
+        drawWithDepth(vertices, depth, linearColors, fragments, sum);
+    }});
+    return engines;
+}
+
+
+// measurement
+// ---------------------------------------------------------------------------------
+struct Result {
+    std::string engine, workload;
+    unsigned long long primitives, fragments, checksum, allocations, allocationBytes;
+    double seconds;
+    uint64_t cycles;
+};
+
+Result measure(const Engine &engine, const Workload &workload, int repeat){
+    Result result = {engine.name, workload.name, workload.vertices.size() / workload.verticesPerPrimitive,
+                     0, 0, 0, 0, 1e30, 0};
+    for (int r = 0; r < repeat; r++) {
+        unsigned long long fragments = 0, sum = 0;
+        unsigned long long allocationsBefore = allocationCount.load(), bytesBefore = allocatedBytes.load();
+        auto start = std::chrono::steady_clock::now();
+        uint64_t cyclesStart = readCycles();
+
+        if (engine.rasterizeAll)
+            engine.rasterizeAll(workload.vertices, fragments, sum);
+        else
+            for (size_t i = 0; i < workload.vertices.size(); i += workload.verticesPerPrimitive)
+                engine.rasterize(&workload.vertices[i], fragments, sum);
+
+        uint64_t cycles = readCycles() - cyclesStart;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < result.seconds) {
+            result.seconds = elapsed.count();
+            result.cycles = cycles;
+        }
+        result.fragments = fragments;
+        result.checksum = sum;
+        result.allocations = allocationCount.load() - allocationsBefore;
+        result.allocationBytes = allocatedBytes.load() - bytesBefore;
+    }
+    return result;
+}
+
+double perSecond(unsigned long long count, double seconds){
+    return seconds > 0 ? count / seconds : 0;
+}
+
+// the engines which gave no fragments are listed apart, with no throughput
+std::string toJson(const Settings &settings, const std::vector<Result> &results,
+                   const std::vector<Result> &unimplemented){
+    std::string json = "{\n  \"seed\": " + std::to_string(settings.seed) +
+                       ",\n  \"repeat\": " + std::to_string(settings.repeat) +
+                       ",\n  \"scale\": " + std::to_string(settings.scale) +
+                       ",\n  \"size\": " + std::to_string(settings.size) +
+                       ",\n  \"cycle_counter\": " + (HAS_CYCLE_COUNTER ? "true" : "false") +
+                       ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        char line[1024];
+        snprintf(line, sizeof(line),
+                 "%s\n    {\"engine\": \"%s\", \"workload\": \"%s\", \"primitives\": %llu, \"fragments\": %llu, "
+                 "\"checksum\": %llu, \"seconds\": %.9f, \"fragments_per_sec\": %.1f, \"primitives_per_sec\": %.1f, "
+                 "\"cycles_per_fragment\": %.3f, \"allocations\": %llu, \"allocated_bytes\": %llu}",
+                 i ? "," : "", r.engine.c_str(), r.workload.c_str(), r.primitives, r.fragments, r.checksum,
+                 r.seconds, perSecond(r.fragments, r.seconds), perSecond(r.primitives, r.seconds),
+                 r.fragments ? (double) r.cycles / r.fragments : 0., r.allocations, r.allocationBytes);
+        json += line;
+    }
+    json += "\n  ],\n  \"unimplemented\": [";
+    for (size_t i = 0; i < unimplemented.size(); i++)
+        json += std::string(i ? "," : "") + "\n    {\"engine\": \"" + unimplemented[i].engine +
+                "\", \"workload\": \"" + unimplemented[i].workload + "\"}";
+    return json + "\n  ]\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--seed" && hasValue) settings.seed = (unsigned int) std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--repeat" && hasValue) settings.repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--scale" && hasValue) settings.scale = (float) std::atof(argv[++i]);
+        else if (arg == "--size" && hasValue) settings.size = std::max(16, std::atoi(argv[++i]));
+        else if (arg == "--json" && hasValue) settings.json = argv[++i];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--seed N] [--repeat N] [--scale F] [--size N] [--json file]"
+                      << std::endl;
+            return -1;
+        }
+    }
+
+    std::vector<Workload> workloads = makeWorkloads(settings);
+    std::vector<Engine> engines = makeEngines(settings);
+    std::vector<Result> results, unimplemented;
+
+    for (const Engine &engine : engines) {
+        for (const Workload &workload : workloads) {
+            if (workload.primitive != engine.primitive)
+                continue;
+            // the engines may log from their inner loops (e.g. the parts not implemented yet),
+            // which would measure the console instead of the rasterizer
+            std::streambuf *console = std::cout.rdbuf(nullptr);
+            Result result;
+            try {
+                result = measure(engine, workload, settings.repeat);
+            } catch (const std::exception &error) {
+                std::cout.clear();
+                std::cout.rdbuf(console);
+                std::cerr << engine.name << " / " << workload.name << ": " << error.what() << std::endl;
+                continue;
+            }
+            std::cout.clear();
+            std::cout.rdbuf(console);
+            // every workload has fragments, an engine that finds none is a part of the exercise not written yet,
+            // and its timings would only be noise in the results
+            if (result.fragments == 0) {
+                unimplemented.push_back(result);
+                printf("%-12s %-18s not implemented, no fragments\n", result.engine.c_str(), result.workload.c_str());
+                continue;
+            }
+            results.push_back(result);
+
+            printf("%-12s %-18s %10llu prims %12llu frags %10.3f ms %9.2f Mfrag/s %9.3f Mprim/s %7.2f cyc/frag %8llu allocs\n",
+                   result.engine.c_str(), result.workload.c_str(), result.primitives, result.fragments,
+                   result.seconds * 1e3, perSecond(result.fragments, result.seconds) * 1e-6,
+                   perSecond(result.primitives, result.seconds) * 1e-6,
+                   result.fragments ? (double) result.cycles / result.fragments : 0., result.allocations);
+        }
+    }
+
+    if (!settings.json.empty()) {
+        FILE *file = fopen(settings.json.c_str(), "w");
+        if (file == nullptr) {
+            std::cerr << "Could not open " << settings.json << std::endl;
+            return -1;
+        }
+        std::string json = toJson(settings, results, unimplemented);
+        fwrite(json.data(), 1, json.size(), file);
+        fclose(file);
+    }
+    return 0;
+}
@@ -1,16 +1,32 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <string>
+#include <cstdlib>
 
 #include <vector>
+#include <memory>
 #include <chrono>
 
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
 #include "trianglerasterizer.h"
-#include "linerasterizer.h"
+#include "halfspacerasterizer.h"
+#include "polylinerasterizer.h"
+#include "softwarepipeline.h"
+#include "softwaretexture.h"
+#include "MultisampleBuffer.h"
 #include "CustomFrameBuffer.h"
+#include "FrameWriter.h"
+#include "TextureUploader.h"
+#include "primitives.h"
 
 void key_input_callback(GLFWwindow* window, int button, int other, int action, int mods);
+void window_refresh_callback(GLFWwindow* window);
 void print_instructions();
+void renderScene(CustomFrameBuffer &customBuffer, software_pipeline &pipeline, float time);
+int runHeadless(int argc, char **argv);
 
 // rasterization grid resolution
 const int max_W = 32, max_H = 32;
@@ -27,9 +43,24 @@ int x_3  = max_W * .4, y_3  = max_H * .7;
 
 bool showTriangleLines = true;
 bool showTriangleFill = false;
-
-int main()
+bool useExerciseFill = false;
+bool showCube = false;
+bool smoothLines = false;
+bool texturedFloor = false;
+// samples per pixel of the cube scene, 0 disables multisample anti-aliasing
+uint32_t msaaSamples = 0;
+
+// the scene is rendered and presented again only when something changed
+bool sceneChanged = true;
+bool windowExposed = true;
+
+int main(int argc, char **argv)
 {
+    // render straight to files or stdout, without a window or an OpenGL context
+    for (int i = 1; i < argc; i++)
+        if (std::string(argv[i]) == "--headless")
+            return runHeadless(argc, argv);
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -52,6 +83,7 @@ int main()
     }
     glfwMakeContextCurrent(window);
     glfwSetKeyCallback(window, key_input_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -67,20 +99,14 @@ int main()
     // ----------------------------------
     // every frame we will: draw to it, upload it to a texture, and copy the texture to the window frame buffer.
     CustomFrameBuffer customBuffer(max_W, max_H);
+    // the CPU pipeline draws 3D meshes into it, using its depth buffer
+    software_pipeline pipeline(customBuffer);
 
 
     // initialize texture we will use to upload our buffer to GPU
     // ----------------------------------------------------------
-    unsigned int bufferTexture;
-
-    glGenTextures(1, &bufferTexture);
-    glBindTexture(GL_TEXTURE_2D, bufferTexture);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // only the regions of the buffer that changed are uploaded
+    TextureUploader uploader(customBuffer);
 
     // initialize openGL frame buffer object
     // ------------------------------------
@@ -103,67 +129,35 @@ int main()
 
         // render to our custom frame buffer
         // ---------------------------------
-        customBuffer.clearBuffer(Colors::black);
-
-        // paint the dots in the middle of the pixels
-        for(int i = 0; i < customBuffer.W; i++){
-            for(int j = 0; j < customBuffer.H; j++)
-                customBuffer.paintAt(i, j, Colors::dark, CustomFrameBuffer::fill::frame);
-        }
-
-
-        if (showTriangleFill) {
-            // paint the filled pixels (triangle rasterization)
-            std::vector<glm::ivec2> pixels;
-            triangle_rasterizer triangle(x_1, y_1, x_2, y_2, x_3, y_3);
-            // run rasterization
-            pixels = triangle.all_pixels();
-            for (auto it = pixels.begin(); it < pixels.end(); it++) {
-                customBuffer.paintAt(it->x, it->y, Colors::green, CustomFrameBuffer::fill::center);
-            }
-        }
-
-        if (showTriangleLines) {
-            // paint the lines connecting the vertices (line rasterizer)
-            std::vector<glm::ivec2> pixelsLine;
-            // run rasterization
-            LineRasterizer lines[3] = {LineRasterizer(x_1, y_1, x_2, y_2),
-                                       LineRasterizer(x_2, y_2, x_3, y_3),
-                                       LineRasterizer(x_3, y_3, x_1, y_1)};
-            for (auto &l: lines) {
-                pixelsLine = l.all_pixels();
-                for (auto &p: pixelsLine) {
-                    customBuffer.paintAt(p.x, p.y, Colors::white, CustomFrameBuffer::fill::center);
-                }
-            }
+        // the cube is animated, everything else changes only with the keys
+        if (sceneChanged || showCube) {
+            renderScene(customBuffer, pipeline, appTime.count());
+            sceneChanged = false;
         }
 
-        // paint the triangle vertices
-        customBuffer.paintAt(x_1,y_1, Colors::blue, CustomFrameBuffer::fill::frame);
-        customBuffer.paintAt(x_2,y_2, Colors::blue, CustomFrameBuffer::fill::frame);
-        customBuffer.paintAt(x_3,y_3, Colors::blue, CustomFrameBuffer::fill::frame);
-
 
         // show our rendered triangle
         // --------------------------
 
-        // upload the custom color buffer to the GPU using the texture
+        // upload the damaged regions of the custom color buffer to the GPU using the texture
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, bufferTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, max_W*3, max_H*3, 0, GL_RGBA, GL_UNSIGNED_BYTE, customBuffer.buffer);
-
-        // set opengl frame buffer object to read from our texture, we will copy from it
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, oglFrameBuffer);
-        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bufferTexture, 0);
+        bool uploaded = uploader.upload(customBuffer);
 
-        // bind the window frame buffer, where we want to copy the contents of the texture to
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        // nothing to present if the texture did not change and the window still shows it
+        if (uploaded || windowExposed) {
+            // set opengl frame buffer object to read from our texture, we will copy from it
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, oglFrameBuffer);
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, uploader.texture, 0);
 
-        // copy from opengl the frame buffer object (access the texture) to the window frame buffer
-        glBlitFramebuffer(0,0, max_W * 3, max_H * 3,0,0,SCR_WIDTH,SCR_HEIGHT,GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            // bind the window frame buffer, where we want to copy the contents of the texture to
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 
+            // copy from opengl the frame buffer object (access the texture) to the window frame buffer
+            glBlitFramebuffer(0,0, max_W * 3, max_H * 3,0,0,SCR_WIDTH,SCR_HEIGHT,GL_COLOR_BUFFER_BIT, GL_NEAREST);
 
-        glfwSwapBuffers(window);
+            glfwSwapBuffers(window);
+            windowExposed = false;
+        }
         glfwPollEvents();
 
         // control render loop frequency (busy wait)
@@ -179,6 +173,175 @@ int main()
     return 0;
 }
 
+void renderScene(CustomFrameBuffer &customBuffer, software_pipeline &pipeline, float time){
+    // clear to the grid around the pixels, after the first frame only what was painted since is restored
+    customBuffer.clearBuffer(Colors::black, Colors::dark);
+
+    if (showCube) {
+        // draw a spinning cube over the floor with the CPU pipeline (depth test, interpolated colors)
+        pipeline.clear_depth();
+        glm::mat4 projection = glm::perspective(glm::radians(60.f), (float) max_W / (float) max_H, .1f, 100.f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.f, 2.5f, 5.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+        glm::mat4 floorModel = glm::scale(glm::translate(glm::mat4(1.f), glm::vec3(0.f, -1.f, 0.f)), glm::vec3(.1f));
+        glm::mat4 cubeModel = glm::rotate(glm::mat4(1.f), time, glm::vec3(0.f, 1.f, 0.f));
+
+        // with MSAA the meshes go to a multisample buffer, which is then resolved over the grid
+        static std::unique_ptr<MultisampleBuffer> samples;
+        if (msaaSamples != 0 && (!samples || samples->samples != msaaSamples))
+            samples.reset(new MultisampleBuffer(customBuffer.W, customBuffer.H, msaaSamples));
+        if (msaaSamples != 0)
+            samples->clear();
+        pipeline.set_multisample_target(msaaSamples != 0 ? samples.get() : nullptr);
+        // the cube is closed and the floor is only seen from above, so their back faces are never visible
+        pipeline.set_culling(software_pipeline::back_faces);
+
+        if (texturedFloor && msaaSamples == 0) {
+            // a mipmapped checkerboard, the derivatives of the 2x2 quads pick its level of detail
+            static const software_texture checkerboard = [] {
+                const int size = 64;
+                std::vector<Colors::color> pixels(size * size);
+                for (int y = 0; y < size; y++)
+                    for (int x = 0; x < size; x++)
+                        pixels[x + y * size] = ((x / 8 + y / 8) % 2) ? Colors::fromFloats(.9f, .9f, .8f)
+                                                                     : Colors::fromFloats(.3f, .4f, .6f);
+                return software_texture(pixels.data(), size, size);
+            }();
+            auto shadeFloor = [](const float *uv, const float *ddx, const float *ddy) {
+                glm::vec4 color = checkerboard.sample(uv[0], uv[1], ddx[0], ddx[1], ddy[0], ddy[1]);
+                return Colors::fromFloats(color.r, color.g, color.b, color.a);
+            };
+            pipeline.draw_quads(floorVertices, floorTextureCoordinates, 2, floorIndices,
+                                projection * view * floorModel, shadeFloor);
+        } else {
+            pipeline.draw(floorVertices, floorColors, floorIndices, projection * view * floorModel);
+        }
+        // the cube is only drawn if the floor does not hide it, e.g. when the camera is below the floor
+        if (!pipeline.occluded(glm::vec3(-1.f), glm::vec3(1.f), projection * view * cubeModel))
+            pipeline.draw(cubeVertices, cubeColors, cubeIndices, projection * view * cubeModel);
+        if (msaaSamples != 0)
+            samples->resolve(customBuffer);
+    }
+
+    if (showTriangleFill) {
+        // paint the filled pixels (triangle rasterization), one span at a time
+        auto paintFill = [&customBuffer](int y, int xBegin, int xEnd) {
+            customBuffer.paintSpan<CustomFrameBuffer::fill::center>(y, xBegin, xEnd, Colors::green);
+        };
+        // run rasterization, triangle_rasterizer is the exercise and paints nothing until implemented
+        if (useExerciseFill) {
+            triangle_rasterizer triangle(x_1, y_1, x_2, y_2, x_3, y_3);
+            triangle.for_each_span(paintFill);
+        } else {
+            halfspace_rasterizer triangle(x_1, y_1, x_2, y_2, x_3, y_3);
+            triangle.for_each_span(paintFill);
+        }
+    }
+
+    if (showTriangleLines) {
+        // paint the lines connecting the vertices, the outline is a single closed polyline
+        polyline_rasterizer lines(1.f, smoothLines);
+        lines.clip(0, 0, customBuffer.W - 1, customBuffer.H - 1);
+        if (smoothLines) {
+            // anti-aliased lines (Xiaolin Wu), blended over the grid; the damage is marked once for all of them
+            CustomFrameBuffer::rect painted = {customBuffer.W, customBuffer.H, 0, 0};
+            auto paintLine = [&customBuffer, &painted](int x, int y, float coverage) {
+                Colors::color &background = customBuffer.buffer[(x * 3 + 1) + (y * 3 + 1) * customBuffer.W * 3];
+                customBuffer.paintAt<CustomFrameBuffer::fill::center>(x, y, Colors::mix(background, Colors::white, coverage));
+                painted = {std::min(painted.x0, (uint32_t) x), std::min(painted.y0, (uint32_t) y),
+                           std::max(painted.x1, (uint32_t) x + 1), std::max(painted.y1, (uint32_t) y + 1)};
+            };
+            glm::vec2 outline[3] = {glm::vec2(x_1, y_1), glm::vec2(x_2, y_2), glm::vec2(x_3, y_3)};
+            lines.for_each_fragment(outline, 3, true, paintLine);
+            if (painted.x0 < painted.x1 && painted.y0 < painted.y1)
+                customBuffer.markDamaged(painted.x0, painted.y0, painted.x1, painted.y1);
+        } else {
+            auto paintLine = [&customBuffer](int y, int xBegin, int xEnd) {
+                customBuffer.paintSpan<CustomFrameBuffer::fill::center>(y, xBegin, xEnd, Colors::white);
+            };
+            glm::ivec2 outline[3] = {glm::ivec2(x_1, y_1), glm::ivec2(x_2, y_2), glm::ivec2(x_3, y_3)};
+            lines.for_each_span(outline, 3, true, paintLine);
+        }
+    }
+
+    // paint the triangle vertices
+    customBuffer.paintAt(x_1,y_1, Colors::blue, CustomFrameBuffer::fill::frame);
+    customBuffer.paintAt(x_2,y_2, Colors::blue, CustomFrameBuffer::fill::frame);
+    customBuffer.paintAt(x_3,y_3, Colors::blue, CustomFrameBuffer::fill::frame);
+}
+
+int runHeadless(int argc, char **argv){
+    FrameWriter::format format = FrameWriter::ppm;
+    std::string output = "-";
+    int frames = 60, fps = 60;
+    bool printStatistics = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless") continue;
+        else if (arg == "--format" && hasValue && FrameWriter::parseFormat(argv[i + 1], format)) i++;
+        else if (arg == "--output" && hasValue) output = argv[++i];
+        else if (arg == "--frames" && hasValue) frames = std::atoi(argv[++i]);
+        else if (arg == "--fps" && hasValue) fps = std::atoi(argv[++i]);
+        else if (arg == "--no-lines") showTriangleLines = false;
+        else if (arg == "--fill") showTriangleFill = true;
+        else if (arg == "--exercise-fill") useExerciseFill = true;
+        else if (arg == "--cube") showCube = true;
+        else if (arg == "--smooth-lines") smoothLines = true;
+        else if (arg == "--textured") texturedFloor = true;
+        else if (arg == "--msaa" && hasValue) msaaSamples = std::atoi(argv[++i]);
+        else if (arg == "--stats") printStatistics = true;
+        else {
+            std::cerr << "Unknown or incomplete argument: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0] << " --headless [--format ppm|png|rgba|y4m] [--output file|pattern|-]"
+                      << " [--frames N] [--fps N] [--no-lines] [--fill] [--exercise-fill] [--cube]"
+                      << " [--msaa 2|4|8] [--smooth-lines] [--textured] [--stats]" << std::endl;
+            return -1;
+        }
+    }
+    if (frames < 0 || fps <= 0) {
+        std::cerr << "Invalid frame count or frame rate" << std::endl;
+        return -1;
+    }
+    if (msaaSamples != 0 && msaaSamples != 2 && msaaSamples != 4 && msaaSamples != 8) {
+        std::cerr << "Invalid sample count, use 2, 4 or 8" << std::endl;
+        return -1;
+    }
+
+    // the images may go to stdout, so everything logged to std::cout (e.g. by the parts of the rasterizers not
+    // implemented yet) goes to stderr instead of ending up in the middle of the image data
+    std::streambuf *console = std::cout.rdbuf(std::cerr.rdbuf());
+    int result = 0;
+
+    CustomFrameBuffer customBuffer(max_W, max_H);
+    software_pipeline pipeline(customBuffer);
+    try {
+        // the writer encodes each frame on its own thread while the next one is rendered
+        FrameWriter writer(format, output, customBuffer.W * 3, customBuffer.H * 3, fps);
+        for (int frame = 0; frame < frames; frame++) {
+            renderScene(customBuffer, pipeline, (float) frame / (float) fps);
+            writer.write(customBuffer.buffer);
+        }
+        writer.flush();
+
+        if (printStatistics) {
+            // the triangles of the meshes through each stage of the CPU pipeline, over all the frames
+            const software_pipeline::statistics &stats = pipeline.get_statistics();
+            std::cerr << "triangles submitted: " << stats.submitted << ", clipped: " << stats.clipped
+                      << ", rasterized: " << stats.rasterized << std::endl;
+            std::cerr << "culled outside: " << stats.culled_outside << ", degenerate: " << stats.culled_degenerate
+                      << ", facing: " << stats.culled_facing << ", no samples: " << stats.culled_no_samples << std::endl;
+            std::cerr << "vertices transformed: " << stats.transformed_vertices << ", objects tested for occlusion: "
+                      << stats.occlusion_tests << ", occluded: " << stats.occluded_objects << std::endl;
+        }
+    } catch (const std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        result = -1;
+    }
+    std::cout.rdbuf(console);
+    return result;
+}
+
 void print_instructions(){
     // print the use instructions
     // --------------------------
@@ -194,11 +357,21 @@ void print_instructions(){
     std::cout << "*                                                         *" << std::endl;
     std::cout << "* Press 1 to toggle triangle lines (" << (showTriangleLines ? "ON " : "OFF") << ")                  *" << std::endl;
     std::cout << "* Press 2 to toggle triangle fill  (" << (showTriangleFill  ? "ON " : "OFF") << ")                  *" << std::endl;
+    std::cout << "* Press 3 to use the exercise rasterizer (" << (useExerciseFill ? "ON " : "OFF") << ")            *" << std::endl;
+    std::cout << "* Press 4 to toggle the 3D cube scene (" << (showCube ? "ON " : "OFF") << ")               *" << std::endl;
+    std::cout << "* Press 5 to cycle the cube anti-aliasing (" << (msaaSamples == 0 ? "OFF" : std::to_string(msaaSamples) + "x ") << ")           *" << std::endl;
+    std::cout << "* Press 6 to toggle anti-aliased lines (" << (smoothLines ? "ON " : "OFF") << ")              *" << std::endl;
+    std::cout << "* Press 7 to toggle the textured floor (" << (texturedFloor ? "ON " : "OFF") << ")              *" << std::endl;
     std::cout << "* Press ESC to finish the program                         *" << std::endl;
     std::cout << "***********************************************************" << std::endl;
     std::cout << std::endl;
 }
 
+void window_refresh_callback(GLFWwindow* window){
+    // the window contents were lost (e.g. it was resized or uncovered), present the frame again
+    windowExposed = true;
+}
+
 void key_input_callback(GLFWwindow* window, int button, int other,int action, int mods){
     if (button == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
@@ -206,8 +379,15 @@ void key_input_callback(GLFWwindow* window, int button, int other,int action, in
     if (action != GLFW_PRESS)
         return;
 
+    sceneChanged = true;
+
     if (button == GLFW_KEY_1) showTriangleLines = !showTriangleLines, print_instructions();
     if (button == GLFW_KEY_2) showTriangleFill = !showTriangleFill, print_instructions();
+    if (button == GLFW_KEY_3) useExerciseFill = !useExerciseFill, print_instructions();
+    if (button == GLFW_KEY_4) showCube = !showCube, print_instructions();
+    if (button == GLFW_KEY_5) msaaSamples = msaaSamples == 0 ? 2 : (msaaSamples == 8 ? 0 : msaaSamples * 2), print_instructions();
+    if (button == GLFW_KEY_6) smoothLines = !smoothLines, print_instructions();
+    if (button == GLFW_KEY_7) texturedFloor = !texturedFloor, print_instructions();
 
     // move triangle vertices
     if (button == GLFW_KEY_A) x_1 -= 1;
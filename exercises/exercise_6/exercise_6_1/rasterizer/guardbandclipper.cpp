@@ -0,0 +1,174 @@
+#include "guardbandclipper.h"
+
+#include <cmath>
+
+
+/*
+ * \class guard_band_clipper
+ * The front end between clip space and halfspace_rasterizer. Triangles are snapped to the subpixel grid, and
+ * clipped only against the near and far planes and the guard band, and only when they cross them.
+ */
+
+/*
+ * Parameterized constructor creates an instance of a guard-band clipper
+ * \param width - the width of the viewport in pixels
+ * \param height - the height of the viewport in pixels
+ */
+guard_band_clipper::guard_band_clipper(int width, int height) : width(width), height(height)
+{
+    // a couple of pixels of margin, so rounding never moves a vertex out of the range of the rasterizer
+    const int limit = halfspace_rasterizer::MAX_COORDINATE - 2;
+    if (width <= 0 || height <= 0 || width >= limit || height >= limit) {
+        throw std::runtime_error("guard_band_clipper::guard_band_clipper(): Invalid viewport size");
+    }
+    this->guard_x = 2.f * limit / width - 1.f;
+    this->guard_y = 2.f * limit / height - 1.f;
+}
+
+/*
+ * Destroys the current instance of the guard-band clipper
+ */
+guard_band_clipper::~guard_band_clipper()
+{}
+
+/*
+ * Clips a triangle and maps it to the viewport
+ * \param clip - the clip space positions of the three vertices
+ * \param out - receives up to MAX_VERTICES vertices of a convex polygon, made of the triangles
+ *              (out[0], out[i], out[i + 1])
+ * \return the number of vertices of the polygon, 0 if the triangle is completely outside
+ */
+int guard_band_clipper::clip_triangle(const glm::vec4 clip[3], vertex *out) const
+{
+    int crossed = this->classify(clip);
+    if (crossed < 0) {
+        return 0;
+    }
+
+    clip_vertex polygon[2][MAX_VERTICES];
+    int count = 3;
+    for (int v = 0; v < 3; v++) {
+        polygon[0][v].position = clip[v];
+        polygon[0][v].weights = glm::vec3(v == 0 ? 1.f : 0.f, v == 1 ? 1.f : 0.f, v == 2 ? 1.f : 0.f);
+    }
+
+    // Sutherland-Hodgman, against the crossed planes only
+    int current = 0;
+    for (int p = 0; p < PLANE_COUNT && count > 0; p++) {
+        if (!(crossed & (1 << p))) {
+            continue;
+        }
+        const clip_vertex *input = polygon[current];
+        clip_vertex *output = polygon[1 - current];
+        int output_count = 0;
+        for (int i = 0; i < count; i++) {
+            const clip_vertex &a = input[i];
+            const clip_vertex &b = input[(i + 1) % count];
+            float da = this->distance(p, a.position);
+            float db = this->distance(p, b.position);
+            if (da >= 0.f) {
+                output[output_count++] = a;
+            }
+            if ((da >= 0.f) != (db >= 0.f)) {
+                float t = da / (da - db);
+                output[output_count].position = a.position + (b.position - a.position) * t;
+                output[output_count].weights = a.weights + (b.weights - a.weights) * t;
+                output_count++;
+            }
+        }
+        count = output_count;
+        current = 1 - current;
+    }
+    if (count < 3) {
+        return 0;
+    }
+
+    for (int v = 0; v < count; v++) {
+        out[v] = this->to_viewport(polygon[current][v]);
+    }
+    return count;
+}
+
+/*
+ * Finds the clipping planes crossed by a triangle, without clipping it
+ * \param clip - the clip space positions of the three vertices
+ * \return -1 if the triangle is completely outside, 0 if its vertices can be mapped to the viewport as they
+ *         are (with map_vertex()), else a bit set for each crossed plane
+ */
+int guard_band_clipper::classify(const glm::vec4 clip[3]) const
+{
+    // trivial reject, if all the vertices are outside the same side of the view volume
+    for (int axis = 0; axis < 3; axis++) {
+        if ((clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w) ||
+            (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w)) {
+            return -1;
+        }
+    }
+
+    // the planes crossed by the triangle, usually none
+    int crossed = 0;
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        for (int v = 0; v < 3; v++) {
+            if (this->distance(p, clip[v]) < 0.f) {
+                crossed |= 1 << p;
+                break;
+            }
+        }
+    }
+    return crossed;
+}
+
+/*
+ * Maps a clip space position to the viewport, snapping it to the subpixel grid. The position must be inside
+ * the guard band and between the near and far planes, e.g. a vertex of a triangle that classify() accepts
+ * \param clip - the clip space position
+ * \return the vertex, with the weights of a first input vertex
+ */
+guard_band_clipper::vertex guard_band_clipper::map_vertex(const glm::vec4 &clip) const
+{
+    clip_vertex v;
+    v.position = clip;
+    v.weights = glm::vec3(1.f, 0.f, 0.f);
+    return this->to_viewport(v);
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * Signed distance of a clip space position to clipping plane p, the inside is >= 0
+ */
+float guard_band_clipper::distance(int p, const glm::vec4 &position) const
+{
+    switch (p) {
+        case 0: return position.w - W_EPSILON;
+        case 1: return position.w + position.z;
+        case 2: return position.w - position.z;
+        case 3: return this->guard_x * position.w - position.x;
+        case 4: return this->guard_x * position.w + position.x;
+        case 5: return this->guard_y * position.w - position.y;
+        default: return this->guard_y * position.w + position.y;
+    }
+}
+
+/*
+ * Maps a clip space vertex to the viewport, snapping it to the subpixel grid
+ */
+guard_band_clipper::vertex guard_band_clipper::to_viewport(const clip_vertex &v) const
+{
+    const float subpixels = (float) (1 << halfspace_rasterizer::SUBPIXEL_BITS);
+    float inverse_w = 1.f / v.position.w;
+
+    // normalized device coordinates to pixels, with the pixel centers at integer coordinates
+    float x = (v.position.x * inverse_w * .5f + .5f) * this->width - .5f;
+    float y = (v.position.y * inverse_w * .5f + .5f) * this->height - .5f;
+    float z = v.position.z * inverse_w * .5f + .5f;
+
+    vertex result;
+    result.x = std::llround(x * subpixels);
+    result.y = std::llround(y * subpixels);
+    result.screen = glm::vec4(result.x / subpixels, result.y / subpixels, glm::clamp(z, 0.f, 1.f), v.position.w);
+    result.weights = v.weights;
+    return result;
+}
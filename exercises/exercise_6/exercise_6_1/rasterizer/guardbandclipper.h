@@ -0,0 +1,124 @@
+#ifndef __GUARD_BAND_CLIPPER_H__
+#define __GUARD_BAND_CLIPPER_H__
+
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include "halfspacerasterizer.h"
+
+/**
+ * \class guard_band_clipper
+ * The front end between clip space and halfspace_rasterizer. It takes the clip space positions of a triangle,
+ * rejects it if it is completely outside the view volume, and maps it to the viewport with its vertices
+ * snapped to the subpixel grid of the rasterizer (fixed point with SUBPIXEL_BITS fractional bits).
+ *
+ * Triangles that leave the screen but stay inside the guard band, i.e. the range of coordinates that the
+ * rasterizer can represent, are not clipped: the rasterizer restricts them to the screen for free. Only a
+ * triangle that crosses the near or far plane, or leaves the guard band, is clipped, and only against the
+ * planes it actually crosses.
+ */
+class guard_band_clipper {
+public:
+    /**
+     * The largest number of vertices of a clipped triangle, three plus one per clipping plane
+     */
+    static const int MAX_VERTICES = 3 + 7;
+
+    /**
+     * A vertex of a clipped triangle
+     */
+    struct vertex {
+        /**
+         * Position in the viewport, in fixed point with halfspace_rasterizer::SUBPIXEL_BITS fractional bits
+         */
+        long long x, y;
+
+        /**
+         * Position in the viewport as floats (the snapped x and y), depth in [0, 1] and clip space w
+         */
+        glm::vec4 screen;
+
+        /**
+         * Weights of the three input vertices, to interpolate their attributes at this vertex
+         */
+        glm::vec3 weights;
+    };
+
+    /**
+     * Parameterized constructor creates an instance of a guard-band clipper
+     * \param width - the width of the viewport in pixels
+     * \param height - the height of the viewport in pixels
+     */
+    guard_band_clipper(int width, int height);
+
+    /**
+     * Destroys the current instance of the guard-band clipper
+     */
+    virtual ~guard_band_clipper();
+
+    /**
+     * Clips a triangle and maps it to the viewport
+     * \param clip - the clip space positions of the three vertices
+     * \param out - receives up to MAX_VERTICES vertices of a convex polygon, made of the triangles
+     *              (out[0], out[i], out[i + 1])
+     * \return the number of vertices of the polygon, 0 if the triangle is completely outside
+     */
+    int clip_triangle(const glm::vec4 clip[3], vertex *out) const;
+
+    /**
+     * Finds the clipping planes crossed by a triangle, without clipping it
+     * \param clip - the clip space positions of the three vertices
+     * \return -1 if the triangle is completely outside, 0 if its vertices can be mapped to the viewport as they
+     *         are (with map_vertex()), else a bit set for each crossed plane
+     */
+    int classify(const glm::vec4 clip[3]) const;
+
+    /**
+     * Maps a clip space position to the viewport, snapping it to the subpixel grid. The position must be inside
+     * the guard band and between the near and far planes, e.g. a vertex of a triangle that classify() accepts
+     * \param clip - the clip space position
+     * \return the vertex, with the weights of a first input vertex
+     */
+    vertex map_vertex(const glm::vec4 &clip) const;
+
+private:
+    /**
+     * A vertex in clip space, during clipping
+     */
+    struct clip_vertex {
+        glm::vec4 position;
+        glm::vec3 weights;
+    };
+
+    /**
+     * Signed distance of a clip space position to clipping plane p, the inside is >= 0
+     */
+    float distance(int p, const glm::vec4 &position) const;
+
+    /**
+     * Maps a clip space vertex to the viewport, snapping it to the subpixel grid
+     */
+    vertex to_viewport(const clip_vertex &v) const;
+
+    /**
+     * The clipping planes: w > epsilon, near, far, and the four sides of the guard band
+     */
+    static const int PLANE_COUNT = 7;
+
+    /**
+     * Smallest w of a vertex after clipping, it keeps the perspective division finite
+     */
+    static constexpr float W_EPSILON = 1e-5f;
+
+    int width;
+    int height;
+
+    /**
+     * Extent of the guard band in normalized device coordinates, the screen is [-1, 1]
+     */
+    float guard_x;
+    float guard_y;
+};
+
+#endif
@@ -0,0 +1,336 @@
+#include "halfspacerasterizer.h"
+
+
+/*
+ * \class halfspace_rasterizer
+ * A class which rasterizes a triangle by evaluating its three edge functions, instead of walking its edges.
+ * The screen is traversed in 8x8 pixel blocks; only the blocks crossed by an edge are tested pixel by pixel.
+ */
+
+/*
+ * Parameterized constructor creates an instance of a half-space triangle rasterizer
+ * \param x1 - the x-coordinate of the first vertex
+ * \param y1 - the y-coordinate of the first vertex
+ * \param x2 - the x-coordinate of the second vertex
+ * \param y2 - the y-coordinate of the second vertex
+ * \param x3 - the x-coordinate of the third vertex
+ * \param y3 - the y-coordinate of the third vertex
+ */
+halfspace_rasterizer::halfspace_rasterizer(int x1, int y1, int x2, int y2, int x3, int y3) : valid(false)
+{
+    int coordinates[6] = {x1, y1, x2, y2, x3, y3};
+    for (int c : coordinates) {
+        if (c < -MAX_COORDINATE || c > MAX_COORDINATE) {
+            throw std::runtime_error("halfspace_rasterizer::halfspace_rasterizer(): Vertex out of range");
+        }
+    }
+
+    // vertices in fixed point
+    long long vx[3] = {(long long) x1 << SUBPIXEL_BITS, (long long) x2 << SUBPIXEL_BITS, (long long) x3 << SUBPIXEL_BITS};
+    long long vy[3] = {(long long) y1 << SUBPIXEL_BITS, (long long) y2 << SUBPIXEL_BITS, (long long) y3 << SUBPIXEL_BITS};
+    this->setup(vx, vy);
+}
+
+/*
+ * Parameterized constructor creates an instance of a half-space triangle rasterizer from subpixel positions
+ * \param fixed_x - the x-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+ * \param fixed_y - the y-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+ */
+halfspace_rasterizer::halfspace_rasterizer(const long long fixed_x[3], const long long fixed_y[3]) : valid(false)
+{
+    const long long limit = (long long) MAX_COORDINATE << SUBPIXEL_BITS;
+    for (int v = 0; v < 3; v++) {
+        if (fixed_x[v] < -limit || fixed_x[v] > limit || fixed_y[v] < -limit || fixed_y[v] > limit) {
+            throw std::runtime_error("halfspace_rasterizer::halfspace_rasterizer(): Vertex out of range");
+        }
+    }
+    this->setup(fixed_x, fixed_y);
+}
+
+/*
+ * Destroys the current instance of the half-space rasterizer
+ */
+halfspace_rasterizer::~halfspace_rasterizer()
+{}
+
+/*
+ * Restricts the rasterization to a rectangle, e.g. the screen or a tile
+ * \param x0 - the smallest x-coordinate inside the rectangle
+ * \param y0 - the smallest y-coordinate inside the rectangle
+ * \param x1 - the largest x-coordinate inside the rectangle
+ * \param y1 - the largest y-coordinate inside the rectangle
+ */
+void halfspace_rasterizer::clip(int x0, int y0, int x1, int y1)
+{
+    this->clip_x0 = std::max(this->clip_x0, x0);
+    this->clip_y0 = std::max(this->clip_y0, y0);
+    this->clip_x1 = std::min(this->clip_x1, x1);
+    this->clip_y1 = std::min(this->clip_y1, y1);
+    this->x_min = std::max(this->x_min, x0);
+    this->y_min = std::max(this->y_min, y0);
+    this->x_max = std::min(this->x_max, x1);
+    this->y_max = std::min(this->y_max, y1);
+    if (this->x_min > this->x_max || this->y_min > this->y_max) {
+        this->valid = false;
+    }
+}
+
+/*
+ * Checks if the triangle covers any pixel center inside its (clipped) bounding box
+ * \return false if the triangle is degenerated or clipped away, else true
+ */
+bool halfspace_rasterizer::more_fragments() const
+{
+    return this->valid;
+}
+
+/*
+ * Returns a vector which contains all the pixels inside the triangle
+ */
+std::vector<glm::ivec2> halfspace_rasterizer::all_pixels() const
+{
+    std::vector<glm::ivec2> points;
+
+    auto collect = [&points](int x, int y, unsigned int mask) {
+        for (int i = 0; mask; i++, mask >>= 1) {
+            if (mask & 1) {
+                points.push_back(glm::ivec2(x + i, y));
+            }
+        }
+    };
+    this->rasterize(collect);
+
+    return points;
+}
+
+/*
+ * Returns the standard sample pattern (the one of Direct3D, with y pointing up) for 2, 4 or 8 samples
+ * \param sample_count - the number of samples per pixel
+ * \return sample_count positions relative to the pixel center, in 1/16 pixel
+ */
+const glm::ivec2 *halfspace_rasterizer::sample_pattern(int sample_count)
+{
+    static const glm::ivec2 pattern_2[2] = {glm::ivec2(4, -4), glm::ivec2(-4, 4)};
+    static const glm::ivec2 pattern_4[4] = {glm::ivec2(-2, 6), glm::ivec2(6, 2), glm::ivec2(-6, -2),
+                                            glm::ivec2(2, -6)};
+    static const glm::ivec2 pattern_8[8] = {glm::ivec2(1, 3), glm::ivec2(-1, -3), glm::ivec2(5, -1),
+                                            glm::ivec2(-3, 5), glm::ivec2(-5, -5), glm::ivec2(-7, 1),
+                                            glm::ivec2(3, -7), glm::ivec2(7, 7)};
+    switch (sample_count) {
+        case 2: return pattern_2;
+        case 4: return pattern_4;
+        case 8: return pattern_8;
+        default:
+            throw std::runtime_error("halfspace_rasterizer::sample_pattern(): Only 2, 4 or 8 samples are supported");
+    }
+}
+
+/*
+ * Checks if the bounding box of a triangle contains a sample inside a rectangle, without setting it up. A
+ * triangle whose box contains no sample covers none, e.g. a small triangle between the pixel centers
+ * \param fixed_x - the x-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+ * \param fixed_y - the y-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+ * \param samples - the sample positions relative to the pixel center, in 1/16 pixel, nullptr for the centers
+ * \param sample_count - the number of samples
+ * \param x0 - the smallest x-coordinate inside the rectangle
+ * \param y0 - the smallest y-coordinate inside the rectangle
+ * \param x1 - the largest x-coordinate inside the rectangle
+ * \param y1 - the largest y-coordinate inside the rectangle
+ * \return false if no sample is inside both the box and the rectangle
+ */
+bool halfspace_rasterizer::bounds_contain_sample(const long long fixed_x[3], const long long fixed_y[3],
+                                                 const glm::ivec2 *samples, int sample_count, int x0, int y0,
+                                                 int x1, int y1)
+{
+    const long long one = 1LL << SUBPIXEL_BITS;
+    long long box_x_min = std::min(fixed_x[0], std::min(fixed_x[1], fixed_x[2]));
+    long long box_y_min = std::min(fixed_y[0], std::min(fixed_y[1], fixed_y[2]));
+    long long box_x_max = std::max(fixed_x[0], std::max(fixed_x[1], fixed_x[2]));
+    long long box_y_max = std::max(fixed_y[0], std::max(fixed_y[1], fixed_y[2]));
+
+    static const glm::ivec2 center(0, 0);
+    if (samples == nullptr) {
+        samples = &center;
+        sample_count = 1;
+    }
+    // a sample of pixel p is at p * one + offset, so the pixels whose sample is in the box are a range per axis;
+    // a sample on the box is kept, it may be on an edge that owns it
+    for (int s = 0; s < sample_count; s++) {
+        long long first_x = std::max((long long) x0, (box_x_min - samples[s].x + one - 1) >> SUBPIXEL_BITS);
+        long long last_x = std::min((long long) x1, (box_x_max - samples[s].x) >> SUBPIXEL_BITS);
+        long long first_y = std::max((long long) y0, (box_y_min - samples[s].y + one - 1) >> SUBPIXEL_BITS);
+        long long last_y = std::min((long long) y1, (box_y_max - samples[s].y) >> SUBPIXEL_BITS);
+        if (first_x <= last_x && first_y <= last_y) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * Default constructor creates an empty rasterizer, for triangle_setup to fill in
+ */
+halfspace_rasterizer::halfspace_rasterizer() : valid(false), has_area(false)
+{}
+
+/*
+ * Computes the edge functions and the bounding box of a triangle given in fixed point
+ */
+void halfspace_rasterizer::setup(const long long fixed_x[3], const long long fixed_y[3])
+{
+    long long vx[3] = {fixed_x[0], fixed_x[1], fixed_x[2]};
+    long long vy[3] = {fixed_y[0], fixed_y[1], fixed_y[2]};
+
+    this->clip_x0 = this->clip_y0 = -MAX_COORDINATE - 1;
+    this->clip_x1 = this->clip_y1 = MAX_COORDINATE + 1;
+    this->has_area = false;
+
+    // twice the signed area, the triangle is made counter-clockwise so its inside is to the left of the edges
+    long long area = (vx[1] - vx[0]) * (vy[2] - vy[0]) - (vy[1] - vy[0]) * (vx[2] - vx[0]);
+    if (area == 0) {
+        return; // degenerated, it covers no pixels
+    }
+    if (area < 0) {
+        std::swap(vx[1], vx[2]);
+        std::swap(vy[1], vy[2]);
+    }
+
+    for (int e = 0; e < 3; e++) {
+        int next = (e + 1) % 3;
+        long long dx = vx[next] - vx[e];
+        long long dy = vy[next] - vy[e];
+
+        // E(px, py) = dx * (py - vy) - dy * (px - vx), with (px, py) the fixed point position of a pixel center
+        this->step_x[e] = -dy << SUBPIXEL_BITS;
+        this->step_y[e] = dx << SUBPIXEL_BITS;
+        this->offset[e] = dy * vx[e] - dx * vy[e];
+
+        // fill convention: pixel centers on left edges (going down) and bottom edges (going right) are inside
+        bool inclusive = dy < 0 || (dy == 0 && dx > 0);
+        if (!inclusive) {
+            this->offset[e] -= 1;
+        }
+    }
+
+    // bounding box, in fixed point and in pixels
+    this->fixed_x_min = std::min(vx[0], std::min(vx[1], vx[2]));
+    this->fixed_y_min = std::min(vy[0], std::min(vy[1], vy[2]));
+    this->fixed_x_max = std::max(vx[0], std::max(vx[1], vx[2]));
+    this->fixed_y_max = std::max(vy[0], std::max(vy[1], vy[2]));
+    this->x_min = (int) ((this->fixed_x_min + (1 << SUBPIXEL_BITS) - 1) >> SUBPIXEL_BITS);
+    this->y_min = (int) ((this->fixed_y_min + (1 << SUBPIXEL_BITS) - 1) >> SUBPIXEL_BITS);
+    this->x_max = (int) (this->fixed_x_max >> SUBPIXEL_BITS);
+    this->y_max = (int) (this->fixed_y_max >> SUBPIXEL_BITS);
+    this->has_area = true;
+    this->valid = true;
+}
+
+/*
+ * Tests a square block of pixels against the three edges
+ * \param x - the x-coordinate of the lower left pixel of the block
+ * \param y - the y-coordinate of the lower left pixel of the block
+ * \param size - the width and height of the block in pixels
+ * \param crossing - if not null, receives for each edge whether it crosses the block
+ * \return whether the block is outside, inside or partially inside the triangle
+ */
+halfspace_rasterizer::block_coverage halfspace_rasterizer::test_block(int x, int y, int size, bool *crossing) const
+{
+    bool all_inside = true;
+    for (int e = 0; e < 3; e++) {
+        // the edge function is linear, so its extremes over the block are at two of the corners
+        long long corner = this->edge_value(e, x, y);
+        long long across_x = this->step_x[e] * (size - 1);
+        long long across_y = this->step_y[e] * (size - 1);
+        long long lowest = corner + std::min(across_x, 0LL) + std::min(across_y, 0LL);
+        long long highest = corner + std::max(across_x, 0LL) + std::max(across_y, 0LL);
+
+        if (highest < 0) {
+            return outside;
+        }
+        bool crosses = lowest < 0;
+        if (crossing) {
+            crossing[e] = crosses;
+        }
+        all_inside = all_inside && !crosses;
+    }
+    return all_inside ? inside : partial;
+}
+
+/*
+ * Returns the value of the edge function of edge e at the center of pixel (x, y), including the fill
+ * convention bias: the pixel is on the inner side of the edge if and only if the value is >= 0
+ */
+long long halfspace_rasterizer::edge_value(int e, int x, int y) const
+{
+    return this->step_x[e] * x + this->step_y[e] * y + this->offset[e];
+}
+
+/*
+ * Returns the bits of the pixels x ... x + 7 which are inside the bounding box
+ */
+unsigned int halfspace_rasterizer::column_mask(int x) const
+{
+    int first = std::max(this->x_min - x, 0);
+    int last = std::min(this->x_max - x, BLOCK_SIZE - 1);
+    if (first > last) {
+        return 0;
+    }
+    return ((2u << last) - 1) & ~((1u << first) - 1);
+}
+
+/*
+ * Computes the pixels of row y which are inside the triangle
+ * \param y - the row
+ * \param x_first - receives the first pixel inside
+ * \param x_last - receives the last pixel inside
+ * \return false if no pixel of the row is inside
+ */
+bool halfspace_rasterizer::row_span(int y, int &x_first, int &x_last) const
+{
+    return this->sample_span(y, 0, 0, this->x_min, this->x_max, x_first, x_last);
+}
+
+/*
+ * Computes the pixels of row y whose sample at a given offset is inside the triangle
+ * \param y - the row
+ * \param offset_x - the x-offset of the sample from the pixel center, in 1/16 pixel
+ * \param offset_y - the y-offset of the sample from the pixel center, in 1/16 pixel
+ * \param x_low - the first pixel to consider
+ * \param x_high - the last pixel to consider
+ * \param x_first - receives the first pixel whose sample is inside
+ * \param x_last - receives the last pixel whose sample is inside
+ * \return false if no sample of the row is inside
+ */
+bool halfspace_rasterizer::sample_span(int y, int offset_x, int offset_y, int x_low, int x_high,
+                                       int &x_first, int &x_last) const
+{
+    long long first = x_low;
+    long long last = x_high;
+    for (int e = 0; e < 3; e++) {
+        // the steps are multiples of 16, so the edge function moves exactly by step / 16 per 1/16 pixel
+        long long sample = (this->step_x[e] * offset_x + this->step_y[e] * offset_y) / 16;
+
+        // solve step_x * x + value >= 0 for x, rounding to the pixels on the inner side of the edge
+        long long value = this->step_y[e] * y + this->offset[e] + sample;
+        long long step = this->step_x[e];
+        if (step > 0) {
+            long long bound = -value;
+            first = std::max(first, bound >= 0 ? (bound + step - 1) / step : -((-bound) / step));
+        } else if (step < 0) {
+            step = -step;
+            last = std::min(last, value >= 0 ? value / step : -((-value + step - 1) / step));
+        } else if (value < 0) {
+            return false;
+        }
+    }
+    if (first > last) {
+        return false;
+    }
+    x_first = (int) first;
+    x_last = (int) last;
+    return true;
+}
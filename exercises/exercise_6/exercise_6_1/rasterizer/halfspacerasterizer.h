@@ -0,0 +1,473 @@
+#ifndef __HALFSPACE_RASTERIZER_H__
+#define __HALFSPACE_RASTERIZER_H__
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+/**
+ * \class halfspace_rasterizer
+ * A class which rasterizes a triangle by evaluating its three edge functions, instead of walking its edges.
+ * The screen is traversed in 8x8 pixel blocks: blocks outside any edge are rejected and blocks inside all
+ * edges are accepted as a whole; only the blocks crossed by an edge are tested pixel by pixel, eight pixels
+ * of a row at a time (AVX2, two SSE2 registers, or a scalar loop when neither is available).
+ *
+ * Vertices and samples are kept in fixed point with SUBPIXEL_BITS fractional bits, and the pixel centers are
+ * at integer coordinates. A pixel center that lies exactly on an edge belongs to the triangle if the edge is a
+ * left edge or a horizontal bottom edge. With y pointing up this is the usual top-left rule mirrored, i.e. the
+ * bottom row and the left column of a triangle are drawn and its top row and right column are not, so the
+ * triangles of a mesh cover each pixel center on their shared edges exactly once.
+ */
+class halfspace_rasterizer {
+public:
+    /**
+     * Number of fractional bits of the fixed point vertex coordinates
+     */
+    static const int SUBPIXEL_BITS = 4;
+
+    /**
+     * Largest absolute pixel coordinate of a vertex, it keeps the per-block edge values within 32 bits
+     */
+    static const int MAX_COORDINATE = 1 << 14;
+
+    /**
+     * Largest number of samples per pixel of a multisample pattern
+     */
+    static const int MAX_SAMPLES = 8;
+
+    /**
+     * Parameterized constructor creates an instance of a half-space triangle rasterizer
+     * \param x1 - the x-coordinate of the first vertex
+     * \param y1 - the y-coordinate of the first vertex
+     * \param x2 - the x-coordinate of the second vertex
+     * \param y2 - the y-coordinate of the second vertex
+     * \param x3 - the x-coordinate of the third vertex
+     * \param y3 - the y-coordinate of the third vertex
+     */
+    halfspace_rasterizer(int x1, int y1, int x2, int y2, int x3, int y3);
+
+    /**
+     * Parameterized constructor creates an instance of a half-space triangle rasterizer from subpixel positions
+     * \param fixed_x - the x-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+     * \param fixed_y - the y-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+     */
+    halfspace_rasterizer(const long long fixed_x[3], const long long fixed_y[3]);
+
+    /**
+     * Destroys the current instance of the half-space rasterizer
+     */
+    virtual ~halfspace_rasterizer();
+
+    /**
+     * Restricts the rasterization to a rectangle, e.g. the screen or a tile
+     * \param x0 - the smallest x-coordinate inside the rectangle
+     * \param y0 - the smallest y-coordinate inside the rectangle
+     * \param x1 - the largest x-coordinate inside the rectangle
+     * \param y1 - the largest y-coordinate inside the rectangle
+     */
+    void clip(int x0, int y0, int x1, int y1);
+
+    /**
+     * Checks if the triangle covers any pixel center inside its (clipped) bounding box
+     * \return false if the triangle is degenerated or clipped away, else true
+     */
+    bool more_fragments() const;
+
+    /**
+     * Rasterizes the triangle
+     * \param visit - called as visit(x, y, mask) for each row of eight pixels (x, y) ... (x + 7, y) with at least
+     *                one pixel inside the triangle; bit i of mask is set if pixel (x + i, y) is inside
+     */
+    template <typename CoverageVisitor>
+    void rasterize(CoverageVisitor &visit) const;
+
+    /**
+     * Visits the pixels inside the triangle as horizontal spans, without allocating memory. The spans are
+     * computed directly from the edge functions, one row at a time.
+     * \param visit - called as visit(y, x_begin, x_end) for each run of pixels (x_begin, y) ... (x_end - 1, y)
+     */
+    template <typename SpanVisitor>
+    void for_each_span(SpanVisitor &visit) const;
+
+    /**
+     * Visits the pixels with at least one sample inside the triangle, for multisample anti-aliasing. The samples
+     * are tested with the same edge functions and fill convention as the pixel centers, and the pixels of a row
+     * are found by solving the edge functions once per sample, so the cost per pixel is only building its mask.
+     * \param samples - the sample positions relative to the pixel center, in 1/16 pixel, within half a pixel
+     * \param sample_count - the number of samples, at most MAX_SAMPLES
+     * \param visit - called as visit(x, y, mask) for each pixel, bit i of mask is set if sample i is inside
+     */
+    template <typename SampleVisitor>
+    void for_each_sample_mask(const glm::ivec2 *samples, int sample_count, SampleVisitor &visit) const;
+
+    /**
+     * Returns a vector which contains all the pixels inside the triangle
+     */
+    std::vector<glm::ivec2> all_pixels() const;
+
+    /**
+     * Returns the standard sample pattern (the one of Direct3D, with y pointing up) for 2, 4 or 8 samples
+     * \param sample_count - the number of samples per pixel
+     * \return sample_count positions relative to the pixel center, in 1/16 pixel
+     */
+    static const glm::ivec2 *sample_pattern(int sample_count);
+
+    /**
+     * Checks if the bounding box of a triangle contains a sample inside a rectangle, without setting it up. A
+     * triangle whose box contains no sample covers none, e.g. a small triangle between the pixel centers
+     * \param fixed_x - the x-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+     * \param fixed_y - the y-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+     * \param samples - the sample positions relative to the pixel center, in 1/16 pixel, nullptr for the centers
+     * \param sample_count - the number of samples
+     * \param x0 - the smallest x-coordinate inside the rectangle
+     * \param y0 - the smallest y-coordinate inside the rectangle
+     * \param x1 - the largest x-coordinate inside the rectangle
+     * \param y1 - the largest y-coordinate inside the rectangle
+     * \return false if no sample is inside both the box and the rectangle
+     */
+    static bool bounds_contain_sample(const long long fixed_x[3], const long long fixed_y[3],
+                                      const glm::ivec2 *samples, int sample_count, int x0, int y0, int x1, int y1);
+
+private:
+    /**
+     * triangle_setup stores the edge functions and bounding boxes of many triangles, and rebuilds the
+     * rasterizers from them
+     */
+    friend class triangle_setup;
+
+    /**
+     * Default constructor creates an empty rasterizer, for triangle_setup to fill in
+     */
+    halfspace_rasterizer();
+
+    /**
+     * Computes the edge functions and the bounding box of a triangle given in fixed point
+     */
+    void setup(const long long fixed_x[3], const long long fixed_y[3]);
+
+    /**
+     * Size of the blocks, in pixels, at each level of the traversal
+     */
+    static const int BLOCK_SIZE = 8;
+    static const int COARSE_BLOCK_SIZE = 64;
+
+    /**
+     * Result of testing a block of pixels against the three edges
+     */
+    enum block_coverage {outside, inside, partial};
+
+    /**
+     * Tests a square block of pixels against the three edges
+     * \param x - the x-coordinate of the lower left pixel of the block
+     * \param y - the y-coordinate of the lower left pixel of the block
+     * \param size - the width and height of the block in pixels
+     * \param crossing - if not null, receives for each edge whether it crosses the block
+     * \return whether the block is outside, inside or partially inside the triangle
+     */
+    block_coverage test_block(int x, int y, int size, bool *crossing = nullptr) const;
+
+    /**
+     * Visits the 8x8 blocks inside a coarse block
+     */
+    template <typename CoverageVisitor>
+    void rasterize_coarse_block(int x, int y, CoverageVisitor &visit) const;
+
+    /**
+     * Visits every row of a block which lies completely inside the triangle
+     */
+    template <typename CoverageVisitor>
+    void accept_block(int x, int y, int size, CoverageVisitor &visit) const;
+
+    /**
+     * Visits the rows of an 8x8 block which is crossed by at least one edge, testing 8 pixels at a time
+     */
+    template <typename CoverageVisitor>
+    void rasterize_block(int x, int y, const bool *crossing, CoverageVisitor &visit) const;
+
+    /**
+     * Returns the value of the edge function of edge e at the center of pixel (x, y), including the fill
+     * convention bias: the pixel is on the inner side of the edge if and only if the value is >= 0
+     */
+    long long edge_value(int e, int x, int y) const;
+
+    /**
+     * Returns the bits of the pixels x ... x + 7 which are inside the bounding box
+     */
+    unsigned int column_mask(int x) const;
+
+    /**
+     * Computes the pixels of row y which are inside the triangle
+     * \param y - the row
+     * \param x_first - receives the first pixel inside
+     * \param x_last - receives the last pixel inside
+     * \return false if no pixel of the row is inside
+     */
+    bool row_span(int y, int &x_first, int &x_last) const;
+
+    /**
+     * Computes the pixels of row y whose sample at a given offset is inside the triangle
+     * \param y - the row
+     * \param offset_x - the x-offset of the sample from the pixel center, in 1/16 pixel
+     * \param offset_y - the y-offset of the sample from the pixel center, in 1/16 pixel
+     * \param x_low - the first pixel to consider
+     * \param x_high - the last pixel to consider
+     * \param x_first - receives the first pixel whose sample is inside
+     * \param x_last - receives the last pixel whose sample is inside
+     * \return false if no sample of the row is inside
+     */
+    bool sample_span(int y, int offset_x, int offset_y, int x_low, int x_high, int &x_first, int &x_last) const;
+
+    /**
+     * The edge function of edge e, evaluated at pixel centers, is
+     * edge_value(x, y) = step_x[e] * x + step_y[e] * y + offset[e]
+     */
+    long long step_x[3];
+    long long step_y[3];
+    long long offset[3];
+
+    /**
+     * The bounding box of the triangle, clipped by clip()
+     */
+    int x_min; int y_min;
+    int x_max; int y_max;
+
+    /**
+     * The bounding box of the vertices in fixed point, and the clipping rectangle, for the sample traversal
+     */
+    long long fixed_x_min; long long fixed_y_min;
+    long long fixed_x_max; long long fixed_y_max;
+    int clip_x0; int clip_y0;
+    int clip_x1; int clip_y1;
+
+    /**
+     * valid is false if the triangle does not cover any pixel center
+     */
+    bool valid;
+
+    /**
+     * has_area is false if the triangle is degenerated
+     */
+    bool has_area;
+};
+
+
+template <typename CoverageVisitor>
+void halfspace_rasterizer::rasterize(CoverageVisitor &visit) const
+{
+    if (!this->valid) {
+        return;
+    }
+
+    // blocks are aligned to multiples of their size, this rounds towards -infinity also for negative values
+    int x_start = this->x_min & ~(COARSE_BLOCK_SIZE - 1);
+    int y_start = this->y_min & ~(COARSE_BLOCK_SIZE - 1);
+
+    for (int y = y_start; y <= this->y_max; y += COARSE_BLOCK_SIZE) {
+        for (int x = x_start; x <= this->x_max; x += COARSE_BLOCK_SIZE) {
+            switch (this->test_block(x, y, COARSE_BLOCK_SIZE)) {
+                case outside:
+                    break;
+                case inside:
+                    this->accept_block(x, y, COARSE_BLOCK_SIZE, visit);
+                    break;
+                case partial:
+                    this->rasterize_coarse_block(x, y, visit);
+                    break;
+            }
+        }
+    }
+}
+
+template <typename SpanVisitor>
+void halfspace_rasterizer::for_each_span(SpanVisitor &visit) const
+{
+    if (!this->valid) {
+        return;
+    }
+
+    int x_first, x_last;
+    for (int y = this->y_min; y <= this->y_max; y++) {
+        if (this->row_span(y, x_first, x_last)) {
+            visit(y, x_first, x_last + 1);
+        }
+    }
+}
+
+template <typename SampleVisitor>
+void halfspace_rasterizer::for_each_sample_mask(const glm::ivec2 *samples, int sample_count, SampleVisitor &visit) const
+{
+    if (!this->has_area) {
+        return;
+    }
+    if (sample_count < 1 || sample_count > MAX_SAMPLES) {
+        throw std::runtime_error("halfspace_rasterizer::for_each_sample_mask(): Invalid sample count");
+    }
+
+    // the samples are within half a pixel of the centers, so the bounding box grows by half a pixel
+    const long long one = 1LL << SUBPIXEL_BITS;
+    const long long half = one >> 1;
+    int x_low = std::max(this->clip_x0, (int) ((this->fixed_x_min - half + one - 1) >> SUBPIXEL_BITS));
+    int y_low = std::max(this->clip_y0, (int) ((this->fixed_y_min - half + one - 1) >> SUBPIXEL_BITS));
+    int x_high = std::min(this->clip_x1, (int) ((this->fixed_x_max + half) >> SUBPIXEL_BITS));
+    int y_high = std::min(this->clip_y1, (int) ((this->fixed_y_max + half) >> SUBPIXEL_BITS));
+
+    int x_first[MAX_SAMPLES], x_last[MAX_SAMPLES];
+    for (int y = y_low; y <= y_high; y++) {
+        // one span per sample, the pixels of the row are the union of the spans
+        int row_first = x_high + 1, row_last = x_low - 1;
+        for (int s = 0; s < sample_count; s++) {
+            if (this->sample_span(y, samples[s].x, samples[s].y, x_low, x_high, x_first[s], x_last[s])) {
+                row_first = std::min(row_first, x_first[s]);
+                row_last = std::max(row_last, x_last[s]);
+            } else {
+                x_first[s] = x_high + 1;
+                x_last[s] = x_low - 1;
+            }
+        }
+        for (int x = row_first; x <= row_last; x++) {
+            unsigned int mask = 0;
+            for (int s = 0; s < sample_count; s++) {
+                mask |= (unsigned int) (x >= x_first[s] && x <= x_last[s]) << s;
+            }
+            if (mask != 0) {
+                visit(x, y, mask);
+            }
+        }
+    }
+}
+
+template <typename CoverageVisitor>
+void halfspace_rasterizer::rasterize_coarse_block(int x, int y, CoverageVisitor &visit) const
+{
+    int x_start = std::max(x, this->x_min & ~(BLOCK_SIZE - 1));
+    int y_start = std::max(y, this->y_min & ~(BLOCK_SIZE - 1));
+    int x_stop = std::min(x + COARSE_BLOCK_SIZE - 1, this->x_max);
+    int y_stop = std::min(y + COARSE_BLOCK_SIZE - 1, this->y_max);
+
+    bool crossing[3];
+    for (int by = y_start; by <= y_stop; by += BLOCK_SIZE) {
+        for (int bx = x_start; bx <= x_stop; bx += BLOCK_SIZE) {
+            switch (this->test_block(bx, by, BLOCK_SIZE, crossing)) {
+                case outside:
+                    break;
+                case inside:
+                    this->accept_block(bx, by, BLOCK_SIZE, visit);
+                    break;
+                case partial:
+                    this->rasterize_block(bx, by, crossing, visit);
+                    break;
+            }
+        }
+    }
+}
+
+template <typename CoverageVisitor>
+void halfspace_rasterizer::accept_block(int x, int y, int size, CoverageVisitor &visit) const
+{
+    // a block inside the triangle is inside its bounding box too, but it may be outside the clip rectangle
+    int x_start = std::max(x, this->x_min & ~(BLOCK_SIZE - 1));
+    int y_start = std::max(y, this->y_min);
+    int x_stop = std::min(x + size - 1, this->x_max);
+    int y_stop = std::min(y + size - 1, this->y_max);
+
+    for (int row = y_start; row <= y_stop; row++) {
+        for (int column = x_start; column <= x_stop; column += BLOCK_SIZE) {
+            unsigned int mask = this->column_mask(column);
+            if (mask) {
+                visit(column, row, mask);
+            }
+        }
+    }
+}
+
+template <typename CoverageVisitor>
+void halfspace_rasterizer::rasterize_block(int x, int y, const bool *crossing, CoverageVisitor &visit) const
+{
+    // Only the edges crossing the block are tested. For those the edge values inside the block are bounded by
+    // 7 * (|step_x| + |step_y|), which fits in 32 bits; an edge which does not cross the block contributes 0.
+    // A pixel is inside if all its edge values are >= 0, i.e. if the bitwise or of the values is >= 0.
+    int start[3];
+    int lane_step[3];
+    int row_step[3];
+    for (int e = 0; e < 3; e++) {
+        start[e] = crossing[e] ? (int) this->edge_value(e, x, y) : 0;
+        lane_step[e] = crossing[e] ? (int) this->step_x[e] : 0;
+        row_step[e] = crossing[e] ? (int) this->step_y[e] : 0;
+    }
+
+    unsigned int columns = this->column_mask(x);
+    int y_start = std::max(y, this->y_min);
+    int y_stop = std::min(y + BLOCK_SIZE - 1, this->y_max);
+    for (int e = 0; e < 3; e++) {
+        start[e] += (y_start - y) * row_step[e];
+    }
+
+#if defined(__AVX2__)
+    const __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i value[3], row_increment[3];
+    for (int e = 0; e < 3; e++) {
+        value[e] = _mm256_add_epi32(_mm256_set1_epi32(start[e]),
+                                    _mm256_mullo_epi32(lane_index, _mm256_set1_epi32(lane_step[e])));
+        row_increment[e] = _mm256_set1_epi32(row_step[e]);
+    }
+    for (int row = y_start; row <= y_stop; row++) {
+        __m256i all = _mm256_or_si256(value[0], _mm256_or_si256(value[1], value[2]));
+        unsigned int mask = ~(unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(all)) & columns;
+        if (mask) {
+            visit(x, row, mask);
+        }
+        for (int e = 0; e < 3; e++) {
+            value[e] = _mm256_add_epi32(value[e], row_increment[e]);
+        }
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    // SSE2 has no 32 bit multiply, the lanes are set up directly instead
+    __m128i low[3], high[3], row_increment[3];
+    for (int e = 0; e < 3; e++) {
+        int s = start[e], d = lane_step[e];
+        low[e] = _mm_setr_epi32(s, s + d, s + 2 * d, s + 3 * d);
+        high[e] = _mm_setr_epi32(s + 4 * d, s + 5 * d, s + 6 * d, s + 7 * d);
+        row_increment[e] = _mm_set1_epi32(row_step[e]);
+    }
+    for (int row = y_start; row <= y_stop; row++) {
+        __m128i all_low = _mm_or_si128(low[0], _mm_or_si128(low[1], low[2]));
+        __m128i all_high = _mm_or_si128(high[0], _mm_or_si128(high[1], high[2]));
+        unsigned int sign = (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(all_low)) |
+                            ((unsigned int) _mm_movemask_ps(_mm_castsi128_ps(all_high)) << 4);
+        unsigned int mask = ~sign & columns;
+        if (mask) {
+            visit(x, row, mask);
+        }
+        for (int e = 0; e < 3; e++) {
+            low[e] = _mm_add_epi32(low[e], row_increment[e]);
+            high[e] = _mm_add_epi32(high[e], row_increment[e]);
+        }
+    }
+#else
+    for (int row = y_start; row <= y_stop; row++) {
+        unsigned int mask = 0;
+        for (int i = 0; i < BLOCK_SIZE; i++) {
+            int all = (start[0] + i * lane_step[0]) | (start[1] + i * lane_step[1]) | (start[2] + i * lane_step[2]);
+            mask |= (all >= 0 ? 1u : 0u) << i;
+        }
+        mask &= columns;
+        if (mask) {
+            visit(x, row, mask);
+        }
+        for (int e = 0; e < 3; e++) {
+            start[e] += row_step[e];
+        }
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include "hierarchicaldepth.h"
+
+
+/*
+ * \class hierarchical_depth
+ * The farthest depth of each 8x8 pixel tile of a depth buffer, recomputed lazily, for occlusion culling.
+ */
+
+/*
+ * Parameterized constructor creates the tiles of a depth buffer, cleared to the far plane
+ * \param width - the width of the depth buffer in pixels
+ * \param height - the height of the depth buffer in pixels
+ */
+hierarchical_depth::hierarchical_depth(int width, int height) : width(width), height(height)
+{
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("hierarchical_depth::hierarchical_depth(): Invalid size");
+    }
+    const int tile = 1 << TILE_BITS;
+    this->tiles_x = (width + tile - 1) >> TILE_BITS;
+    this->tiles_y = (height + tile - 1) >> TILE_BITS;
+    this->max_depth.resize(this->tiles_x * this->tiles_y);
+    this->marked.resize(this->tiles_x * this->tiles_y);
+    this->clear();
+}
+
+/*
+ * Destroys the current instance of the hierarchical depth
+ */
+hierarchical_depth::~hierarchical_depth()
+{}
+
+/*
+ * Sets every tile to a depth, after the depth buffer was cleared to it
+ * \param depth - the depth of the cleared buffer
+ */
+void hierarchical_depth::clear(float depth)
+{
+    std::fill(this->max_depth.begin(), this->max_depth.end(), depth);
+    std::fill(this->marked.begin(), this->marked.end(), 0);
+}
+
+/*
+ * Marks the tiles under a rectangle, after depths were written inside it
+ * \param x0 - the smallest x-coordinate inside the rectangle
+ * \param y0 - the smallest y-coordinate inside the rectangle
+ * \param x1 - the largest x-coordinate inside the rectangle
+ * \param y1 - the largest y-coordinate inside the rectangle
+ */
+void hierarchical_depth::invalidate(int x0, int y0, int x1, int y1)
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, this->width - 1);
+    y1 = std::min(y1, this->height - 1);
+    for (int ty = y0 >> TILE_BITS; ty <= y1 >> TILE_BITS && x0 <= x1; ty++) {
+        std::fill_n(this->marked.begin() + (x0 >> TILE_BITS) + ty * this->tiles_x,
+                    (x1 >> TILE_BITS) - (x0 >> TILE_BITS) + 1, 1);
+    }
+}
+
+/*
+ * Marks all the tiles, e.g. after the depth buffer was replaced or changed outside the pipeline
+ */
+void hierarchical_depth::invalidate()
+{
+    std::fill(this->marked.begin(), this->marked.end(), 1);
+}
@@ -0,0 +1,122 @@
+#ifndef __HIERARCHICAL_DEPTH_H__
+#define __HIERARCHICAL_DEPTH_H__
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * \class hierarchical_depth
+ * A low resolution copy of a depth buffer, for occlusion culling: the farthest depth of each 8x8 pixel tile.
+ * An object whose nearest depth is behind the farthest depth of every tile under its screen rectangle is hidden
+ * by what was already drawn, so its triangles do not need to be drawn at all.
+ *
+ * The tiles are not recomputed on every depth write. The raster stage marks the tiles under each triangle it
+ * draws, and a marked tile is recomputed from the depth buffer only when a query needs it, so the cost is paid
+ * once per tile and query instead of once per fragment.
+ */
+class hierarchical_depth {
+public:
+    /**
+     * log2 of the width and height of a tile, in pixels
+     */
+    static const int TILE_BITS = 3;
+
+    /**
+     * Parameterized constructor creates the tiles of a depth buffer, cleared to the far plane
+     * \param width - the width of the depth buffer in pixels
+     * \param height - the height of the depth buffer in pixels
+     */
+    hierarchical_depth(int width, int height);
+
+    /**
+     * Destroys the current instance of the hierarchical depth
+     */
+    virtual ~hierarchical_depth();
+
+    /**
+     * Sets every tile to a depth, after the depth buffer was cleared to it
+     * \param depth - the depth of the cleared buffer
+     */
+    void clear(float depth = 1.f);
+
+    /**
+     * Marks the tiles under a rectangle, after depths were written inside it
+     * \param x0 - the smallest x-coordinate inside the rectangle
+     * \param y0 - the smallest y-coordinate inside the rectangle
+     * \param x1 - the largest x-coordinate inside the rectangle
+     * \param y1 - the largest y-coordinate inside the rectangle
+     */
+    void invalidate(int x0, int y0, int x1, int y1);
+
+    /**
+     * Marks all the tiles, e.g. after the depth buffer was replaced or changed outside the pipeline
+     */
+    void invalidate();
+
+    /**
+     * Checks if an object is hidden by the depth buffer
+     * \param x0 - the smallest x-coordinate of the screen rectangle of the object
+     * \param y0 - the smallest y-coordinate of the screen rectangle of the object
+     * \param x1 - the largest x-coordinate of the screen rectangle of the object
+     * \param y1 - the largest y-coordinate of the screen rectangle of the object
+     * \param depth - the nearest depth of the object
+     * \param farthest - called as farthest(x, y) to recompute the marked tiles, it returns the farthest depth
+     *                   stored at pixel (x, y), e.g. of all its samples
+     * \return true if the depth buffer is nearer than depth at every pixel of the rectangle, or the rectangle is
+     *         off the screen
+     */
+    template <typename DepthReader>
+    bool occluded(int x0, int y0, int x1, int y1, float depth, DepthReader &farthest);
+
+private:
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+
+    /**
+     * The farthest depth of each tile, valid if the tile is not marked
+     */
+    std::vector<float> max_depth;
+    std::vector<unsigned char> marked;
+};
+
+
+template <typename DepthReader>
+bool hierarchical_depth::occluded(int x0, int y0, int x1, int y1, float depth, DepthReader &farthest)
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, this->width - 1);
+    y1 = std::min(y1, this->height - 1);
+    if (x0 > x1 || y0 > y1) {
+        return true;
+    }
+
+    for (int ty = y0 >> TILE_BITS; ty <= y1 >> TILE_BITS; ty++) {
+        for (int tx = x0 >> TILE_BITS; tx <= x1 >> TILE_BITS; tx++) {
+            int tile = tx + ty * this->tiles_x;
+            if (this->marked[tile]) {
+                // only the tiles a query reaches are recomputed
+                int px_end = std::min((tx + 1) << TILE_BITS, this->width);
+                int py_end = std::min((ty + 1) << TILE_BITS, this->height);
+                float tile_max = 0.f;
+                for (int py = ty << TILE_BITS; py < py_end; py++) {
+                    for (int px = tx << TILE_BITS; px < px_end; px++) {
+                        tile_max = std::max(tile_max, (float) farthest(px, py));
+                    }
+                }
+                this->max_depth[tile] = tile_max;
+                this->marked[tile] = 0;
+            }
+            // the whole tile counts, so the test is conservative where the rectangle covers part of a tile
+            if (depth < this->max_depth[tile]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef __LINE_KERNEL_H__
+#define __LINE_KERNEL_H__
+
+#include <cstdlib>
+
+/**
+ * \class line_kernel
+ * The inner loop of the line rasterizers, specialized at compile time on the octant of the line: its major
+ * axis and the direction of its steps along both axes. The octant is picked once per line by rasterize(), so
+ * the loop has no indirect call and no branch on the direction, only the one on the decision variable.
+ *
+ * The decision variable and the tie-break are the ones of LineRasterizer: when the line passes exactly
+ * between two pixels, it steps along its minor axis if it runs in the positive direction of its major axis.
+ */
+class line_kernel {
+public:
+    /**
+     * Visits the pixels of the line from (x1, y1) to (x2, y2), both included, in the order LineRasterizer
+     * visits them. Like LineRasterizer, an empty line has no pixels.
+     * \param skip_first - true if the first pixel is not visited, e.g. it was the last one of the line before
+     * \param skip_last - true if the last pixel is not visited
+     * \param visit - called as visit(x, y) for each pixel
+     */
+    template <typename PixelVisitor>
+    static void rasterize(int x1, int y1, int x2, int y2, bool skip_first, bool skip_last, PixelVisitor &visit);
+
+    /**
+     * Visits count pixels of a line, starting at (major, minor), with the specialization of its octant
+     * \param x_dominant - true if the major axis is x
+     * \param major_step - the direction along the major axis, 1 or -1
+     * \param minor_step - the direction along the minor axis, 1 or -1
+     * \param d - the decision variable at the first pixel
+     * \param abs_2major - 2 * |delta| along the major axis
+     * \param abs_2minor - 2 * |delta| along the minor axis
+     * \param skip - the number of pixels to step over before the first visited one
+     * \param count - the number of visited pixels
+     * \param visit - called as visit(x, y) for each pixel
+     */
+    template <typename PixelVisitor>
+    static void dispatch(bool x_dominant, int major_step, int minor_step, int major, int minor, int d,
+                         int abs_2major, int abs_2minor, int skip, int count, PixelVisitor &visit);
+
+    /**
+     * Visits count pixels of a line, starting at (major, minor)
+     * \param d - the decision variable at the first pixel
+     * \param abs_2major - 2 * |delta| along the major axis
+     * \param abs_2minor - 2 * |delta| along the minor axis
+     * \param skip - the number of pixels to step over before the first visited one
+     * \param count - the number of visited pixels
+     * \param visit - called as visit(x, y) for each pixel
+     */
+    template <bool X_DOMINANT, int MAJOR_STEP, int MINOR_STEP, typename PixelVisitor>
+    static void walk(int major, int minor, int d, int abs_2major, int abs_2minor, int skip, int count,
+                     PixelVisitor &visit);
+};
+
+
+template <typename PixelVisitor>
+void line_kernel::rasterize(int x1, int y1, int x2, int y2, bool skip_first, bool skip_last, PixelVisitor &visit)
+{
+    int dx = x2 - x1;
+    int dy = y2 - y1;
+    // the same choice of the major axis as LineRasterizer, the diagonals are y-dominant
+    bool x_dominant = std::abs(dx) > std::abs(dy);
+    int major_delta = x_dominant ? dx : dy;
+    if (major_delta == 0) {
+        return;
+    }
+    int abs_2major = std::abs(major_delta) << 1;
+    int abs_2minor = std::abs(x_dominant ? dy : dx) << 1;
+    int d = abs_2minor - (abs_2major >> 1);
+    int skip = skip_first ? 1 : 0;
+    int count = std::abs(major_delta) + 1 - skip - (skip_last ? 1 : 0);
+
+    // as in LineRasterizer, a zero delta steps in the positive direction
+    int major_step = major_delta < 0 ? -1 : 1;
+    int minor_step = (x_dominant ? dy : dx) < 0 ? -1 : 1;
+    dispatch(x_dominant, major_step, minor_step, x_dominant ? x1 : y1, x_dominant ? y1 : x1, d, abs_2major,
+             abs_2minor, skip, count, visit);
+}
+
+template <typename PixelVisitor>
+void line_kernel::dispatch(bool x_dominant, int major_step, int minor_step, int major, int minor, int d,
+                           int abs_2major, int abs_2minor, int skip, int count, PixelVisitor &visit)
+{
+    int octant = (x_dominant ? 4 : 0) | (major_step < 0 ? 2 : 0) | (minor_step < 0 ? 1 : 0);
+    switch (octant) {
+        case 0: walk<false,  1,  1>(major, minor, d, abs_2major, abs_2minor, skip, count, visit); break;
+        case 1: walk<false,  1, -1>(major, minor, d, abs_2major, abs_2minor, skip, count, visit); break;
+        case 2: walk<false, -1,  1>(major, minor, d, abs_2major, abs_2minor, skip, count, visit); break;
+        case 3: walk<false, -1, -1>(major, minor, d, abs_2major, abs_2minor, skip, count, visit); break;
+        case 4: walk<true,   1,  1>(major, minor, d, abs_2major, abs_2minor, skip, count, visit); break;
+        case 5: walk<true,   1, -1>(major, minor, d, abs_2major, abs_2minor, skip, count, visit); break;
+        case 6: walk<true,  -1,  1>(major, minor, d, abs_2major, abs_2minor, skip, count, visit); break;
+        default: walk<true, -1, -1>(major, minor, d, abs_2major, abs_2minor, skip, count, visit); break;
+    }
+}
+
+template <bool X_DOMINANT, int MAJOR_STEP, int MINOR_STEP, typename PixelVisitor>
+void line_kernel::walk(int major, int minor, int d, int abs_2major, int abs_2minor, int skip, int count,
+                       PixelVisitor &visit)
+{
+    // with MAJOR_STEP known, the tie-break of LineRasterizer is either d > 0 or d >= 0
+    const int threshold = MAJOR_STEP > 0 ? 0 : 1;
+    auto step = [&]() {
+        if (d >= threshold) {
+            minor += MINOR_STEP;
+            d -= abs_2major;
+        }
+        major += MAJOR_STEP;
+        d += abs_2minor;
+    };
+
+    for (int i = 0; i < skip; i++) {
+        step();
+    }
+    for (int i = 0; i < count; i++) {
+        if (X_DOMINANT) {
+            visit(major, minor);
+        } else {
+            visit(minor, major);
+        }
+        step();
+    }
+}
+
+#endif
@@ -11,6 +11,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/integer.hpp>
 
+#include "linekernel.h"
+
 
 /**
  * \class LineRasterizer
@@ -58,6 +60,13 @@ public:
      */
     std::vector<glm::ivec2> all_pixels();
 
+    /**
+     * Visits the pixels of the line as horizontal spans, without allocating memory. The remaining pixels are
+     * walked by line_kernel, specialized on the octant of the line, instead of one next_fragment() each
+     * \param visit - called as visit(y, x_begin, x_end) for each run of pixels (x_begin, y) ... (x_end - 1, y)
+     */
+    template <typename SpanVisitor>
+    void for_each_span(SpanVisitor &visit);
 
 
     /**
@@ -145,4 +154,46 @@ private:
     void (LineRasterizer::*innerloop)();
 };
 
+
+template <typename SpanVisitor>
+void LineRasterizer::for_each_span(SpanVisitor &visit)
+{
+    if (!this->more_fragments()) {
+        return;
+    }
+
+    // the current span, x_last is inclusive
+    int y = this->y_current;
+    int x_first = this->x_current;
+    int x_last = this->x_current - 1;
+    auto add = [&](int x, int y_pixel) {
+        if (y_pixel == y && x == x_last + 1) {
+            x_last++;
+        } else if (y_pixel == y && x == x_first - 1) {
+            x_first--; // lines drawn from right to left
+        } else {
+            visit(y, x_first, x_last + 1);
+            y = y_pixel;
+            x_first = x_last = x;
+        }
+    };
+
+    // the pixels from the current one to the last one, as next_fragment() would step through them
+    bool x_dominant = this->innerloop == &LineRasterizer::x_dominant_innerloop;
+    int count = x_dominant ? std::abs(this->x_stop - this->x_current) + 1 : std::abs(this->y_stop - this->y_current) + 1;
+    if (x_dominant) {
+        line_kernel::dispatch(true, this->x_step, this->y_step, this->x_current, this->y_current, this->d,
+                              this->abs_2dx, this->abs_2dy, 0, count, add);
+    } else {
+        line_kernel::dispatch(false, this->y_step, this->x_step, this->y_current, this->x_current, this->d,
+                              this->abs_2dy, this->abs_2dx, 0, count, add);
+    }
+    visit(y, x_first, x_last + 1);
+
+    // the line is done, as after the last next_fragment()
+    this->x_current = this->x_stop;
+    this->y_current = this->y_stop;
+    this->valid = false;
+}
+
 #endif
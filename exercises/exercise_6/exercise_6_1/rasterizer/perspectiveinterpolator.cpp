@@ -0,0 +1,132 @@
+#include "perspectiveinterpolator.h"
+
+
+/*
+ * \class perspective_interpolator
+ * A class which interpolates the depth and the per-vertex attributes of a triangle over its pixels, with
+ * perspective correction. Depth, 1/w and attribute/w are linear in screen space and are walked incrementally.
+ */
+
+/*
+ * Parameterized constructor creates an instance of a perspective interpolator
+ * \param screen - the screen position (x, y), depth (z) and clip space w of the three vertices
+ * \param attributes - the attributes of the three vertices
+ * \param attribute_count - the number of attributes per vertex
+ */
+perspective_interpolator::perspective_interpolator(const glm::vec4 screen[3], const float *const attributes[3],
+                                                   int attribute_count)
+    : attribute_count(attribute_count), z(0.f), inverse_w(0.f)
+{
+    if (attribute_count < 0 || attribute_count > MAX_ATTRIBUTES) {
+        throw std::runtime_error("perspective_interpolator::perspective_interpolator(): Too many attributes");
+    }
+
+    this->x0 = screen[0].x;
+    this->y0 = screen[0].y;
+    this->e1x = screen[1].x - screen[0].x;
+    this->e1y = screen[1].y - screen[0].y;
+    this->e2x = screen[2].x - screen[0].x;
+    this->e2y = screen[2].y - screen[0].y;
+    float area = this->e1x * this->e2y - this->e1y * this->e2x;
+    // a degenerated triangle covers no pixels, any finite plane will do
+    this->inverse_area = area != 0.f ? 1.f / area : 0.f;
+
+    float inverse_w[3] = {1.f / screen[0].w, 1.f / screen[1].w, 1.f / screen[2].w};
+
+    this->z_plane = this->make_plane(screen[0].z, screen[1].z, screen[2].z);
+    this->inverse_w_plane = this->make_plane(inverse_w[0], inverse_w[1], inverse_w[2]);
+    for (int i = 0; i < attribute_count; i++) {
+        this->attribute_planes[i] = this->make_plane(attributes[0][i] * inverse_w[0],
+                                                     attributes[1][i] * inverse_w[1],
+                                                     attributes[2][i] * inverse_w[2]);
+    }
+}
+
+/*
+ * Destroys the current instance of the perspective interpolator
+ */
+perspective_interpolator::~perspective_interpolator()
+{}
+
+/*
+ * Moves to the first pixel of a span
+ * \param x - the x-coordinate of the pixel
+ * \param y - the y-coordinate of the pixel
+ */
+void perspective_interpolator::begin_span(int x, int y)
+{
+    this->z = this->evaluate(this->z_plane, x, y);
+    this->inverse_w = this->evaluate(this->inverse_w_plane, x, y);
+    for (int i = 0; i < this->attribute_count; i++) {
+        this->attributes_over_w[i] = this->evaluate(this->attribute_planes[i], x, y);
+    }
+}
+
+/*
+ * Moves to the next pixel of the span, i.e. one pixel to the right
+ */
+void perspective_interpolator::next_pixel()
+{
+    this->z += this->z_plane.dx;
+    this->inverse_w += this->inverse_w_plane.dx;
+    for (int i = 0; i < this->attribute_count; i++) {
+        this->attributes_over_w[i] += this->attribute_planes[i].dx;
+    }
+}
+
+/*
+ * Returns the depth at the current pixel
+ */
+float perspective_interpolator::depth() const
+{
+    return this->z;
+}
+
+/*
+ * Returns the depth at a sample near the current pixel
+ * \param offset_x - the x-offset of the sample from the pixel center, in pixels
+ * \param offset_y - the y-offset of the sample from the pixel center, in pixels
+ */
+float perspective_interpolator::depth(float offset_x, float offset_y) const
+{
+    return this->z + this->z_plane.dx * offset_x + this->z_plane.dy * offset_y;
+}
+
+/*
+ * Computes the perspective-correct attributes at the current pixel
+ * \param out - receives attribute_count values
+ */
+void perspective_interpolator::attributes(float *out) const
+{
+    float w = 1.f / this->inverse_w;
+    for (int i = 0; i < this->attribute_count; i++) {
+        out[i] = this->attributes_over_w[i] * w;
+    }
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * Computes the plane through the values q0, q1 and q2 at the three vertices
+ */
+perspective_interpolator::plane perspective_interpolator::make_plane(float q0, float q1, float q2) const
+{
+    float d1 = q1 - q0;
+    float d2 = q2 - q0;
+
+    plane p;
+    p.origin = q0;
+    p.dx = (d1 * this->e2y - d2 * this->e1y) * this->inverse_area;
+    p.dy = (d2 * this->e1x - d1 * this->e2x) * this->inverse_area;
+    return p;
+}
+
+/*
+ * Evaluates a plane at a pixel
+ */
+float perspective_interpolator::evaluate(const plane &p, int x, int y) const
+{
+    return p.origin + p.dx * ((float) x - this->x0) + p.dy * ((float) y - this->y0);
+}
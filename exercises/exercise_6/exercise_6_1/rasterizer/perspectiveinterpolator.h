@@ -0,0 +1,109 @@
+#ifndef __PERSPECTIVE_INTERPOLATOR_H__
+#define __PERSPECTIVE_INTERPOLATOR_H__
+
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+/**
+ * \class perspective_interpolator
+ * A class which interpolates the depth and the per-vertex attributes (color, uv, normal, ...) of a triangle
+ * over its pixels, with perspective correction.
+ *
+ * After the perspective division, depth, 1/w and attribute/w are linear functions of the screen position,
+ * so each one is stored as a plane: its value at a pixel and its increments along x and y. A span is walked
+ * by adding the x increments, and the attributes are recovered with a single division per pixel, so no
+ * barycentric coordinates are recomputed per pixel.
+ */
+class perspective_interpolator {
+public:
+    /**
+     * The largest number of attributes per vertex
+     */
+    static const int MAX_ATTRIBUTES = 16;
+
+    /**
+     * Parameterized constructor creates an instance of a perspective interpolator
+     * \param screen - the screen position (x, y), depth (z) and clip space w of the three vertices
+     * \param attributes - the attributes of the three vertices
+     * \param attribute_count - the number of attributes per vertex
+     */
+    perspective_interpolator(const glm::vec4 screen[3], const float *const attributes[3], int attribute_count);
+
+    /**
+     * Destroys the current instance of the perspective interpolator
+     */
+    virtual ~perspective_interpolator();
+
+    /**
+     * Moves to the first pixel of a span
+     * \param x - the x-coordinate of the pixel
+     * \param y - the y-coordinate of the pixel
+     */
+    void begin_span(int x, int y);
+
+    /**
+     * Moves to the next pixel of the span, i.e. one pixel to the right
+     */
+    void next_pixel();
+
+    /**
+     * Returns the depth at the current pixel
+     */
+    float depth() const;
+
+    /**
+     * Returns the depth at a sample near the current pixel, depth is linear so it is a single multiply-add
+     * \param offset_x - the x-offset of the sample from the pixel center, in pixels
+     * \param offset_y - the y-offset of the sample from the pixel center, in pixels
+     */
+    float depth(float offset_x, float offset_y) const;
+
+    /**
+     * Computes the perspective-correct attributes at the current pixel
+     * \param out - receives attribute_count values
+     */
+    void attributes(float *out) const;
+
+private:
+    /**
+     * A linear function of the screen position: value(x, y) = origin + dx * (x - x0) + dy * (y - y0)
+     */
+    struct plane {
+        float origin;
+        float dx;
+        float dy;
+    };
+
+    /**
+     * Computes the plane through the values q0, q1 and q2 at the three vertices
+     */
+    plane make_plane(float q0, float q1, float q2) const;
+
+    /**
+     * Evaluates a plane at a pixel
+     */
+    float evaluate(const plane &p, int x, int y) const;
+
+    /**
+     * The position of the first vertex and the screen space gradient factors of the triangle
+     */
+    float x0, y0;
+    float e1x, e1y, e2x, e2y;
+    float inverse_area;
+
+    int attribute_count;
+
+    plane z_plane;
+    plane inverse_w_plane;
+    plane attribute_planes[MAX_ATTRIBUTES];
+
+    /**
+     * Values of the planes at the current pixel
+     */
+    float z;
+    float inverse_w;
+    float attributes_over_w[MAX_ATTRIBUTES];
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "polylinerasterizer.h"
+
+
+/*
+ * \class polyline_rasterizer
+ * A class which scan-converts many connected line segments in one call. Thin lines follow LineRasterizer
+ * exactly, wide and anti-aliased lines are visited with a coverage per pixel.
+ */
+
+/*
+ * Parameterized constructor creates an instance of a polyline rasterizer
+ * \param width - the width of the lines in pixels, used by for_each_fragment
+ * \param antialiased - true if for_each_fragment computes the partial coverage of the pixels
+ */
+polyline_rasterizer::polyline_rasterizer(float width, bool antialiased)
+    : x_min(INT_MIN), y_min(INT_MIN), x_max(INT_MAX), y_max(INT_MAX), width(1.f), antialiased(antialiased)
+{
+    this->set_width(width);
+}
+
+/*
+ * Destroys the current instance of the polyline rasterizer
+ */
+polyline_rasterizer::~polyline_rasterizer()
+{}
+
+/*
+ * Restricts the rasterization to a rectangle, e.g. the screen
+ * \param x0 - the smallest x-coordinate inside the rectangle
+ * \param y0 - the smallest y-coordinate inside the rectangle
+ * \param x1 - the largest x-coordinate inside the rectangle
+ * \param y1 - the largest y-coordinate inside the rectangle
+ */
+void polyline_rasterizer::clip(int x0, int y0, int x1, int y1)
+{
+    this->x_min = x0;
+    this->y_min = y0;
+    this->x_max = x1;
+    this->y_max = y1;
+}
+
+/*
+ * Changes the width of the lines drawn by for_each_fragment
+ * \param width - the width in pixels
+ */
+void polyline_rasterizer::set_width(float width)
+{
+    if (!(width > 0.f)) {
+        throw std::runtime_error("polyline_rasterizer::set_width(): The width must be positive");
+    }
+    this->width = width;
+}
+
+/*
+ * Turns the anti-aliasing of for_each_fragment on or off
+ * \param antialiased - true if the partial coverage of the pixels is computed
+ */
+void polyline_rasterizer::set_antialiased(bool antialiased)
+{
+    this->antialiased = antialiased;
+}
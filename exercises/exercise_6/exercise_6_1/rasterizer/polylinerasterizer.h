@@ -0,0 +1,371 @@
+#ifndef __POLYLINE_RASTERIZER_H__
+#define __POLYLINE_RASTERIZER_H__
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include "linekernel.h"
+
+/**
+ * \class polyline_rasterizer
+ * A class which scan-converts many connected line segments in one call, e.g. the outline of a polygon or the
+ * wireframe of a mesh. The rasterizer keeps no state per segment: each segment is set up on the stack and
+ * walked by line_kernel, specialized on the octant of the segment, so there is no object and no indirect
+ * call per segment or per fragment.
+ *
+ * Thin lines are walked with the same decision variable and tie-break as LineRasterizer, so every segment
+ * produces exactly the pixels LineRasterizer produces for it, except that the endpoint shared by two
+ * consecutive segments is emitted only once. Wide and anti-aliased lines are visited with a coverage per
+ * pixel: one pixel wide anti-aliased lines use Xiaolin Wu's algorithm, and wide lines are swept along their
+ * major axis with the line's extent across each column (or row), which gives the coverage of their pixels.
+ * The segments of lines wider than a pixel overlap around their joints, so some pixels there are visited twice.
+ */
+class polyline_rasterizer {
+public:
+    /**
+     * Parameterized constructor creates an instance of a polyline rasterizer
+     * \param width - the width of the lines in pixels, used by for_each_fragment
+     * \param antialiased - true if for_each_fragment computes the partial coverage of the pixels
+     */
+    polyline_rasterizer(float width = 1.f, bool antialiased = false);
+
+    /**
+     * Destroys the current instance of the polyline rasterizer
+     */
+    virtual ~polyline_rasterizer();
+
+    /**
+     * Restricts the rasterization to a rectangle, e.g. the screen
+     * \param x0 - the smallest x-coordinate inside the rectangle
+     * \param y0 - the smallest y-coordinate inside the rectangle
+     * \param x1 - the largest x-coordinate inside the rectangle
+     * \param y1 - the largest y-coordinate inside the rectangle
+     */
+    void clip(int x0, int y0, int x1, int y1);
+
+    /**
+     * Changes the width of the lines drawn by for_each_fragment
+     * \param width - the width in pixels
+     */
+    void set_width(float width);
+
+    /**
+     * Turns the anti-aliasing of for_each_fragment on or off
+     * \param antialiased - true if the partial coverage of the pixels is computed
+     */
+    void set_antialiased(bool antialiased);
+
+    /**
+     * Visits the pixels of a one pixel wide polyline as horizontal spans
+     * \param points - the vertices of the polyline
+     * \param count - the number of vertices
+     * \param closed - true if the last vertex is connected to the first one
+     * \param visit - called as visit(y, x_begin, x_end) for each run of pixels (x_begin, y) ... (x_end - 1, y)
+     */
+    template <typename SpanVisitor>
+    void for_each_span(const glm::ivec2 *points, int count, bool closed, SpanVisitor &visit) const;
+
+    /**
+     * Visits the pixels of a batch of one pixel wide segments as horizontal spans, e.g. the edges of a mesh
+     * \param points - the vertices of the segments
+     * \param indices - two vertex indices per segment, an endpoint shared with the segment before is emitted once
+     * \param index_count - the number of indices
+     * \param visit - called as visit(y, x_begin, x_end) for each run of pixels (x_begin, y) ... (x_end - 1, y)
+     */
+    template <typename SpanVisitor>
+    void for_each_span(const glm::ivec2 *points, const unsigned int *indices, size_t index_count,
+                       SpanVisitor &visit) const;
+
+    /**
+     * Visits the pixels of a polyline with the width and anti-aliasing of the rasterizer
+     * \param points - the vertices of the polyline, pixel centers are at integer coordinates
+     * \param count - the number of vertices
+     * \param closed - true if the last vertex is connected to the first one
+     * \param visit - called as visit(x, y, coverage) for each pixel, coverage is in (0, 1], and 1 if the
+     *                rasterizer is not anti-aliased
+     */
+    template <typename CoverageVisitor>
+    void for_each_fragment(const glm::vec2 *points, int count, bool closed, CoverageVisitor &visit) const;
+
+private:
+    /**
+     * Merges the pixels of consecutive fragments into horizontal spans, and drops the ones outside the
+     * clipping rectangle
+     */
+    template <typename SpanVisitor>
+    struct span_builder {
+        span_builder(const polyline_rasterizer &rasterizer, SpanVisitor &visit);
+        void add(int x, int y);
+        void flush();
+
+        const polyline_rasterizer &rasterizer;
+        SpanVisitor &visit;
+        int y;
+        int x_first;
+        int x_last;
+        bool open;
+    };
+
+    /**
+     * Walks a segment with the decision variable of LineRasterizer
+     * \param skip_first - true if the first pixel was already emitted by the segment before
+     * \param skip_last - true if the last pixel is emitted by another segment
+     */
+    template <typename SpanVisitor>
+    void thin_segment(glm::ivec2 a, glm::ivec2 b, bool skip_first, bool skip_last,
+                      span_builder<SpanVisitor> &spans) const;
+
+    /**
+     * Draws a one pixel wide anti-aliased segment with Xiaolin Wu's algorithm
+     * \param skip_first - true if the column (or row) of the first endpoint was covered by the segment before
+     * \param shared_last - true if the last endpoint is shared with the next segment, which skips it
+     */
+    template <typename CoverageVisitor>
+    void wu_segment(glm::vec2 a, glm::vec2 b, bool skip_first, bool shared_last, CoverageVisitor &visit) const;
+
+    /**
+     * Draws a wide segment, by sweeping its extent across each column (or row) along the major axis
+     * \param skip_first - true if the column (or row) of the first endpoint was covered by the segment before
+     */
+    template <typename CoverageVisitor>
+    void wide_segment(glm::vec2 a, glm::vec2 b, bool skip_first, CoverageVisitor &visit) const;
+
+    /**
+     * Visits a pixel given in major/minor coordinates, if it is inside the clipping rectangle
+     */
+    template <typename CoverageVisitor>
+    void plot(bool steep, int major, int minor, float coverage, CoverageVisitor &visit) const;
+
+    /**
+     * The clipping rectangle
+     */
+    int x_min; int y_min;
+    int x_max; int y_max;
+
+    float width;
+    bool antialiased;
+};
+
+
+template <typename SpanVisitor>
+void polyline_rasterizer::for_each_span(const glm::ivec2 *points, int count, bool closed, SpanVisitor &visit) const
+{
+    if (count < 2) {
+        return;
+    }
+
+    span_builder<SpanVisitor> spans(*this, visit);
+    int segment_count = closed ? count : count - 1;
+    bool emitted = false; // true once a segment was drawn, so its last vertex is drawn too
+    glm::ivec2 first;
+    for (int i = 0; i < segment_count; i++) {
+        const glm::ivec2 &a = points[i];
+        const glm::ivec2 &b = points[(i + 1) % count];
+        if (a == b) {
+            continue; // LineRasterizer draws nothing for an empty segment
+        }
+        if (!emitted) {
+            first = a;
+        }
+        // a closed polyline ends on the vertex the first segment started from
+        this->thin_segment(a, b, emitted, closed && i == segment_count - 1 && emitted && b == first, spans);
+        emitted = true;
+    }
+    spans.flush();
+}
+
+template <typename SpanVisitor>
+void polyline_rasterizer::for_each_span(const glm::ivec2 *points, const unsigned int *indices, size_t index_count,
+                                        SpanVisitor &visit) const
+{
+    span_builder<SpanVisitor> spans(*this, visit);
+    bool emitted = false;
+    glm::ivec2 last;
+    for (size_t i = 0; i + 1 < index_count; i += 2) {
+        const glm::ivec2 &a = points[indices[i]];
+        const glm::ivec2 &b = points[indices[i + 1]];
+        if (a == b) {
+            continue;
+        }
+        this->thin_segment(a, b, emitted && a == last, false, spans);
+        emitted = true;
+        last = b;
+    }
+    spans.flush();
+}
+
+template <typename CoverageVisitor>
+void polyline_rasterizer::for_each_fragment(const glm::vec2 *points, int count, bool closed,
+                                            CoverageVisitor &visit) const
+{
+    if (count < 2) {
+        return;
+    }
+
+    int segment_count = closed ? count : count - 1;
+    bool emitted = false;
+    for (int i = 0; i < segment_count; i++) {
+        const glm::vec2 &a = points[i];
+        const glm::vec2 &b = points[(i + 1) % count];
+        if (a == b) {
+            continue;
+        }
+        if (this->antialiased && this->width <= 1.f) {
+            // the last endpoint is shared if another segment follows, the first vertex of a closed polyline is
+            // not: the first segment did not skip it
+            bool shared_last = i + 1 < segment_count;
+            this->wu_segment(a, b, emitted, shared_last, visit);
+        } else {
+            // the segment before covers only the shared endpoint of a thin line, but not the first column (or
+            // row) of a wide one when the line turns, so the column is skipped only for thin lines
+            this->wide_segment(a, b, emitted && this->width <= 1.f, visit);
+        }
+        emitted = true;
+    }
+}
+
+template <typename SpanVisitor>
+polyline_rasterizer::span_builder<SpanVisitor>::span_builder(const polyline_rasterizer &rasterizer,
+                                                             SpanVisitor &visit)
+    : rasterizer(rasterizer), visit(visit), y(0), x_first(0), x_last(0), open(false)
+{}
+
+template <typename SpanVisitor>
+inline void polyline_rasterizer::span_builder<SpanVisitor>::add(int x, int y)
+{
+    if (x < this->rasterizer.x_min || x > this->rasterizer.x_max ||
+        y < this->rasterizer.y_min || y > this->rasterizer.y_max) {
+        return;
+    }
+    if (this->open && y == this->y && x == this->x_last + 1) {
+        this->x_last++;
+    } else if (this->open && y == this->y && x == this->x_first - 1) {
+        this->x_first--; // segments drawn from right to left
+    } else {
+        this->flush();
+        this->y = y;
+        this->x_first = this->x_last = x;
+        this->open = true;
+    }
+}
+
+template <typename SpanVisitor>
+void polyline_rasterizer::span_builder<SpanVisitor>::flush()
+{
+    if (this->open) {
+        this->visit(this->y, this->x_first, this->x_last + 1);
+        this->open = false;
+    }
+}
+
+template <typename SpanVisitor>
+void polyline_rasterizer::thin_segment(glm::ivec2 a, glm::ivec2 b, bool skip_first, bool skip_last,
+                                       span_builder<SpanVisitor> &spans) const
+{
+    auto add = [&spans](int x, int y) {
+        spans.add(x, y);
+    };
+    line_kernel::rasterize(a.x, a.y, b.x, b.y, skip_first, skip_last, add);
+}
+
+template <typename CoverageVisitor>
+void polyline_rasterizer::wu_segment(glm::vec2 a, glm::vec2 b, bool skip_first, bool shared_last,
+                                     CoverageVisitor &visit) const
+{
+    bool steep = std::abs(b.y - a.y) > std::abs(b.x - a.x);
+    if (steep) {
+        std::swap(a.x, a.y);
+        std::swap(b.x, b.y);
+    }
+    // the loop runs from the smaller to the larger major coordinate
+    bool skip_low = skip_first, shared_high = shared_last;
+    bool skip_high = false, shared_low = false;
+    if (a.x > b.x) {
+        std::swap(a, b);
+        std::swap(skip_low, skip_high);
+        std::swap(shared_low, shared_high);
+    }
+    float gradient = (b.y - a.y) / (b.x - a.x);
+
+    // the endpoint columns are weighted by the part of the pixel the segment covers along the major axis, a
+    // shared endpoint is covered as a whole by one of the segments and skipped by the other
+    int low = (int) std::floor(a.x + .5f);
+    int high = (int) std::floor(b.x + .5f);
+    float low_gap = shared_low ? 1.f : 1.f - (a.x + .5f - std::floor(a.x + .5f));
+    float high_gap = shared_high ? 1.f : b.x + .5f - std::floor(b.x + .5f);
+    if (low == high) {
+        low_gap = high_gap = b.x - a.x;
+    }
+
+    for (int major = low; major <= high; major++) {
+        if ((major == low && skip_low) || (major == high && skip_high)) {
+            continue;
+        }
+        float gap = major == low ? low_gap : (major == high ? high_gap : 1.f);
+        float center = a.y + gradient * (major - a.x);
+        int minor = (int) std::floor(center);
+        float fraction = center - minor;
+        this->plot(steep, major, minor, (1.f - fraction) * gap, visit);
+        this->plot(steep, major, minor + 1, fraction * gap, visit);
+    }
+}
+
+template <typename CoverageVisitor>
+void polyline_rasterizer::wide_segment(glm::vec2 a, glm::vec2 b, bool skip_first, CoverageVisitor &visit) const
+{
+    bool steep = std::abs(b.y - a.y) > std::abs(b.x - a.x);
+    if (steep) {
+        std::swap(a.x, a.y);
+        std::swap(b.x, b.y);
+    }
+    bool skip_low = skip_first, skip_high = false;
+    if (a.x > b.x) {
+        std::swap(a, b);
+        std::swap(skip_low, skip_high);
+    }
+    float gradient = (b.y - a.y) / (b.x - a.x);
+
+    // the extent of the line across a column is its width divided by the cosine of its slope
+    float half = .5f * this->width * std::sqrt(1.f + gradient * gradient);
+    int low = (int) std::floor(a.x + .5f);
+    int high = (int) std::floor(b.x + .5f);
+    for (int major = low; major <= high; major++) {
+        if ((major == low && skip_low) || (major == high && skip_high)) {
+            continue;
+        }
+        float center = a.y + gradient * (major - a.x);
+        float bottom = center - half;
+        float top = center + half;
+        if (!this->antialiased) {
+            // the pixels whose center is inside the extent, bottom inclusive
+            for (int minor = (int) std::ceil(bottom), end = (int) std::ceil(top); minor < end; minor++) {
+                this->plot(steep, major, minor, 1.f, visit);
+            }
+            continue;
+        }
+        // the coverage of a pixel is the part of its column inside the extent
+        for (int minor = (int) std::floor(bottom + .5f), end = (int) std::floor(top + .5f); minor <= end; minor++) {
+            float coverage = std::min(top, minor + .5f) - std::max(bottom, minor - .5f);
+            this->plot(steep, major, minor, std::min(coverage, 1.f), visit);
+        }
+    }
+}
+
+template <typename CoverageVisitor>
+inline void polyline_rasterizer::plot(bool steep, int major, int minor, float coverage,
+                                      CoverageVisitor &visit) const
+{
+    int x = steep ? minor : major;
+    int y = steep ? major : minor;
+    if (coverage <= 0.f || x < this->x_min || x > this->x_max || y < this->y_min || y > this->y_max) {
+        return;
+    }
+    visit(x, y, coverage);
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include "posttransformcache.h"
+
+#include <algorithm>
+
+
+/*
+ * \class post_transform_cache
+ * The vertex stage of the software pipeline for indexed meshes, which transforms each vertex once, when a
+ * triangle first refers to it.
+ */
+
+/*
+ * Parameterized constructor creates an instance of a post-transform vertex cache
+ * \param clipper - maps the clip space positions to the viewport
+ */
+post_transform_cache::post_transform_cache(const guard_band_clipper &clipper)
+    : clipper(clipper), positions(nullptr), count(0), transform(1.f), generation(0), misses(0)
+{}
+
+/*
+ * Destroys the current instance of the post-transform vertex cache
+ */
+post_transform_cache::~post_transform_cache()
+{}
+
+/*
+ * Starts a mesh, the entries of the previous one are dropped
+ * \param positions - three floats per vertex, in object space, they must outlive the mesh
+ * \param transform - the object to clip space transformation
+ */
+void post_transform_cache::begin(const std::vector<float> &positions, const glm::mat4 &transform)
+{
+    this->positions = positions.data();
+    this->count = positions.size() / 3;
+    this->transform = transform;
+    this->misses = 0;
+
+    // the stamps of new entries are 0, which is never the one of a mesh
+    if (this->entries.size() < this->count) {
+        this->entries.resize(this->count);
+        this->clip_stamp.resize(this->count, 0);
+        this->viewport_stamp.resize(this->count, 0);
+    }
+    if (++this->generation == 0) {
+        std::fill(this->clip_stamp.begin(), this->clip_stamp.end(), 0);
+        std::fill(this->viewport_stamp.begin(), this->viewport_stamp.end(), 0);
+        this->generation = 1;
+    }
+}
+
+/*
+ * Returns the number of vertices of the current mesh
+ */
+size_t post_transform_cache::vertex_count() const
+{
+    return this->count;
+}
+
+/*
+ * Returns the number of vertices of the current mesh which were transformed, i.e. the cache misses
+ */
+size_t post_transform_cache::transformed() const
+{
+    return this->misses;
+}
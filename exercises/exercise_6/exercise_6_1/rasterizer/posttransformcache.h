@@ -0,0 +1,113 @@
+#ifndef __POST_TRANSFORM_CACHE_H__
+#define __POST_TRANSFORM_CACHE_H__
+
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "guardbandclipper.h"
+
+/**
+ * \class post_transform_cache
+ * The vertex stage of the software pipeline for indexed meshes. The vertices are transformed when a triangle
+ * first refers to them, and the results are kept for the other triangles that share them: the clip space
+ * position, and for vertices of triangles that need no clipping, the position in the viewport snapped to the
+ * subpixel grid.
+ *
+ * Unlike the small FIFO of a GPU, the cache has an entry for each vertex of the mesh, so a vertex is never
+ * transformed twice, whatever the order of the indices, and the vertices no triangle refers to are never
+ * transformed. The entries are stamped with the number of the mesh, so starting a mesh does not clear them.
+ */
+class post_transform_cache {
+public:
+    /**
+     * Parameterized constructor creates an instance of a post-transform vertex cache
+     * \param clipper - maps the clip space positions to the viewport
+     */
+    post_transform_cache(const guard_band_clipper &clipper);
+
+    /**
+     * Destroys the current instance of the post-transform vertex cache
+     */
+    virtual ~post_transform_cache();
+
+    /**
+     * Starts a mesh, the entries of the previous one are dropped
+     * \param positions - three floats per vertex, in object space, they must outlive the mesh
+     * \param transform - the object to clip space transformation
+     */
+    void begin(const std::vector<float> &positions, const glm::mat4 &transform);
+
+    /**
+     * Returns the number of vertices of the current mesh
+     */
+    size_t vertex_count() const;
+
+    /**
+     * Returns the clip space position of a vertex, transforming it if it is not cached yet
+     * \param index - the index of the vertex, less than vertex_count()
+     */
+    const glm::vec4 &clip_position(unsigned int index);
+
+    /**
+     * Returns a vertex mapped to the viewport, mapping it if it is not cached yet. The vertex must be one of a
+     * triangle which guard_band_clipper::classify() accepts without clipping
+     * \param index - the index of the vertex, less than vertex_count()
+     */
+    const guard_band_clipper::vertex &viewport_vertex(unsigned int index);
+
+    /**
+     * Returns the number of vertices of the current mesh which were transformed, i.e. the cache misses
+     */
+    size_t transformed() const;
+
+private:
+    /**
+     * A cached vertex, each part is valid if its stamp is the one of the current mesh
+     */
+    struct entry {
+        glm::vec4 clip;
+        guard_band_clipper::vertex viewport;
+    };
+
+    const guard_band_clipper &clipper;
+    const float *positions;
+    size_t count;
+    glm::mat4 transform;
+
+    std::vector<entry> entries;
+    std::vector<unsigned int> clip_stamp;
+    std::vector<unsigned int> viewport_stamp;
+
+    /**
+     * The stamp of the current mesh, never 0 so that new entries are never valid
+     */
+    unsigned int generation;
+    size_t misses;
+};
+
+
+inline const glm::vec4 &post_transform_cache::clip_position(unsigned int index)
+{
+    entry &cached = this->entries[index];
+    if (this->clip_stamp[index] != this->generation) {
+        const float *p = this->positions + (size_t) index * 3;
+        cached.clip = this->transform * glm::vec4(p[0], p[1], p[2], 1.f);
+        this->clip_stamp[index] = this->generation;
+        this->misses++;
+    }
+    return cached.clip;
+}
+
+inline const guard_band_clipper::vertex &post_transform_cache::viewport_vertex(unsigned int index)
+{
+    entry &cached = this->entries[index];
+    if (this->viewport_stamp[index] != this->generation) {
+        cached.viewport = this->clipper.map_vertex(this->clip_position(index));
+        this->viewport_stamp[index] = this->generation;
+    }
+    return cached.viewport;
+}
+
+#endif
@@ -0,0 +1,324 @@
+#include "softwarepipeline.h"
+
+#include <cfloat>
+#include <cmath>
+
+
+/*
+ * \class software_pipeline
+ * A minimal CPU version of the OpenGL pipeline, which draws indexed triangle meshes into a CustomFrameBuffer
+ * with an early depth test and perspective-correct attribute interpolation.
+ */
+
+/*
+ * Parameterized constructor creates an instance of a software pipeline
+ * \param target - the frame buffer to draw into, its depth buffer is used for the depth test
+ */
+software_pipeline::software_pipeline(CustomFrameBuffer &target)
+    : target(target), clipper((int) target.W, (int) target.H), vertices(clipper),
+      hi_z((int) target.W, (int) target.H), multisample(nullptr),
+      depth_test(true), blending(false), face_culling(no_culling)
+{
+    this->reset_statistics();
+    // the depth buffer is not known to be cleared
+    this->hi_z.invalidate();
+    this->setups.clip(0, 0, (int) target.W - 1, (int) target.H - 1);
+}
+
+/*
+ * Destroys the current instance of the software pipeline
+ */
+software_pipeline::~software_pipeline()
+{}
+
+/*
+ * Draws an indexed triangle mesh with interpolated vertex colors
+ * \param positions - three floats per vertex, in object space
+ * \param colors - four floats (rgba) per vertex
+ * \param indices - three vertex indices per triangle
+ * \param transform - the object to clip space transformation
+ */
+void software_pipeline::draw(const std::vector<float> &positions, const std::vector<float> &colors,
+                             const std::vector<unsigned int> &indices, const glm::mat4 &transform)
+{
+    auto shade = [](const float *color) {
+        return Colors::fromFloats(color[0], color[1], color[2], color[3]);
+    };
+    this->draw(positions, colors, 4, indices, transform, shade);
+}
+
+/*
+ * Draws into a multisample buffer instead of the frame buffer, until it is set back to nullptr
+ * \param samples - the multisample buffer, of the size of the frame buffer, or nullptr
+ */
+void software_pipeline::set_multisample_target(MultisampleBuffer *samples)
+{
+    if (samples != nullptr && (samples->W != this->target.W || samples->H != this->target.H)) {
+        throw std::runtime_error("software_pipeline::set_multisample_target(): The buffer size does not match");
+    }
+    this->multisample = samples;
+    this->hi_z.invalidate();
+}
+
+/*
+ * Clears the depth buffer of the frame buffer, and the hierarchical depth with it
+ * \param value - the depth of the cleared buffer
+ */
+void software_pipeline::clear_depth(float value)
+{
+    this->target.clearDepth(value);
+    if (this->multisample == nullptr) {
+        this->hi_z.clear(value);
+    }
+}
+
+/*
+ * Tells the pipeline that the depth buffer changed outside of it, e.g. with CustomFrameBuffer::clearDepth()
+ * or MultisampleBuffer::clear(), so the hierarchical depth is recomputed before the next occlusion test
+ */
+void software_pipeline::invalidate_depth()
+{
+    this->hi_z.invalidate();
+}
+
+/*
+ * Checks if an object is hidden by the depths already drawn, conservatively: an object found hidden would
+ * draw no fragment, but an object that is not found hidden may still draw none
+ * \param x0 - the smallest x-coordinate of the screen rectangle of the object, in pixels
+ * \param y0 - the smallest y-coordinate of the screen rectangle of the object, in pixels
+ * \param x1 - the largest x-coordinate of the screen rectangle of the object, in pixels
+ * \param y1 - the largest y-coordinate of the screen rectangle of the object, in pixels
+ * \param depth - the nearest depth of the object, in [0, 1]
+ * \return true if the object is hidden or off the screen
+ */
+bool software_pipeline::occluded(int x0, int y0, int x1, int y1, float depth)
+{
+    this->counters.occlusion_tests++;
+    bool hidden;
+    if (this->multisample != nullptr) {
+        auto farthest = [this](int x, int y) { return this->multisample->farthestDepth(x, y); };
+        hidden = this->hi_z.occluded(x0, y0, x1, y1, depth, farthest);
+    } else {
+        auto farthest = [this](int x, int y) { return this->target.depth[x + y * this->target.W]; };
+        hidden = this->hi_z.occluded(x0, y0, x1, y1, depth, farthest);
+    }
+    if (hidden) {
+        this->counters.occluded_objects++;
+    }
+    return hidden;
+}
+
+/*
+ * Checks if an object is hidden by the depths already drawn, from its bounding box in object space. A box
+ * that crosses the near plane is never hidden
+ * \param box_min - the smallest corner of the bounding box, e.g. of the positions of a mesh
+ * \param box_max - the largest corner of the bounding box
+ * \param transform - the object to clip space transformation
+ * \return true if the object is hidden or off the screen
+ */
+bool software_pipeline::occluded(const glm::vec3 &box_min, const glm::vec3 &box_max, const glm::mat4 &transform)
+{
+    // the screen rectangle and nearest depth of the eight corners, mapped like guard_band_clipper does
+    glm::vec2 low(FLT_MAX), high(-FLT_MAX);
+    float nearest = FLT_MAX;
+    for (int c = 0; c < 8; c++) {
+        glm::vec4 corner(c & 1 ? box_max.x : box_min.x, c & 2 ? box_max.y : box_min.y,
+                         c & 4 ? box_max.z : box_min.z, 1.f);
+        glm::vec4 clip = transform * corner;
+        if (clip.w <= 0.f || clip.z < -clip.w) {
+            this->counters.occlusion_tests++;
+            return false;
+        }
+        glm::vec2 screen((clip.x / clip.w * .5f + .5f) * this->target.W - .5f,
+                         (clip.y / clip.w * .5f + .5f) * this->target.H - .5f);
+        low = glm::min(low, screen);
+        high = glm::max(high, screen);
+        nearest = std::min(nearest, clip.z / clip.w * .5f + .5f);
+    }
+
+    // the pixel centers inside the rectangle, one more pixel around it covers the samples and the rounding
+    const float limit = (float) halfspace_rasterizer::MAX_COORDINATE;
+    low = glm::clamp(low, -limit, limit);
+    high = glm::clamp(high, -limit, limit);
+    return this->occluded((int) std::floor(low.x) - 1, (int) std::floor(low.y) - 1, (int) std::ceil(high.x) + 1,
+                          (int) std::ceil(high.y) + 1, nearest);
+}
+
+/*
+ * Turns the depth test (less) on or off, it is on by default
+ * \param enabled - true if the fragments are depth tested and write their depth
+ */
+void software_pipeline::set_depth_test(bool enabled)
+{
+    this->depth_test = enabled;
+}
+
+/*
+ * Turns blending on or off, it is off by default. The multisample target is never blended
+ * \param enabled - true if the fragments are blended over the frame buffer by their alpha
+ */
+void software_pipeline::set_blending(bool enabled)
+{
+    this->blending = enabled;
+}
+
+/*
+ * Changes the faces which are culled, no face is culled by default
+ * \param mode - the culled faces
+ */
+void software_pipeline::set_culling(culling mode)
+{
+    this->face_culling = mode;
+}
+
+/*
+ * Returns the number of triangles through each stage since the last reset_statistics()
+ */
+const software_pipeline::statistics &software_pipeline::get_statistics() const
+{
+    return this->counters;
+}
+
+/*
+ * Sets the statistics back to zero
+ */
+void software_pipeline::reset_statistics()
+{
+    this->counters = statistics();
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * The culling stage, between the clipper and the setup of a triangle, it counts the culled triangles
+ * \param samples - the sample pattern of the multisample target, nullptr for the pixel centers
+ * \param sample_count - the number of samples
+ * \return true if the triangle can produce no fragments
+ */
+bool software_pipeline::cull(const long long fixed_x[3], const long long fixed_y[3], const glm::ivec2 *samples,
+                             int sample_count)
+{
+    // twice the signed area, exact in fixed point, it is positive for counter-clockwise triangles
+    long long area = (fixed_x[1] - fixed_x[0]) * (fixed_y[2] - fixed_y[0]) -
+                     (fixed_y[1] - fixed_y[0]) * (fixed_x[2] - fixed_x[0]);
+    if (area == 0) {
+        this->counters.culled_degenerate++;
+        return true;
+    }
+    if ((this->face_culling == back_faces && area < 0) || (this->face_culling == front_faces && area > 0)) {
+        this->counters.culled_facing++;
+        return true;
+    }
+    if (!halfspace_rasterizer::bounds_contain_sample(fixed_x, fixed_y, samples, sample_count, 0, 0,
+                                                     (int) this->target.W - 1, (int) this->target.H - 1)) {
+        this->counters.culled_no_samples++;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Transforms, clips and sets up the triangles of a mesh, into setups
+ */
+void software_pipeline::setup_triangles(const std::vector<float> &positions, const std::vector<float> &attributes,
+                                        int attribute_count, const std::vector<unsigned int> &indices,
+                                        const glm::mat4 &transform)
+{
+    size_t vertex_count = positions.size() / 3;
+    if (attribute_count < 0 || attribute_count > perspective_interpolator::MAX_ATTRIBUTES ||
+        attributes.size() < vertex_count * attribute_count) {
+        throw std::runtime_error("software_pipeline::setup_triangles(): Invalid vertex attributes");
+    }
+
+    this->vertices.begin(positions, transform);
+    this->setups.clear();
+    this->clipped_screen.clear();
+    this->clipped_attributes.clear();
+
+    // with a multisample target, a triangle between the pixel centers may still cover samples
+    const int sample_count = this->multisample != nullptr ? (int) this->multisample->samples : 1;
+    const glm::ivec2 *samples = this->multisample != nullptr ? halfspace_rasterizer::sample_pattern(sample_count)
+                                                             : nullptr;
+    guard_band_clipper::vertex polygon[guard_band_clipper::MAX_VERTICES];
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        this->counters.submitted++;
+        unsigned int corners[3];
+        glm::vec4 triangle[3];
+        for (int v = 0; v < 3; v++) {
+            corners[v] = indices[i + v];
+            if (corners[v] >= vertex_count) {
+                throw std::runtime_error("software_pipeline::setup_triangles(): Vertex index out of range");
+            }
+            triangle[v] = this->vertices.clip_position(corners[v]);
+        }
+
+        int crossed = this->clipper.classify(triangle);
+        if (crossed < 0) {
+            this->counters.culled_outside++;
+            continue;
+        }
+        long long fixed_x[3], fixed_y[3];
+        if (crossed == 0) {
+            // the usual case, the corners are the vertices of the mesh, snapped once for all their triangles
+            for (int v = 0; v < 3; v++) {
+                const guard_band_clipper::vertex &corner = this->vertices.viewport_vertex(corners[v]);
+                fixed_x[v] = corner.x;
+                fixed_y[v] = corner.y;
+            }
+            this->add_triangle(fixed_x, fixed_y, corners, samples, sample_count);
+            continue;
+        }
+
+        this->counters.clipped++;
+        int count = this->clipper.clip_triangle(triangle, polygon);
+        if (count == 0) {
+            this->counters.culled_outside++;
+            continue;
+        }
+
+        // the vertices created by clipping get their attributes blended from the ones of the triangle
+        unsigned int first = (unsigned int) (vertex_count + this->clipped_screen.size());
+        for (int v = 0; v < count; v++) {
+            const glm::vec3 &weights = polygon[v].weights;
+            this->clipped_screen.push_back(polygon[v].screen);
+            for (int a = 0; a < attribute_count; a++) {
+                this->clipped_attributes.push_back(weights.x * attributes[corners[0] * attribute_count + a] +
+                                                   weights.y * attributes[corners[1] * attribute_count + a] +
+                                                   weights.z * attributes[corners[2] * attribute_count + a]);
+            }
+        }
+        for (int v = 1; v + 1 < count; v++) {
+            const int fan[3] = {0, v, v + 1};
+            unsigned int fan_corners[3];
+            for (int k = 0; k < 3; k++) {
+                fixed_x[k] = polygon[fan[k]].x;
+                fixed_y[k] = polygon[fan[k]].y;
+                fan_corners[k] = first + fan[k];
+            }
+            this->add_triangle(fixed_x, fixed_y, fan_corners, samples, sample_count);
+        }
+    }
+    this->counters.transformed_vertices += this->vertices.transformed();
+}
+
+/*
+ * Culls a triangle or sets it up for the raster stage
+ * \param corners - the indices of its vertices, see clipped_screen
+ * \param samples - the sample pattern of the multisample target, nullptr for the pixel centers
+ * \param sample_count - the number of samples
+ */
+void software_pipeline::add_triangle(const long long fixed_x[3], const long long fixed_y[3],
+                                     const unsigned int corners[3], const glm::ivec2 *samples, int sample_count)
+{
+    if (this->cull(fixed_x, fixed_y, samples, sample_count)) {
+        return;
+    }
+    if (this->setups.add(fixed_x, fixed_y, corners, samples != nullptr)) {
+        this->counters.rasterized++;
+    } else {
+        this->counters.culled_no_samples++;
+    }
+}
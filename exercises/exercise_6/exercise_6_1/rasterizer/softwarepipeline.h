@@ -0,0 +1,552 @@
+#ifndef __SOFTWARE_PIPELINE_H__
+#define __SOFTWARE_PIPELINE_H__
+
+#include <climits>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "CustomFrameBuffer.h"
+#include "MultisampleBuffer.h"
+#include "guardbandclipper.h"
+#include "halfspacerasterizer.h"
+#include "hierarchicaldepth.h"
+#include "perspectiveinterpolator.h"
+#include "posttransformcache.h"
+#include "trianglesetup.h"
+
+/**
+ * \class software_pipeline
+ * A minimal CPU version of the OpenGL pipeline, which draws indexed triangle meshes into a CustomFrameBuffer.
+ * The meshes use the same layout as the vertex arrays of the GL exercises: three floats per position, any
+ * number of floats per vertex for the attributes, and three indices per triangle.
+ *
+ * A mesh is drawn in two passes. The first one sets up all its triangles: the vertices go through a
+ * post_transform_cache, so a vertex shared by several triangles is transformed and snapped to the subpixel grid
+ * only once, the triangles go through guard_band_clipper, which clips them only when they cross the near or
+ * far plane or leave the guard band, and their edge functions and bounding boxes are stored in a
+ * triangle_setup. Between the two, a culling stage drops the triangles that would produce no fragments: the
+ * ones with no area once snapped to the subpixel grid, the ones facing away (when face culling is on), and the
+ * ones whose bounding box contains no sample, which are most of the triangles of a dense mesh far from the
+ * camera. The second pass scan-converts the others with halfspace_rasterizer. Each fragment goes through
+ * an early depth test (less) before it is shaded with its perspective-correct attributes, so hidden fragments
+ * are never shaded.
+ *
+ * draw_quads() shades the pixels in 2x2 quads, like a GPU, so the shader also gets the screen space
+ * derivatives of the attributes, e.g. to pick the level of detail of a software_texture.
+ *
+ * The depth test and blending can be turned off and on. The span loop is specialized at compile time on
+ * both, and the specialization is picked once per triangle, so the loop has no branch on the state per pixel.
+ *
+ * The raster stage keeps a hierarchical_depth up to date with the depth buffer, so whole objects can be tested
+ * with occluded() before their triangles are drawn. Drawing the near objects first, the ones hidden behind
+ * them cost a projected bounding box instead of all their triangles.
+ *
+ * With a multisample target, the rasterizer computes a coverage mask per pixel, each covered sample is depth
+ * tested at its own position, and the fragment is shaded once, at the pixel center, for all the samples that
+ * pass. The samples are averaged into the frame buffer by MultisampleBuffer::resolve().
+ */
+class software_pipeline {
+public:
+    /**
+     * The faces which are culled, by their winding in the viewport: front faces are counter-clockwise, as with
+     * the default glFrontFace(GL_CCW)
+     */
+    enum culling {no_culling, back_faces, front_faces};
+
+    /**
+     * The number of triangles through each stage, since the last reset_statistics(). A clipped triangle may be
+     * split in several parts, which are culled or rasterized one by one
+     */
+    struct statistics {
+        /**
+         * Triangles of the meshes
+         */
+        size_t submitted;
+
+        /**
+         * Triangles which crossed the near or far plane or left the guard band, and were clipped
+         */
+        size_t clipped;
+
+        /**
+         * Triangles completely outside the view volume, or clipped away
+         */
+        size_t culled_outside;
+
+        /**
+         * Triangles or parts with no area, once snapped to the subpixel grid
+         */
+        size_t culled_degenerate;
+
+        /**
+         * Triangles or parts culled by their winding
+         */
+        size_t culled_facing;
+
+        /**
+         * Triangles or parts whose bounding box contains no pixel center (or sample) on the screen
+         */
+        size_t culled_no_samples;
+
+        /**
+         * Triangles or parts sent to the raster stage
+         */
+        size_t rasterized;
+
+        /**
+         * Vertices transformed by the post-transform cache
+         */
+        size_t transformed_vertices;
+
+        /**
+         * Objects tested with occluded(), and the ones found hidden
+         */
+        size_t occlusion_tests;
+        size_t occluded_objects;
+    };
+
+    /**
+     * Parameterized constructor creates an instance of a software pipeline
+     * \param target - the frame buffer to draw into, its depth buffer is used for the depth test
+     */
+    software_pipeline(CustomFrameBuffer &target);
+
+    /**
+     * Destroys the current instance of the software pipeline
+     */
+    virtual ~software_pipeline();
+
+    /**
+     * Draws an indexed triangle mesh
+     * \param positions - three floats per vertex, in object space
+     * \param attributes - attribute_count floats per vertex, interpolated over the triangles
+     * \param attribute_count - the number of attributes per vertex, at most perspective_interpolator::MAX_ATTRIBUTES
+     * \param indices - three vertex indices per triangle
+     * \param transform - the object to clip space transformation
+     * \param shade - called as shade(attributes) for every visible fragment, it returns its Colors::color
+     */
+    template <typename FragmentShader>
+    void draw(const std::vector<float> &positions, const std::vector<float> &attributes, int attribute_count,
+              const std::vector<unsigned int> &indices, const glm::mat4 &transform, FragmentShader &shade);
+
+    /**
+     * Draws an indexed triangle mesh, shading its pixels in 2x2 quads. The derivatives of the attributes are
+     * their differences between the pixels of the quad, the same for the four pixels (coarse derivatives)
+     * \param positions - three floats per vertex, in object space
+     * \param attributes - attribute_count floats per vertex, interpolated over the triangles
+     * \param attribute_count - the number of attributes per vertex, at most perspective_interpolator::MAX_ATTRIBUTES
+     * \param indices - three vertex indices per triangle
+     * \param transform - the object to clip space transformation
+     * \param shade - called as shade(attributes, ddx, ddy) for every visible fragment, with the derivatives of the
+     *                attributes along x and y, it returns its Colors::color
+     */
+    template <typename QuadShader>
+    void draw_quads(const std::vector<float> &positions, const std::vector<float> &attributes, int attribute_count,
+                    const std::vector<unsigned int> &indices, const glm::mat4 &transform, QuadShader &shade);
+
+    /**
+     * Draws an indexed triangle mesh with interpolated vertex colors
+     * \param positions - three floats per vertex, in object space
+     * \param colors - four floats (rgba) per vertex
+     * \param indices - three vertex indices per triangle
+     * \param transform - the object to clip space transformation
+     */
+    void draw(const std::vector<float> &positions, const std::vector<float> &colors,
+              const std::vector<unsigned int> &indices, const glm::mat4 &transform);
+
+    /**
+     * Draws into a multisample buffer instead of the frame buffer, until it is set back to nullptr. draw_quads()
+     * does not support multisample buffers
+     * \param samples - the multisample buffer, of the size of the frame buffer, or nullptr
+     */
+    void set_multisample_target(MultisampleBuffer *samples);
+
+    /**
+     * Clears the depth buffer of the frame buffer, and the hierarchical depth with it
+     * \param value - the depth of the cleared buffer
+     */
+    void clear_depth(float value = 1.f);
+
+    /**
+     * Tells the pipeline that the depth buffer changed outside of it, e.g. with CustomFrameBuffer::clearDepth()
+     * or MultisampleBuffer::clear(), so the hierarchical depth is recomputed before the next occlusion test
+     */
+    void invalidate_depth();
+
+    /**
+     * Checks if an object is hidden by the depths already drawn, conservatively: an object found hidden would
+     * draw no fragment, but an object that is not found hidden may still draw none
+     * \param x0 - the smallest x-coordinate of the screen rectangle of the object, in pixels
+     * \param y0 - the smallest y-coordinate of the screen rectangle of the object, in pixels
+     * \param x1 - the largest x-coordinate of the screen rectangle of the object, in pixels
+     * \param y1 - the largest y-coordinate of the screen rectangle of the object, in pixels
+     * \param depth - the nearest depth of the object, in [0, 1]
+     * \return true if the object is hidden or off the screen
+     */
+    bool occluded(int x0, int y0, int x1, int y1, float depth);
+
+    /**
+     * Checks if an object is hidden by the depths already drawn, from its bounding box in object space. A box
+     * that crosses the near plane is never hidden
+     * \param box_min - the smallest corner of the bounding box, e.g. of the positions of a mesh
+     * \param box_max - the largest corner of the bounding box
+     * \param transform - the object to clip space transformation
+     * \return true if the object is hidden or off the screen
+     */
+    bool occluded(const glm::vec3 &box_min, const glm::vec3 &box_max, const glm::mat4 &transform);
+
+    /**
+     * Turns the depth test (less) on or off, it is on by default
+     * \param enabled - true if the fragments are depth tested and write their depth
+     */
+    void set_depth_test(bool enabled);
+
+    /**
+     * Turns blending on or off, it is off by default. The multisample target is never blended
+     * \param enabled - true if the fragments are blended over the frame buffer by their alpha
+     */
+    void set_blending(bool enabled);
+
+    /**
+     * Changes the faces which are culled, no face is culled by default
+     * \param mode - the culled faces
+     */
+    void set_culling(culling mode);
+
+    /**
+     * Returns the number of triangles through each stage since the last reset_statistics()
+     */
+    const statistics &get_statistics() const;
+
+    /**
+     * Sets the statistics back to zero
+     */
+    void reset_statistics();
+
+private:
+    /**
+     * Transforms, clips and sets up the triangles of a mesh, into setups
+     */
+    void setup_triangles(const std::vector<float> &positions, const std::vector<float> &attributes,
+                         int attribute_count, const std::vector<unsigned int> &indices, const glm::mat4 &transform);
+
+    /**
+     * The culling stage, between the clipper and the setup of a triangle, it counts the culled triangles
+     * \param samples - the sample pattern of the multisample target, nullptr for the pixel centers
+     * \param sample_count - the number of samples
+     * \return true if the triangle can produce no fragments
+     */
+    bool cull(const long long fixed_x[3], const long long fixed_y[3], const glm::ivec2 *samples, int sample_count);
+
+    /**
+     * Culls a triangle or sets it up for the raster stage
+     * \param corners - the indices of its vertices, see clipped_screen
+     * \param samples - the sample pattern of the multisample target, nullptr for the pixel centers
+     * \param sample_count - the number of samples
+     */
+    void add_triangle(const long long fixed_x[3], const long long fixed_y[3], const unsigned int corners[3],
+                      const glm::ivec2 *samples, int sample_count);
+
+    /**
+     * Sets up the triangles of a mesh, and then visits them in order
+     * \param visit - called as visit(rasterizer, interpolator) for each triangle, or each part of a clipped one
+     */
+    template <typename TriangleVisitor>
+    void for_each_triangle(const std::vector<float> &positions, const std::vector<float> &attributes,
+                           int attribute_count, const std::vector<unsigned int> &indices,
+                           const glm::mat4 &transform, TriangleVisitor &visit);
+
+    /**
+     * Shades the pixels of a triangle into the frame buffer, specialized on the depth test and blending
+     * \param fragment - receives the attributes of each fragment, before it is shaded
+     */
+    template <bool DEPTH_TEST, bool BLEND, typename FragmentShader>
+    void shade_triangle(const halfspace_rasterizer &rasterizer, perspective_interpolator &interpolator,
+                        FragmentShader &shade, float *fragment);
+
+    /**
+     * Shades the pixels of a triangle into the frame buffer in 2x2 quads, specialized on the depth test and
+     * blending
+     * \param attribute_count - the number of attributes per vertex
+     */
+    template <bool DEPTH_TEST, bool BLEND, typename QuadShader>
+    void shade_quads(const halfspace_rasterizer &rasterizer, perspective_interpolator &interpolator,
+                     int attribute_count, QuadShader &shade);
+
+    /**
+     * Writes a shaded fragment to the frame buffer, blended over it or not
+     */
+    template <bool BLEND>
+    void write_fragment(int x, int y, Colors::color color);
+
+    /**
+     * The frame buffer to draw into
+     */
+    CustomFrameBuffer &target;
+
+    /**
+     * Clips the triangles and maps them to the viewport
+     */
+    guard_band_clipper clipper;
+
+    /**
+     * The transformed vertices of the current mesh, kept between the draw calls so the vertices of a mesh are
+     * transformed without allocating memory
+     */
+    post_transform_cache vertices;
+
+    /**
+     * The set up triangles of the current mesh
+     */
+    triangle_setup setups;
+
+    /**
+     * The farthest depth of each tile of the depth target, for occluded()
+     */
+    hierarchical_depth hi_z;
+
+    /**
+     * The vertices created by clipping, after the ones of the mesh: corner vertex_count + i of a triangle is
+     * clipped_screen[i], with the attributes at clipped_attributes[i * attribute_count]
+     */
+    std::vector<glm::vec4> clipped_screen;
+    std::vector<float> clipped_attributes;
+
+    /**
+     * The multisample buffer to draw into, nullptr to draw into the frame buffer
+     */
+    MultisampleBuffer *multisample;
+
+    /**
+     * The spans of the rows of a triangle, (y, x_begin, x_end), kept between the triangles of draw_quads()
+     */
+    std::vector<glm::ivec3> spans;
+
+    bool depth_test;
+    bool blending;
+    culling face_culling;
+    statistics counters;
+};
+
+
+template <typename FragmentShader>
+void software_pipeline::draw(const std::vector<float> &positions, const std::vector<float> &attributes,
+                             int attribute_count, const std::vector<unsigned int> &indices,
+                             const glm::mat4 &transform, FragmentShader &shade)
+{
+    float fragment[perspective_interpolator::MAX_ATTRIBUTES];
+    auto shade_pixels = [&](const halfspace_rasterizer &rasterizer, perspective_interpolator &interpolator) {
+        if (this->multisample == nullptr) {
+            if (this->depth_test) {
+                if (this->blending) {
+                    this->shade_triangle<true, true>(rasterizer, interpolator, shade, fragment);
+                } else {
+                    this->shade_triangle<true, false>(rasterizer, interpolator, shade, fragment);
+                }
+            } else {
+                if (this->blending) {
+                    this->shade_triangle<false, true>(rasterizer, interpolator, shade, fragment);
+                } else {
+                    this->shade_triangle<false, false>(rasterizer, interpolator, shade, fragment);
+                }
+            }
+            return;
+        }
+
+        const int sample_count = (int) this->multisample->samples;
+        const glm::ivec2 *pattern = halfspace_rasterizer::sample_pattern(sample_count);
+        int next_x = 0, next_y = -1;
+        auto shade_samples = [&](int x, int y, unsigned int mask) {
+            // the pixels of a row come in order, so the interpolator only restarts on gaps
+            if (x != next_x || y != next_y) {
+                interpolator.begin_span(x, y);
+            } else {
+                interpolator.next_pixel();
+            }
+            next_x = x + 1;
+            next_y = y;
+
+            unsigned int visible = 0;
+            for (int s = 0; s < sample_count; s++) {
+                if (!(mask & (1u << s))) {
+                    continue;
+                }
+                float z = interpolator.depth(pattern[s].x / 16.f, pattern[s].y / 16.f);
+                if (!this->depth_test || (z >= 0.f && z <= 1.f && this->multisample->depthTest(x, y, s, z))) {
+                    visible |= 1u << s;
+                }
+            }
+            if (visible != 0) {
+                // shaded once for all the samples, at the pixel center
+                interpolator.attributes(fragment);
+                this->multisample->writeSamples(x, y, visible, shade(fragment));
+            }
+        };
+        rasterizer.for_each_sample_mask(pattern, sample_count, shade_samples);
+    };
+    this->for_each_triangle(positions, attributes, attribute_count, indices, transform, shade_pixels);
+}
+
+template <typename QuadShader>
+void software_pipeline::draw_quads(const std::vector<float> &positions, const std::vector<float> &attributes,
+                                   int attribute_count, const std::vector<unsigned int> &indices,
+                                   const glm::mat4 &transform, QuadShader &shade)
+{
+    if (this->multisample != nullptr) {
+        throw std::runtime_error("software_pipeline::draw_quads(): Multisample targets are not supported");
+    }
+
+    auto shade_pixels = [&](const halfspace_rasterizer &rasterizer, perspective_interpolator &interpolator) {
+        if (this->depth_test) {
+            if (this->blending) {
+                this->shade_quads<true, true>(rasterizer, interpolator, attribute_count, shade);
+            } else {
+                this->shade_quads<true, false>(rasterizer, interpolator, attribute_count, shade);
+            }
+        } else {
+            if (this->blending) {
+                this->shade_quads<false, true>(rasterizer, interpolator, attribute_count, shade);
+            } else {
+                this->shade_quads<false, false>(rasterizer, interpolator, attribute_count, shade);
+            }
+        }
+    };
+    this->for_each_triangle(positions, attributes, attribute_count, indices, transform, shade_pixels);
+}
+
+template <typename TriangleVisitor>
+void software_pipeline::for_each_triangle(const std::vector<float> &positions, const std::vector<float> &attributes,
+                                          int attribute_count, const std::vector<unsigned int> &indices,
+                                          const glm::mat4 &transform, TriangleVisitor &visit)
+{
+    this->setup_triangles(positions, attributes, attribute_count, indices, transform);
+
+    const size_t vertex_count = this->vertices.vertex_count();
+    for (size_t t = 0; t < this->setups.size(); t++) {
+        glm::vec4 screen[3];
+        const float *corner_attributes[3];
+        for (int v = 0; v < 3; v++) {
+            unsigned int corner = this->setups.corner(t, v);
+            if (corner < vertex_count) {
+                screen[v] = this->vertices.viewport_vertex(corner).screen;
+                corner_attributes[v] = attributes.data() + (size_t) corner * attribute_count;
+            } else {
+                screen[v] = this->clipped_screen[corner - vertex_count];
+                corner_attributes[v] = this->clipped_attributes.data() + (corner - vertex_count) * attribute_count;
+            }
+        }
+
+        halfspace_rasterizer rasterizer = this->setups.rasterizer(t);
+        perspective_interpolator interpolator(screen, corner_attributes, attribute_count);
+        visit(rasterizer, interpolator);
+
+        glm::ivec4 bounds = this->setups.bounds(t);
+        if (this->multisample == nullptr) {
+            // the fragments are written without tracking the damage, the clipped bounding box covers them
+            this->target.markDamaged((uint32_t) bounds.x, (uint32_t) bounds.y, (uint32_t) bounds.z + 1,
+                                     (uint32_t) bounds.w + 1);
+        }
+        if (this->depth_test) {
+            // the samples of a pixel are within half a pixel of its center, one more pixel covers them
+            int margin = this->multisample != nullptr ? 1 : 0;
+            this->hi_z.invalidate(bounds.x - margin, bounds.y - margin, bounds.z + margin, bounds.w + margin);
+        }
+    }
+}
+
+template <bool DEPTH_TEST, bool BLEND, typename FragmentShader>
+void software_pipeline::shade_triangle(const halfspace_rasterizer &rasterizer, perspective_interpolator &interpolator,
+                                       FragmentShader &shade, float *fragment)
+{
+    auto shade_span = [&](int y, int x_begin, int x_end) {
+        interpolator.begin_span(x_begin, y);
+        for (int x = x_begin; x < x_end; x++, interpolator.next_pixel()) {
+            if (DEPTH_TEST) {
+                // early depth test, the fragment is shaded only if it is visible
+                float z = interpolator.depth();
+                if (z < 0.f || z > 1.f || !this->target.depthTest(x, y, z)) {
+                    continue;
+                }
+            }
+            interpolator.attributes(fragment);
+            this->write_fragment<BLEND>(x, y, shade(fragment));
+        }
+    };
+    rasterizer.for_each_span(shade_span);
+}
+
+template <bool DEPTH_TEST, bool BLEND, typename QuadShader>
+void software_pipeline::shade_quads(const halfspace_rasterizer &rasterizer, perspective_interpolator &interpolator,
+                                    int attribute_count, QuadShader &shade)
+{
+    // the triangle is convex, so each row has a single span, and they come from the bottom to the top
+    this->spans.clear();
+    auto collect = [this](int y, int x_begin, int x_end) {
+        this->spans.push_back(glm::ivec3(y, x_begin, x_end));
+    };
+    rasterizer.for_each_span(collect);
+
+    const int max_attributes = perspective_interpolator::MAX_ATTRIBUTES;
+    float quad[4][max_attributes];
+    float depth[4];
+    float ddx[max_attributes], ddy[max_attributes];
+    for (size_t r = 0; r < this->spans.size();) {
+        // the two rows of a row of quads, either one may be empty
+        int quad_y = this->spans[r].x & ~1;
+        glm::ivec2 rows[2] = {glm::ivec2(0, 0), glm::ivec2(0, 0)};
+        for (; r < this->spans.size() && (this->spans[r].x & ~1) == quad_y; r++) {
+            rows[this->spans[r].x - quad_y] = glm::ivec2(this->spans[r].y, this->spans[r].z);
+        }
+        bool empty[2] = {rows[0].x >= rows[0].y, rows[1].x >= rows[1].y};
+        int x_begin = std::min(empty[0] ? INT_MAX : rows[0].x, empty[1] ? INT_MAX : rows[1].x) & ~1;
+        int x_end = std::max(empty[0] ? INT_MIN : rows[0].y, empty[1] ? INT_MIN : rows[1].y);
+
+        for (int quad_x = x_begin; quad_x < x_end; quad_x += 2) {
+            unsigned int covered = 0;
+            for (int k = 0; k < 4; k++) {
+                int x = quad_x + (k & 1);
+                covered |= (unsigned int) (x >= rows[k >> 1].x && x < rows[k >> 1].y) << k;
+            }
+            if (covered == 0) {
+                continue;
+            }
+
+            // all four pixels are interpolated, the ones outside the triangle only give the derivatives
+            for (int k = 0; k < 4; k++) {
+                interpolator.begin_span(quad_x + (k & 1), quad_y + (k >> 1));
+                depth[k] = interpolator.depth();
+                interpolator.attributes(quad[k]);
+            }
+            for (int a = 0; a < attribute_count; a++) {
+                ddx[a] = quad[1][a] - quad[0][a];
+                ddy[a] = quad[2][a] - quad[0][a];
+            }
+
+            for (int k = 0; k < 4; k++) {
+                int x = quad_x + (k & 1), y = quad_y + (k >> 1);
+                if (!(covered & (1u << k))) {
+                    continue;
+                }
+                if (DEPTH_TEST && (depth[k] < 0.f || depth[k] > 1.f || !this->target.depthTest(x, y, depth[k]))) {
+                    continue;
+                }
+                this->write_fragment<BLEND>(x, y, shade(quad[k], ddx, ddy));
+            }
+        }
+    }
+}
+
+template <bool BLEND>
+inline void software_pipeline::write_fragment(int x, int y, Colors::color color)
+{
+    if (BLEND) {
+        // source over destination, the destination is the center of the 3x3 range of the pixel
+        Colors::color destination = this->target.buffer[(x * 3 + 1) + (y * 3 + 1) * this->target.W * 3];
+        color = Colors::mix(destination, color, (color >> 24) / 255.f);
+    }
+    this->target.paintAt<CustomFrameBuffer::fill::solid>(x, y, color);
+}
+
+#endif
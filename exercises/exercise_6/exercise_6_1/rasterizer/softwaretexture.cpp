@@ -0,0 +1,302 @@
+#include "softwaretexture.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+/*
+ * \class software_texture
+ * An RGBA texture for the software pipeline, with a mip chain and nearest, bilinear and trilinear filtering.
+ * The levels are stored in 4x4 texel tiles.
+ */
+
+/*
+ * Parameterized constructor creates a texture and its mip chain
+ * \param pixels - width * height colors, row by row from the bottom (v = 0) to the top (v = 1)
+ * \param width - the width of the image in texels
+ * \param height - the height of the image in texels
+ */
+software_texture::software_texture(const Colors::color *pixels, int width, int height)
+    : filter_mode(trilinear), wrap_mode(repeat)
+{
+    if (pixels == nullptr || width <= 0 || height <= 0) {
+        throw std::runtime_error("software_texture::software_texture(): Invalid image");
+    }
+
+    // the size of the levels, each one half the size of the one before, padded to whole tiles
+    const int tile = 1 << TILE_BITS;
+    size_t size = 0;
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        mip_level level;
+        level.width = w;
+        level.height = h;
+        level.tiles_x = (w + tile - 1) >> TILE_BITS;
+        level.offset = size;
+        size += (size_t) level.tiles_x * ((h + tile - 1) >> TILE_BITS) * tile * tile;
+        this->mip_levels.push_back(level);
+        if (w == 1 && h == 1) {
+            break;
+        }
+    }
+    this->texels.assign(size, 0);
+
+    const mip_level &base = this->mip_levels[0];
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            this->texels[this->address(base, x, y)] = pixels[x + y * width];
+        }
+    }
+
+    // each texel of a level is the average of 2x2 texels of the level before (a box filter)
+    for (size_t l = 1; l < this->mip_levels.size(); l++) {
+        const mip_level &source = this->mip_levels[l - 1];
+        const mip_level &level = this->mip_levels[l];
+        for (int y = 0; y < level.height; y++) {
+            for (int x = 0; x < level.width; x++) {
+                int x0 = std::min(2 * x, source.width - 1), x1 = std::min(2 * x + 1, source.width - 1);
+                int y0 = std::min(2 * y, source.height - 1), y1 = std::min(2 * y + 1, source.height - 1);
+                Colors::color quad[4] = {this->texels[this->address(source, x0, y0)],
+                                         this->texels[this->address(source, x1, y0)],
+                                         this->texels[this->address(source, x0, y1)],
+                                         this->texels[this->address(source, x1, y1)]};
+                Colors::color average = 0;
+                for (int shift = 0; shift < 32; shift += 8) {
+                    unsigned int sum = 2;
+                    for (Colors::color c : quad) {
+                        sum += (c >> shift) & 0xFF;
+                    }
+                    average |= (Colors::color) (sum >> 2) << shift;
+                }
+                this->texels[this->address(level, x, y)] = average;
+            }
+        }
+    }
+}
+
+/*
+ * Destroys the current instance of the texture
+ */
+software_texture::~software_texture()
+{}
+
+/*
+ * Changes the filter used by sample(), it is trilinear by default
+ * \param mode - the filter
+ */
+void software_texture::set_filter(filter mode)
+{
+    this->filter_mode = mode;
+}
+
+/*
+ * Changes how sample() wraps the texture coordinates, they repeat by default
+ * \param mode - the wrap mode
+ */
+void software_texture::set_wrap(wrap mode)
+{
+    this->wrap_mode = mode;
+}
+
+/*
+ * Returns the number of levels of the mip chain, the last one is 1x1
+ */
+int software_texture::levels() const
+{
+    return (int) this->mip_levels.size();
+}
+
+/*
+ * Returns the width of a level in texels
+ */
+int software_texture::width(int level) const
+{
+    return this->mip_levels.at(level).width;
+}
+
+/*
+ * Returns the height of a level in texels
+ */
+int software_texture::height(int level) const
+{
+    return this->mip_levels.at(level).height;
+}
+
+/*
+ * Returns a texel of a level
+ * \param level - the level of the mip chain
+ * \param x - the column of the texel, 0 ... width(level) - 1
+ * \param y - the row of the texel, 0 ... height(level) - 1
+ */
+Colors::color software_texture::texel(int level, int x, int y) const
+{
+    const mip_level &l = this->mip_levels.at(level);
+    if (x < 0 || x >= l.width || y < 0 || y >= l.height) {
+        throw std::runtime_error("software_texture::texel(): Texel out of range");
+    }
+    return this->texels[this->address(l, x, y)];
+}
+
+/*
+ * Computes the level of detail of a pixel, log2 of the number of texels it covers along its longest side
+ * \param dudx - the derivative of u along x
+ * \param dvdx - the derivative of v along x
+ * \param dudy - the derivative of u along y
+ * \param dvdy - the derivative of v along y
+ */
+float software_texture::level_of_detail(float dudx, float dvdx, float dudy, float dvdy) const
+{
+    float w = (float) this->mip_levels[0].width;
+    float h = (float) this->mip_levels[0].height;
+    float along_x = (dudx * w) * (dudx * w) + (dvdx * h) * (dvdx * h);
+    float along_y = (dudy * w) * (dudy * w) + (dvdy * h) * (dvdy * h);
+    // log2 of the square root of the longest one
+    return .5f * std::log2(std::max(std::max(along_x, along_y), 1e-12f));
+}
+
+/*
+ * Samples the texture with its filter
+ * \param u - the horizontal texture coordinate
+ * \param v - the vertical texture coordinate
+ * \param lod - the level of detail, 0 is the full size level
+ * \return the filtered color, each channel in [0, 1]
+ */
+glm::vec4 software_texture::sample(float u, float v, float lod) const
+{
+    const int last = (int) this->mip_levels.size() - 1;
+    lod = std::min(std::max(lod, 0.f), (float) last);
+    switch (this->filter_mode) {
+        case nearest:
+            return this->sample_nearest(this->mip_levels[(int) (lod + .5f)], u, v);
+        case bilinear:
+            return this->sample_bilinear(this->mip_levels[(int) (lod + .5f)], u, v);
+        default: {
+            // blend the two levels around lod
+            int level = (int) lod;
+            float fraction = lod - level;
+            glm::vec4 color = this->sample_bilinear(this->mip_levels[level], u, v);
+            if (fraction > 0.f && level < last) {
+                color += (this->sample_bilinear(this->mip_levels[level + 1], u, v) - color) * fraction;
+            }
+            return color;
+        }
+    }
+}
+
+/*
+ * Samples the texture with its filter, at the level of detail given by the derivatives of u and v
+ * \return the filtered color, each channel in [0, 1]
+ */
+glm::vec4 software_texture::sample(float u, float v, float dudx, float dvdx, float dudy, float dvdy) const
+{
+    return this->sample(u, v, this->level_of_detail(dudx, dvdx, dudy, dvdy));
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * The index in texels of the texel (x, y) of a level
+ */
+size_t software_texture::address(const mip_level &level, int x, int y) const
+{
+    const int mask = (1 << TILE_BITS) - 1;
+    size_t tile = (size_t) (y >> TILE_BITS) * level.tiles_x + (x >> TILE_BITS);
+    return level.offset + (tile << (2 * TILE_BITS)) + ((y & mask) << TILE_BITS) + (x & mask);
+}
+
+/*
+ * Applies the wrap mode to a texel coordinate
+ */
+int software_texture::wrap_coordinate(int c, int size) const
+{
+    if (this->wrap_mode == clamp) {
+        return std::min(std::max(c, 0), size - 1);
+    }
+    c %= size;
+    return c < 0 ? c + size : c;
+}
+
+/*
+ * The texel nearest to (u, v) in a level
+ */
+glm::vec4 software_texture::sample_nearest(const mip_level &level, float u, float v) const
+{
+    int x = this->wrap_coordinate((int) std::floor(u * level.width), level.width);
+    int y = this->wrap_coordinate((int) std::floor(v * level.height), level.height);
+    return unpack(this->texels[this->address(level, x, y)]);
+}
+
+/*
+ * The bilinear interpolation of the four texels around (u, v) in a level
+ */
+glm::vec4 software_texture::sample_bilinear(const mip_level &level, float u, float v) const
+{
+    // the texel centers are at half-integer texel coordinates
+    float tx = u * level.width - .5f;
+    float ty = v * level.height - .5f;
+    float fx0 = std::floor(tx), fy0 = std::floor(ty);
+    int x0 = this->wrap_coordinate((int) fx0, level.width);
+    int y0 = this->wrap_coordinate((int) fy0, level.height);
+    int x1 = this->wrap_coordinate((int) fx0 + 1, level.width);
+    int y1 = this->wrap_coordinate((int) fy0 + 1, level.height);
+
+    const int mask = (1 << TILE_BITS) - 1;
+    Colors::color footprint[4];
+    if (x1 == x0 + 1 && y1 == y0 + 1 && (x0 & mask) != mask && (y0 & mask) != mask) {
+        // the four texels are in the same tile, two pairs of neighbours one tile row apart
+        const Colors::color *p = &this->texels[this->address(level, x0, y0)];
+        footprint[0] = p[0];
+        footprint[1] = p[1];
+        footprint[2] = p[1 << TILE_BITS];
+        footprint[3] = p[(1 << TILE_BITS) + 1];
+    } else {
+        footprint[0] = this->texels[this->address(level, x0, y0)];
+        footprint[1] = this->texels[this->address(level, x1, y0)];
+        footprint[2] = this->texels[this->address(level, x0, y1)];
+        footprint[3] = this->texels[this->address(level, x1, y1)];
+    }
+    return blend(footprint, tx - fx0, ty - fy0);
+}
+
+/*
+ * Unpacks four texels and blends them with the bilinear weights of (fx, fy)
+ * \param texels - the texels (x0, y0), (x1, y0), (x0, y1) and (x1, y1)
+ */
+glm::vec4 software_texture::blend(const Colors::color texels[4], float fx, float fy)
+{
+    float weights[4] = {(1.f - fx) * (1.f - fy), fx * (1.f - fy), (1.f - fx) * fy, fx * fy};
+#if defined(__SSE2__) || defined(_M_X64)
+    // the texels are bytes r, g, b, a in memory order, widened to 16 and then 32 bits
+    const __m128i zero = _mm_setzero_si128();
+    __m128i packed = _mm_loadu_si128((const __m128i *) texels);
+    __m128i low = _mm_unpacklo_epi8(packed, zero);
+    __m128i high = _mm_unpackhi_epi8(packed, zero);
+    __m128 t0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero));
+    __m128 t1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero));
+    __m128 t2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero));
+    __m128 t3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero));
+    __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(t0, _mm_set1_ps(weights[0])),
+                                       _mm_mul_ps(t1, _mm_set1_ps(weights[1]))),
+                            _mm_add_ps(_mm_mul_ps(t2, _mm_set1_ps(weights[2])),
+                                       _mm_mul_ps(t3, _mm_set1_ps(weights[3]))));
+    float result[4];
+    _mm_storeu_ps(result, _mm_mul_ps(sum, _mm_set1_ps(1.f / 255.f)));
+    return glm::vec4(result[0], result[1], result[2], result[3]);
+#else
+    glm::vec4 color(0.f);
+    for (int i = 0; i < 4; i++) {
+        color += unpack(texels[i]) * weights[i];
+    }
+    return color;
+#endif
+}
+
+/*
+ * Unpacks a texel to floats in [0, 1]
+ */
+glm::vec4 software_texture::unpack(Colors::color texel)
+{
+    return glm::vec4((float) (texel & 0xFF), (float) ((texel >> 8) & 0xFF), (float) ((texel >> 16) & 0xFF),
+                     (float) (texel >> 24)) * (1.f / 255.f);
+}
@@ -0,0 +1,168 @@
+#ifndef __SOFTWARE_TEXTURE_H__
+#define __SOFTWARE_TEXTURE_H__
+
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "CustomFrameBuffer.h"
+
+/**
+ * \class software_texture
+ * An RGBA texture for the software pipeline, with a mip chain computed when it is created and nearest,
+ * bilinear and trilinear filtering, like GL_NEAREST_MIPMAP_NEAREST, GL_LINEAR_MIPMAP_NEAREST and
+ * GL_LINEAR_MIPMAP_LINEAR.
+ *
+ * The level of detail comes from the screen space derivatives of the texture coordinates, which
+ * software_pipeline::draw_quads() computes over 2x2 pixel quads. A minified texture is read from a smaller
+ * level, so neighbouring pixels read neighbouring texels instead of jumping across the whole image.
+ *
+ * Each level is stored in 4x4 texel tiles of 64 bytes, so the texels of a bilinear footprint, and of the
+ * footprints of neighbouring pixels, share a cache line in every direction, not only along the rows. When the
+ * four texels of a footprint are in the same tile they are fetched from a single address, and they are
+ * unpacked and weighted four channels at a time with SSE2 (or a scalar loop when it is not available).
+ */
+class software_texture {
+public:
+    /**
+     * The texel filters, within a level and between levels
+     */
+    enum filter {nearest, bilinear, trilinear};
+
+    /**
+     * What happens to texture coordinates outside [0, 1]
+     */
+    enum wrap {repeat, clamp};
+
+    /**
+     * log2 of the width and height of a tile, in texels
+     */
+    static const int TILE_BITS = 2;
+
+    /**
+     * Parameterized constructor creates a texture and its mip chain
+     * \param pixels - width * height colors, row by row from the bottom (v = 0) to the top (v = 1)
+     * \param width - the width of the image in texels
+     * \param height - the height of the image in texels
+     */
+    software_texture(const Colors::color *pixels, int width, int height);
+
+    /**
+     * Destroys the current instance of the texture
+     */
+    virtual ~software_texture();
+
+    /**
+     * Changes the filter used by sample(), it is trilinear by default
+     * \param mode - the filter
+     */
+    void set_filter(filter mode);
+
+    /**
+     * Changes how sample() wraps the texture coordinates, they repeat by default
+     * \param mode - the wrap mode
+     */
+    void set_wrap(wrap mode);
+
+    /**
+     * Returns the number of levels of the mip chain, the last one is 1x1
+     */
+    int levels() const;
+
+    /**
+     * Returns the width of a level in texels
+     */
+    int width(int level = 0) const;
+
+    /**
+     * Returns the height of a level in texels
+     */
+    int height(int level = 0) const;
+
+    /**
+     * Returns a texel of a level
+     * \param level - the level of the mip chain
+     * \param x - the column of the texel, 0 ... width(level) - 1
+     * \param y - the row of the texel, 0 ... height(level) - 1
+     */
+    Colors::color texel(int level, int x, int y) const;
+
+    /**
+     * Computes the level of detail of a pixel, log2 of the number of texels it covers along its longest side
+     * \param dudx - the derivative of u along x
+     * \param dvdx - the derivative of v along x
+     * \param dudy - the derivative of u along y
+     * \param dvdy - the derivative of v along y
+     */
+    float level_of_detail(float dudx, float dvdx, float dudy, float dvdy) const;
+
+    /**
+     * Samples the texture with its filter
+     * \param u - the horizontal texture coordinate
+     * \param v - the vertical texture coordinate
+     * \param lod - the level of detail, 0 is the full size level
+     * \return the filtered color, each channel in [0, 1]
+     */
+    glm::vec4 sample(float u, float v, float lod) const;
+
+    /**
+     * Samples the texture with its filter, at the level of detail given by the derivatives of u and v
+     * \return the filtered color, each channel in [0, 1]
+     */
+    glm::vec4 sample(float u, float v, float dudx, float dvdx, float dudy, float dvdy) const;
+
+private:
+    /**
+     * A level of the mip chain, stored at offset in texels
+     */
+    struct mip_level {
+        int width;
+        int height;
+        int tiles_x;
+        size_t offset;
+    };
+
+    /**
+     * The index in texels of the texel (x, y) of a level
+     */
+    size_t address(const mip_level &level, int x, int y) const;
+
+    /**
+     * Applies the wrap mode to a texel coordinate
+     */
+    int wrap_coordinate(int c, int size) const;
+
+    /**
+     * The texel nearest to (u, v) in a level
+     */
+    glm::vec4 sample_nearest(const mip_level &level, float u, float v) const;
+
+    /**
+     * The bilinear interpolation of the four texels around (u, v) in a level
+     */
+    glm::vec4 sample_bilinear(const mip_level &level, float u, float v) const;
+
+    /**
+     * Unpacks four texels and blends them with the bilinear weights of (fx, fy)
+     * \param texels - the texels (x0, y0), (x1, y0), (x0, y1) and (x1, y1)
+     */
+    static glm::vec4 blend(const Colors::color texels[4], float fx, float fy);
+
+    /**
+     * Unpacks a texel to floats in [0, 1]
+     */
+    static glm::vec4 unpack(Colors::color texel);
+
+    std::vector<Colors::color> texels;
+    std::vector<mip_level> mip_levels;
+
+    filter filter_mode;
+    wrap wrap_mode;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "threadpool.h"
+
+
+/*
+ * \class thread_pool
+ * A small work-stealing thread pool. Every worker owns a queue of tasks; a worker takes tasks from the
+ * back of its own queue and, when it runs dry, steals from the front of the other workers' queues.
+ */
+
+/*
+ * Parameterized constructor creates the worker threads
+ * \param thread_count - the number of workers, 0 uses one worker per hardware thread
+ */
+thread_pool::thread_pool(unsigned int thread_count) : pending(0), stopping(false)
+{
+    if (thread_count == 0) {
+        thread_count = std::thread::hardware_concurrency();
+    }
+    if (thread_count == 0) {
+        thread_count = 1; // hardware_concurrency() is allowed to return 0 when it does not know
+    }
+
+    for (unsigned int i = 0; i < thread_count; i++) {
+        this->queues.emplace_back(new worker_queue());
+    }
+    for (unsigned int i = 0; i < thread_count; i++) {
+        this->workers.emplace_back(&thread_pool::worker_loop, this, i);
+    }
+}
+
+/*
+ * Stops and joins all the worker threads
+ */
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->sleep_lock);
+        this->stopping = true;
+    }
+    this->wake_up.notify_all();
+    for (auto &worker : this->workers) {
+        worker.join();
+    }
+}
+
+/*
+ * Runs task(0), task(1), ..., task(count - 1) on the workers and blocks until all of them are done.
+ * The calling thread helps out with the work while it waits.
+ * \param count - the number of tasks
+ * \param task - the function to run, it receives the index of the task
+ */
+void thread_pool::parallel_for(int count, const std::function<void(int)> &task)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    std::atomic<int> remaining(count);
+    std::mutex done_lock;
+    std::condition_variable done;
+
+    // deal the tasks to the queues round-robin, the workers balance the load by stealing
+    for (int i = 0; i < count; i++) {
+        worker_queue &queue = *this->queues[i % this->queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.emplace_back([i, &task, &remaining, &done_lock, &done]() {
+            task(i);
+            // decrement under the lock, so the waiting caller cannot return while we still touch its locals
+            std::lock_guard<std::mutex> done_guard(done_lock);
+            if (--remaining == 0) {
+                done.notify_all();
+            }
+        });
+    }
+    {
+        std::lock_guard<std::mutex> guard(this->sleep_lock);
+        this->pending += count;
+    }
+    this->wake_up.notify_all();
+
+    // help instead of idling
+    std::function<void()> job;
+    while (remaining > 0 && this->take_task(0, job)) {
+        job();
+    }
+
+    std::unique_lock<std::mutex> done_guard(done_lock);
+    done.wait(done_guard, [&remaining]() { return remaining == 0; });
+}
+
+/*
+ * Returns the number of worker threads
+ */
+unsigned int thread_pool::size() const
+{
+    return (unsigned int) this->workers.size();
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * The loop run by every worker thread
+ * \param index - the index of the worker, i.e. of the queue it owns
+ */
+void thread_pool::worker_loop(unsigned int index)
+{
+    std::function<void()> job;
+    while (true) {
+        if (this->take_task(index, job)) {
+            job();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(this->sleep_lock);
+        this->wake_up.wait(guard, [this]() { return this->stopping || this->pending > 0; });
+        if (this->stopping && this->pending == 0) {
+            return;
+        }
+    }
+}
+
+/*
+ * Takes one task, first from the queue with the given index and then from the other queues
+ * \param index - the index of the preferred queue
+ * \param task - receives the task
+ * \return true if a task was found, else false
+ */
+bool thread_pool::take_task(unsigned int index, std::function<void()> &task)
+{
+    size_t count = this->queues.size();
+    for (size_t i = 0; i < count; i++) {
+        worker_queue &queue = *this->queues[(index + i) % count];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        // the owner works LIFO on its own queue, thieves take the oldest task
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        this->pending--;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,81 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \class thread_pool
+ * A small work-stealing thread pool. Every worker owns a queue of tasks; a worker takes tasks from the
+ * back of its own queue and, when it runs dry, steals from the front of the other workers' queues.
+ * The pool is meant for coarse grained jobs such as rasterizing one screen tile.
+ */
+class thread_pool {
+public:
+    /**
+     * Parameterized constructor creates the worker threads
+     * \param thread_count - the number of workers, 0 uses one worker per hardware thread
+     */
+    explicit thread_pool(unsigned int thread_count = 0);
+
+    /**
+     * Stops and joins all the worker threads
+     */
+    virtual ~thread_pool();
+
+    /**
+     * Runs task(0), task(1), ..., task(count - 1) on the workers and blocks until all of them are done.
+     * The calling thread helps out with the work while it waits.
+     * \param count - the number of tasks
+     * \param task - the function to run, it receives the index of the task
+     */
+    void parallel_for(int count, const std::function<void(int)> &task);
+
+    /**
+     * Returns the number of worker threads
+     */
+    unsigned int size() const;
+
+private:
+    /**
+     * A task queue owned by one worker
+     */
+    struct worker_queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    /**
+     * The loop run by every worker thread
+     * \param index - the index of the worker, i.e. of the queue it owns
+     */
+    void worker_loop(unsigned int index);
+
+    /**
+     * Takes one task, first from the queue with the given index and then from the other queues
+     * \param index - the index of the preferred queue
+     * \param task - receives the task
+     * \return true if a task was found, else false
+     */
+    bool take_task(unsigned int index, std::function<void()> &task);
+
+    std::vector<std::unique_ptr<worker_queue>> queues;
+    std::vector<std::thread> workers;
+
+    /**
+     * Number of tasks pushed but not yet taken, used to put idle workers to sleep
+     */
+    std::atomic<int> pending;
+
+    std::mutex sleep_lock;
+    std::condition_variable wake_up;
+    bool stopping;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "tiledrasterizer.h"
+
+#include <algorithm>
+
+
+/*
+ * \class tiled_rasterizer
+ * A batch rasterizer for whole triangle lists. The screen is divided into square tiles, every triangle is
+ * binned into the tiles its bounding box overlaps, and the tiles are scan-converted in parallel on a
+ * work-stealing thread pool.
+ */
+
+/*
+ * Parameterized constructor creates an instance of a tiled rasterizer
+ * \param width - the width of the screen in pixels
+ * \param height - the height of the screen in pixels
+ * \param tile_size - the width and height of a tile in pixels
+ * \param thread_count - the number of worker threads, 0 uses one per hardware thread
+ */
+tiled_rasterizer::tiled_rasterizer(int width, int height, int tile_size, unsigned int thread_count)
+    : width(width), height(height), tile_size(tile_size), pool(thread_count)
+{
+    if (width <= 0 || height <= 0 || tile_size <= 0) {
+        throw std::runtime_error("tiled_rasterizer::tiled_rasterizer(): Invalid screen or tile size");
+    }
+    this->tile_count_x = (width + tile_size - 1) / tile_size;
+    this->tile_count_y = (height + tile_size - 1) / tile_size;
+    this->chunks.resize(this->pool.size());
+}
+
+/*
+ * Destroys the current instance of the tiled rasterizer
+ */
+tiled_rasterizer::~tiled_rasterizer()
+{}
+
+/*
+ * Returns the number of tiles along x
+ */
+int tiled_rasterizer::tiles_x() const
+{
+    return this->tile_count_x;
+}
+
+/*
+ * Returns the number of tiles along y
+ */
+int tiled_rasterizer::tiles_y() const
+{
+    return this->tile_count_y;
+}
+
+/*
+ * Private functions
+ */
+
+/*
+ * Sorts the triangles into the bins of the tiles they overlap. The triangle list is split in one
+ * contiguous chunk per thread, and every chunk is binned in parallel into its own bins.
+ * \param vertices - three vertices per triangle, in screen coordinates
+ */
+void tiled_rasterizer::bin(const std::vector<glm::ivec2> &vertices)
+{
+    int triangle_count = (int) (vertices.size() / 3);
+    int chunk_count = (int) this->chunks.size();
+    int tile_count = this->tile_count_x * this->tile_count_y;
+
+    this->pool.parallel_for(chunk_count, [&](int c) {
+        chunk_bins &chunk = this->chunks[c];
+        int begin = (int) ((long long) triangle_count * c / chunk_count);
+        int end = (int) ((long long) triangle_count * (c + 1) / chunk_count);
+
+        // first pass counts the triangles per tile ...
+        chunk.offsets.assign(tile_count + 1, 0);
+        int tx0, ty0, tx1, ty1;
+        for (int t = begin; t < end; t++) {
+            if (!this->tile_range(&vertices[t * 3], tx0, ty0, tx1, ty1)) {
+                continue;
+            }
+            for (int ty = ty0; ty <= ty1; ty++) {
+                for (int tx = tx0; tx <= tx1; tx++) {
+                    chunk.offsets[ty * this->tile_count_x + tx + 1]++;
+                }
+            }
+        }
+        for (int i = 0; i < tile_count; i++) {
+            chunk.offsets[i + 1] += chunk.offsets[i];
+        }
+
+        // ... and the second pass writes them in place, keeping the submission order
+        chunk.indices.resize(chunk.offsets[tile_count]);
+        std::vector<int> cursor(chunk.offsets.begin(), chunk.offsets.end() - 1);
+        for (int t = begin; t < end; t++) {
+            if (!this->tile_range(&vertices[t * 3], tx0, ty0, tx1, ty1)) {
+                continue;
+            }
+            for (int ty = ty0; ty <= ty1; ty++) {
+                for (int tx = tx0; tx <= tx1; tx++) {
+                    chunk.indices[cursor[ty * this->tile_count_x + tx]++] = t;
+                }
+            }
+        }
+    });
+}
+
+/*
+ * Computes the range of tiles overlapped by the bounding box of a triangle
+ * \return false if the triangle is completely outside the screen
+ */
+bool tiled_rasterizer::tile_range(const glm::ivec2 *triangle, int &tx0, int &ty0, int &tx1, int &ty1) const
+{
+    int x_min = std::min(triangle[0].x, std::min(triangle[1].x, triangle[2].x));
+    int y_min = std::min(triangle[0].y, std::min(triangle[1].y, triangle[2].y));
+    int x_max = std::max(triangle[0].x, std::max(triangle[1].x, triangle[2].x));
+    int y_max = std::max(triangle[0].y, std::max(triangle[1].y, triangle[2].y));
+
+    if (x_max < 0 || y_max < 0 || x_min >= this->width || y_min >= this->height) {
+        return false;
+    }
+
+    tx0 = std::max(x_min, 0) / this->tile_size;
+    ty0 = std::max(y_min, 0) / this->tile_size;
+    tx1 = std::min(x_max, this->width - 1) / this->tile_size;
+    ty1 = std::min(y_max, this->height - 1) / this->tile_size;
+    return true;
+}
@@ -0,0 +1,131 @@
+#ifndef __TILED_RASTERIZER_H__
+#define __TILED_RASTERIZER_H__
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "threadpool.h"
+#include "halfspacerasterizer.h"
+
+/**
+ * \class tiled_rasterizer
+ * A batch rasterizer for whole triangle lists. The screen is divided into square tiles, every triangle is
+ * binned into the tiles its bounding box overlaps, and the tiles are scan-converted in parallel on a
+ * work-stealing thread pool.
+ *
+ * Each tile is owned by exactly one task and its triangles are visited in submission order, so the result
+ * does not depend on the number of threads or on the scheduling. Every tile runs the block traversal of
+ * halfspace_rasterizer clipped to the tile, so it only tests the blocks of the triangle inside the tile, and
+ * the tiles together produce the pixels of a single halfspace_rasterizer clipped to the screen.
+ */
+class tiled_rasterizer {
+public:
+    /**
+     * Parameterized constructor creates an instance of a tiled rasterizer
+     * \param width - the width of the screen in pixels
+     * \param height - the height of the screen in pixels
+     * \param tile_size - the width and height of a tile in pixels
+     * \param thread_count - the number of worker threads, 0 uses one per hardware thread
+     */
+    tiled_rasterizer(int width, int height, int tile_size = 64, unsigned int thread_count = 0);
+
+    /**
+     * Destroys the current instance of the tiled rasterizer
+     */
+    virtual ~tiled_rasterizer();
+
+    /**
+     * Scan-converts a triangle list
+     * \param vertices - three vertices per triangle, in screen coordinates
+     * \param visit - called as visit(triangle, x, y) for every fragment inside the screen, where triangle is
+     *                the index of the triangle in the list. It is called concurrently for fragments of
+     *                different tiles, and in submission order for the fragments of one tile.
+     */
+    template <typename FragmentVisitor>
+    void rasterize(const std::vector<glm::ivec2> &vertices, FragmentVisitor &visit);
+
+    /**
+     * Returns the number of tiles along x
+     */
+    int tiles_x() const;
+
+    /**
+     * Returns the number of tiles along y
+     */
+    int tiles_y() const;
+
+private:
+    /**
+     * Sorts the triangles into the bins of the tiles they overlap. The triangle list is split in one
+     * contiguous chunk per thread, and every chunk is binned in parallel into its own bins.
+     * \param vertices - three vertices per triangle, in screen coordinates
+     */
+    void bin(const std::vector<glm::ivec2> &vertices);
+
+    /**
+     * Computes the range of tiles overlapped by the bounding box of a triangle
+     * \return false if the triangle is completely outside the screen
+     */
+    bool tile_range(const glm::ivec2 *triangle, int &tx0, int &ty0, int &tx1, int &ty1) const;
+
+    /**
+     * The bins of one chunk of the triangle list, stored as a counting sort:
+     * the triangles of tile t are indices[offsets[t]] ... indices[offsets[t + 1] - 1]
+     */
+    struct chunk_bins {
+        std::vector<int> offsets;
+        std::vector<int> indices;
+    };
+
+    int width;
+    int height;
+    int tile_size;
+    int tile_count_x;
+    int tile_count_y;
+
+    std::vector<chunk_bins> chunks;
+
+    thread_pool pool;
+};
+
+
+template <typename FragmentVisitor>
+void tiled_rasterizer::rasterize(const std::vector<glm::ivec2> &vertices, FragmentVisitor &visit)
+{
+    if (vertices.size() % 3 != 0) {
+        throw std::runtime_error("tiled_rasterizer::rasterize(): The vertex count is not a multiple of 3");
+    }
+
+    this->bin(vertices);
+
+    this->pool.parallel_for(this->tile_count_x * this->tile_count_y, [this, &vertices, &visit](int tile) {
+        int x0 = (tile % this->tile_count_x) * this->tile_size;
+        int y0 = (tile / this->tile_count_x) * this->tile_size;
+        int x1 = std::min(x0 + this->tile_size, this->width) - 1;
+        int y1 = std::min(y0 + this->tile_size, this->height) - 1;
+
+        // chunks hold consecutive ranges of the list, so this visits the triangles in submission order
+        for (const chunk_bins &chunk : this->chunks) {
+            for (int i = chunk.offsets[tile]; i < chunk.offsets[tile + 1]; i++) {
+                int t = chunk.indices[i];
+                const glm::ivec2 *v = &vertices[t * 3];
+                halfspace_rasterizer triangle(v[0].x, v[0].y, v[1].x, v[1].y, v[2].x, v[2].y);
+                triangle.clip(x0, y0, x1, y1);
+                auto emit = [t, &visit](int x, int y, unsigned int mask) {
+                    for (int bit = 0; mask != 0; bit++, mask >>= 1) {
+                        if (mask & 1) {
+                            visit(t, x + bit, y);
+                        }
+                    }
+                };
+                triangle.rasterize(emit);
+            }
+        }
+    });
+}
+
+#endif
@@ -40,6 +40,13 @@ public:
      */
     std::vector<glm::ivec2> all_pixels();
 
+    /**
+     * Visits the pixels inside the triangle as horizontal spans, without allocating memory
+     * \param visit - called as visit(y, x_begin, x_end) for each run of pixels (x_begin, y) ... (x_end - 1, y)
+     */
+    template <typename SpanVisitor>
+    void for_each_span(SpanVisitor &visit);
+
     /**
      * Checks if there are fragments/pixels inside the triangle ready for use
      * \return true if there are more fragments in the triangle, else false is returned
@@ -127,4 +134,31 @@ private:
     bool valid;
 };
 
+
+template <typename SpanVisitor>
+void triangle_rasterizer::for_each_span(SpanVisitor &visit)
+{
+    if (!this->more_fragments()) {
+        return;
+    }
+
+    // the current span, x_last is inclusive
+    int y = this->y_current;
+    int x_first = this->x_current;
+    int x_last = this->x_current;
+    this->next_fragment();
+
+    while (this->more_fragments()) {
+        if (this->y_current == y && this->x_current == x_last + 1) {
+            x_last++;
+        } else {
+            visit(y, x_first, x_last + 1);
+            y = this->y_current;
+            x_first = x_last = this->x_current;
+        }
+        this->next_fragment();
+    }
+    visit(y, x_first, x_last + 1);
+}
+
 #endif
@@ -0,0 +1,159 @@
+#include "trianglesetup.h"
+
+
+/*
+ * \class triangle_setup
+ * The set up triangles of a mesh, stored as a structure of arrays between the vertex stage and the raster stage
+ * of the software pipeline.
+ */
+
+/*
+ * Default constructor creates an empty set of triangles, not clipped
+ */
+triangle_setup::triangle_setup()
+    : clip_x0(-halfspace_rasterizer::MAX_COORDINATE - 1), clip_y0(-halfspace_rasterizer::MAX_COORDINATE - 1),
+      clip_x1(halfspace_rasterizer::MAX_COORDINATE + 1), clip_y1(halfspace_rasterizer::MAX_COORDINATE + 1)
+{}
+
+/*
+ * Destroys the current instance of the triangle setup
+ */
+triangle_setup::~triangle_setup()
+{}
+
+/*
+ * Removes all the triangles, the clipping rectangle is kept
+ */
+void triangle_setup::clear()
+{
+    for (int e = 0; e < 3; e++) {
+        this->step_x[e].clear();
+        this->step_y[e].clear();
+        this->offset[e].clear();
+        this->corners[e].clear();
+    }
+    this->x_min.clear();
+    this->y_min.clear();
+    this->x_max.clear();
+    this->y_max.clear();
+    this->fixed_x_min.clear();
+    this->fixed_y_min.clear();
+    this->fixed_x_max.clear();
+    this->fixed_y_max.clear();
+    this->covered.clear();
+}
+
+/*
+ * Restricts the triangles to a rectangle, e.g. the screen, before any of them is added
+ * \param x0 - the smallest x-coordinate inside the rectangle
+ * \param y0 - the smallest y-coordinate inside the rectangle
+ * \param x1 - the largest x-coordinate inside the rectangle
+ * \param y1 - the largest y-coordinate inside the rectangle
+ */
+void triangle_setup::clip(int x0, int y0, int x1, int y1)
+{
+    if (this->size() != 0) {
+        throw std::runtime_error("triangle_setup::clip(): Triangles were already added");
+    }
+    this->clip_x0 = x0;
+    this->clip_y0 = y0;
+    this->clip_x1 = x1;
+    this->clip_y1 = y1;
+}
+
+/*
+ * Sets up a triangle and adds it, unless it is degenerated or covers no pixel center
+ * \param fixed_x - the x-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+ * \param fixed_y - the y-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+ * \param corners - the indices of the three vertices, returned by corner()
+ * \param keep_uncovered - true to also add a triangle that covers no pixel center, e.g. for multisampling
+ * \return true if the triangle was added
+ */
+bool triangle_setup::add(const long long fixed_x[3], const long long fixed_y[3], const unsigned int corners[3],
+                         bool keep_uncovered)
+{
+    // the rasterizer does the setup, and its results are scattered to the arrays
+    halfspace_rasterizer triangle(fixed_x, fixed_y);
+    triangle.clip(this->clip_x0, this->clip_y0, this->clip_x1, this->clip_y1);
+    if (!triangle.has_area || (!triangle.valid && !keep_uncovered)) {
+        return false;
+    }
+
+    for (int e = 0; e < 3; e++) {
+        this->step_x[e].push_back(triangle.step_x[e]);
+        this->step_y[e].push_back(triangle.step_y[e]);
+        this->offset[e].push_back(triangle.offset[e]);
+        this->corners[e].push_back(corners[e]);
+    }
+    this->x_min.push_back(triangle.x_min);
+    this->y_min.push_back(triangle.y_min);
+    this->x_max.push_back(triangle.x_max);
+    this->y_max.push_back(triangle.y_max);
+    this->fixed_x_min.push_back(triangle.fixed_x_min);
+    this->fixed_y_min.push_back(triangle.fixed_y_min);
+    this->fixed_x_max.push_back(triangle.fixed_x_max);
+    this->fixed_y_max.push_back(triangle.fixed_y_max);
+    this->covered.push_back(triangle.valid ? 1 : 0);
+    return true;
+}
+
+/*
+ * Returns the number of triangles
+ */
+size_t triangle_setup::size() const
+{
+    return this->covered.size();
+}
+
+/*
+ * Returns the index of a corner of a triangle
+ * \param triangle - the triangle, less than size()
+ * \param v - the corner, 0, 1 or 2
+ */
+unsigned int triangle_setup::corner(size_t triangle, int v) const
+{
+    return this->corners[v][triangle];
+}
+
+/*
+ * Returns the bounding box of a triangle in pixels, clipped, as (x_min, y_min, x_max, y_max)
+ * \param triangle - the triangle, less than size()
+ */
+glm::ivec4 triangle_setup::bounds(size_t triangle) const
+{
+    return glm::ivec4(this->x_min[triangle], this->y_min[triangle], this->x_max[triangle], this->y_max[triangle]);
+}
+
+/*
+ * Returns a rasterizer for a triangle, as if it was built from its vertices and clipped
+ * \param triangle - the triangle, less than size()
+ */
+halfspace_rasterizer triangle_setup::rasterizer(size_t triangle) const
+{
+    if (triangle >= this->size()) {
+        throw std::runtime_error("triangle_setup::rasterizer(): Triangle out of range");
+    }
+
+    halfspace_rasterizer result;
+    for (int e = 0; e < 3; e++) {
+        result.step_x[e] = this->step_x[e][triangle];
+        result.step_y[e] = this->step_y[e][triangle];
+        result.offset[e] = this->offset[e][triangle];
+    }
+    result.x_min = this->x_min[triangle];
+    result.y_min = this->y_min[triangle];
+    result.x_max = this->x_max[triangle];
+    result.y_max = this->y_max[triangle];
+    result.fixed_x_min = this->fixed_x_min[triangle];
+    result.fixed_y_min = this->fixed_y_min[triangle];
+    result.fixed_x_max = this->fixed_x_max[triangle];
+    result.fixed_y_max = this->fixed_y_max[triangle];
+    // the stored bounding box is already clipped, the rectangle is only for the sample traversal
+    result.clip_x0 = this->clip_x0;
+    result.clip_y0 = this->clip_y0;
+    result.clip_x1 = this->clip_x1;
+    result.clip_y1 = this->clip_y1;
+    result.has_area = true;
+    result.valid = this->covered[triangle] != 0;
+    return result;
+}
@@ -0,0 +1,110 @@
+#ifndef __TRIANGLE_SETUP_H__
+#define __TRIANGLE_SETUP_H__
+
+#include <stdexcept>
+#include <vector>
+
+#include "halfspacerasterizer.h"
+
+/**
+ * \class triangle_setup
+ * The set up triangles of a mesh, between the vertex stage and the raster stage of the software pipeline.
+ * Each triangle is stored as the edge functions and the bounding box that halfspace_rasterizer computes, plus
+ * the indices of its three corners, so the raster stage can interpolate their attributes.
+ *
+ * The triangles are stored as a structure of arrays: one array per coefficient, indexed by triangle. The
+ * setup of a whole mesh is done in one pass, and later passes that only read a few of the values, e.g. the
+ * bounding boxes, walk through a few dense arrays instead of the whole setup of every triangle.
+ */
+class triangle_setup {
+public:
+    /**
+     * Default constructor creates an empty set of triangles, not clipped
+     */
+    triangle_setup();
+
+    /**
+     * Destroys the current instance of the triangle setup
+     */
+    virtual ~triangle_setup();
+
+    /**
+     * Removes all the triangles, the clipping rectangle is kept
+     */
+    void clear();
+
+    /**
+     * Restricts the triangles to a rectangle, e.g. the screen, before any of them is added
+     * \param x0 - the smallest x-coordinate inside the rectangle
+     * \param y0 - the smallest y-coordinate inside the rectangle
+     * \param x1 - the largest x-coordinate inside the rectangle
+     * \param y1 - the largest y-coordinate inside the rectangle
+     */
+    void clip(int x0, int y0, int x1, int y1);
+
+    /**
+     * Sets up a triangle and adds it, unless it is degenerated or covers no pixel center
+     * \param fixed_x - the x-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+     * \param fixed_y - the y-coordinates of the three vertices, in fixed point with SUBPIXEL_BITS fractional bits
+     * \param corners - the indices of the three vertices, returned by corner()
+     * \param keep_uncovered - true to also add a triangle that covers no pixel center, e.g. for multisampling
+     * \return true if the triangle was added
+     */
+    bool add(const long long fixed_x[3], const long long fixed_y[3], const unsigned int corners[3],
+             bool keep_uncovered = false);
+
+    /**
+     * Returns the number of triangles
+     */
+    size_t size() const;
+
+    /**
+     * Returns the index of a corner of a triangle
+     * \param triangle - the triangle, less than size()
+     * \param v - the corner, 0, 1 or 2
+     */
+    unsigned int corner(size_t triangle, int v) const;
+
+    /**
+     * Returns the bounding box of a triangle in pixels, clipped, as (x_min, y_min, x_max, y_max)
+     * \param triangle - the triangle, less than size()
+     */
+    glm::ivec4 bounds(size_t triangle) const;
+
+    /**
+     * Returns a rasterizer for a triangle, as if it was built from its vertices and clipped
+     * \param triangle - the triangle, less than size()
+     */
+    halfspace_rasterizer rasterizer(size_t triangle) const;
+
+private:
+    /**
+     * The edge functions, as in halfspace_rasterizer
+     */
+    std::vector<long long> step_x[3];
+    std::vector<long long> step_y[3];
+    std::vector<long long> offset[3];
+
+    /**
+     * The bounding boxes, in pixels (clipped) and in fixed point
+     */
+    std::vector<int> x_min; std::vector<int> y_min;
+    std::vector<int> x_max; std::vector<int> y_max;
+    std::vector<long long> fixed_x_min; std::vector<long long> fixed_y_min;
+    std::vector<long long> fixed_x_max; std::vector<long long> fixed_y_max;
+
+    /**
+     * covered is 1 if the triangle covers a pixel center
+     */
+    std::vector<unsigned char> covered;
+
+    std::vector<unsigned int> corners[3];
+
+    /**
+     * The clipping rectangle
+     */
+    int clip_x0; int clip_y0;
+    int clip_x1; int clip_y1;
+};
+
+#endif
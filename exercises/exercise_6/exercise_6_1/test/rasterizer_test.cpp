@@ -0,0 +1,420 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "halfspacerasterizer.h"
+#include "linerasterizer.h"
+#include "polylinerasterizer.h"
+#include "tiledrasterizer.h"
+#include "CustomFrameBuffer.h"
+#include "TypedFrameBuffer.h"
+
+// Checks of the rasterizers of exercise 6 which need no window or OpenGL context. Every check prints what went
+// wrong, and the program returns the number of failed checks, so it can run as a test from ctest.
+
+
+static int failures = 0;
+
+void check(bool condition, const std::string &message){
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", message.c_str());
+        failures++;
+    }
+}
+
+// triangles of every size, some of them partly or completely outside the screen, and a few degenerated ones
+std::vector<glm::ivec2> randomTriangles(int width, int height, int count, unsigned int seed){
+    std::mt19937 random(seed);
+    auto coordinate = [&](int low, int high) { return std::uniform_int_distribution<int>(low, high)(random); };
+    std::vector<glm::ivec2> vertices;
+    for (int i = 0; i < count; i++) {
+        int reach = i % 3 == 0 ? width : i % 3 == 1 ? 40 : 6;
+        glm::ivec2 center(coordinate(-20, width + 20), coordinate(-20, height + 20));
+        for (int v = 0; v < 3; v++)
+            vertices.push_back(center + glm::ivec2(coordinate(-reach, reach), coordinate(-reach, reach)));
+        if (i % 50 == 0)
+            vertices.back() = vertices[vertices.size() - 2];
+    }
+    return vertices;
+}
+
+
+// the fill convention: triangles which share an edge cover each pixel center on the edge exactly once
+// ---------------------------------------------------------------------------------
+// counts the fragments of a triangle per pixel, with the coverage masks and with the spans, which are computed
+// separately from the edge functions
+void addCoverage(const long long fixedX[3], const long long fixedY[3], int width, int height,
+                 std::vector<int> &masks, std::vector<int> &spans, bool &inside){
+    halfspace_rasterizer triangle(fixedX, fixedY);
+    auto mask = [&](int x, int y, unsigned int bits) {
+        for (int i = 0; i < 8; i++) {
+            if (bits & (1u << i)) {
+                if (x + i < 0 || y < 0 || x + i >= width || y >= height)
+                    inside = false;
+                else
+                    masks[y * width + x + i]++;
+            }
+        }
+    };
+    auto span = [&](int y, int xBegin, int xEnd) {
+        for (int x = xBegin; x < xEnd; x++) {
+            if (x < 0 || y < 0 || x >= width || y >= height)
+                inside = false;
+            else
+                spans[y * width + x]++;
+        }
+    };
+    triangle.rasterize(mask);
+    triangle.for_each_span(span);
+}
+
+// the four pixel centers of a side of a square are on its edges, and so are the ones on its diagonal; the
+// bottom and left sides are inside, the top and right ones are not, and each diagonal center is in one triangle
+void testFillConventionTies(){
+    const int one = 1 << halfspace_rasterizer::SUBPIXEL_BITS;
+    // {x, y} of the corners of the square, split along either diagonal, in both windings
+    const int corners[4][2] = {{0, 0}, {4, 0}, {4, 4}, {0, 4}};
+    const int splits[4][2][3] = {{{0, 1, 3}, {1, 2, 3}}, {{0, 3, 1}, {1, 3, 2}},
+                                 {{0, 1, 2}, {0, 2, 3}}, {{0, 2, 1}, {0, 3, 2}}};
+    for (int split = 0; split < 4; split++) {
+        std::vector<int> masks(6 * 6, 0), spans(6 * 6, 0);
+        bool inside = true;
+        for (int t = 0; t < 2; t++) {
+            long long x[3], y[3];
+            for (int v = 0; v < 3; v++) {
+                // one pixel of margin, so the pixels just outside the square can be seen
+                x[v] = (long long) (corners[splits[split][t][v]][0] + 1) * one;
+                y[v] = (long long) (corners[splits[split][t][v]][1] + 1) * one;
+            }
+            addCoverage(x, y, 6, 6, masks, spans, inside);
+        }
+        bool once = true;
+        for (int y = 0; y < 6; y++)
+            for (int x = 0; x < 6; x++)
+                once = once && masks[y * 6 + x] == (x >= 1 && x <= 4 && y >= 1 && y <= 4 ? 1 : 0);
+        std::string name = "split " + std::to_string(split) + " of a 4x4 square";
+        check(inside && once, name + ": not every pixel of the square is covered exactly once");
+        check(spans == masks, name + ": the spans differ from the coverage masks");
+    }
+}
+
+// a mesh of triangles with subpixel vertices, some of them on pixel centers, covers every pixel of the rectangle
+// it fills exactly once, whatever the winding of the triangles and the diagonal of each cell
+void testSharedEdgesCoverOnce(){
+    const int one = 1 << halfspace_rasterizer::SUBPIXEL_BITS;
+    const int cells = 24, cellSize = 6, size = cells * cellSize;
+    std::mt19937 random(11);
+    auto jitter = [&]() { return std::uniform_int_distribution<int>(-one, one)(random); };
+
+    // the corners of the cells, moved by less than a quarter of a cell (the cells stay convex), and the ones on
+    // the border only along it; every third vertex is moved back to a pixel center, where the ties are
+    std::vector<long long> x((cells + 1) * (cells + 1)), y((cells + 1) * (cells + 1));
+    for (int j = 0; j <= cells; j++) {
+        for (int i = 0; i <= cells; i++) {
+            long long vx = (long long) i * cellSize * one, vy = (long long) j * cellSize * one;
+            if (i > 0 && i < cells)
+                vx += jitter();
+            if (j > 0 && j < cells)
+                vy += jitter();
+            if ((i + j * (cells + 1)) % 3 == 0) {
+                vx = (vx + one / 2) / one * one;
+                vy = (vy + one / 2) / one * one;
+            }
+            x[j * (cells + 1) + i] = vx;
+            y[j * (cells + 1) + i] = vy;
+        }
+    }
+
+    std::vector<int> masks(size * size, 0), spans(size * size, 0);
+    bool inside = true;
+    for (int j = 0; j < cells; j++) {
+        for (int i = 0; i < cells; i++) {
+            int a = j * (cells + 1) + i, b = a + 1, c = a + cells + 2, d = a + cells + 1;
+            int triangles[2][3] = {{a, b, c}, {a, c, d}};
+            if (random() % 2) {
+                int other[2][3] = {{a, b, d}, {b, c, d}};
+                std::copy(&other[0][0], &other[0][0] + 6, &triangles[0][0]);
+            }
+            for (int t = 0; t < 2; t++) {
+                if (random() % 2)
+                    std::swap(triangles[t][1], triangles[t][2]);
+                long long tx[3] = {x[triangles[t][0]], x[triangles[t][1]], x[triangles[t][2]]};
+                long long ty[3] = {y[triangles[t][0]], y[triangles[t][1]], y[triangles[t][2]]};
+                addCoverage(tx, ty, size, size, masks, spans, inside);
+            }
+        }
+    }
+
+    // the rectangle is [0, size] on both axes, the pixels of its right column and top row are outside the buffer
+    bool once = std::all_of(masks.begin(), masks.end(), [](int count) { return count == 1; });
+    check(inside, "mesh: fragment outside the rectangle, or on its right or top side");
+    check(once, "mesh: not every pixel of the rectangle is covered exactly once");
+    check(spans == masks, "mesh: the spans differ from the coverage masks");
+}
+
+
+// the tiled rasterizer gives every pixel the same triangles, in the same order, as one rasterizer on one thread
+// ---------------------------------------------------------------------------------
+void testTiledMatchesSingleThread(){
+    const int width = 301, height = 203;
+    std::vector<glm::ivec2> vertices = randomTriangles(width, height, 2000, 7);
+
+    // the number of fragments of every pixel, and the last triangle which covered it
+    std::vector<int> expectedCount(width * height, 0), expectedLast(width * height, -1);
+    for (size_t t = 0; t < vertices.size() / 3; t++) {
+        const glm::ivec2 *v = &vertices[t * 3];
+        halfspace_rasterizer triangle(v[0].x, v[0].y, v[1].x, v[1].y, v[2].x, v[2].y);
+        triangle.clip(0, 0, width - 1, height - 1);
+        auto visit = [&](int x, int y, unsigned int mask) {
+            for (int i = 0; i < 8; i++) {
+                if (mask & (1u << i)) {
+                    expectedCount[y * width + x + i]++;
+                    expectedLast[y * width + x + i] = (int) t;
+                }
+            }
+        };
+        triangle.rasterize(visit);
+    }
+
+    const int tileSizes[] = {16, 64, 37};
+    const unsigned int threadCounts[] = {1, 4, 7};
+    for (int tileSize : tileSizes) {
+        for (unsigned int threads : threadCounts) {
+            std::vector<int> count(width * height, 0), last(width * height, -1);
+            std::atomic<bool> inside(true);
+            auto visit = [&](int t, int x, int y) {
+                if (x < 0 || y < 0 || x >= width || y >= height) {
+                    inside = false;
+                    return;
+                }
+                count[y * width + x]++;
+                last[y * width + x] = t;
+            };
+            tiled_rasterizer rasterizer(width, height, tileSize, threads);
+            // twice, the second run reuses the bins of the first one
+            for (int run = 0; run < 2; run++) {
+                std::fill(count.begin(), count.end(), 0);
+                std::fill(last.begin(), last.end(), -1);
+                rasterizer.rasterize(vertices, visit);
+            }
+
+            std::string name = "tiled_rasterizer with " + std::to_string(tileSize) + " pixel tiles and " +
+                               std::to_string(threads) + " threads";
+            check(inside.load(), name + ": fragment outside the screen");
+            check(count == expectedCount, name + ": the fragments of a pixel differ from one halfspace_rasterizer");
+            check(last == expectedLast, name + ": the triangles of a pixel are not in submission order");
+        }
+    }
+}
+
+
+// the span walkers of LineRasterizer and polyline_rasterizer give the pixels of LineRasterizer, in every octant
+// ---------------------------------------------------------------------------------
+typedef std::vector<std::pair<int, int>> pixelList;
+
+void testLineSpansMatchLineRasterizer(){
+    bool lineSpans = true, polylineSpans = true;
+    const polyline_rasterizer polyline;
+    // every direction up to 9 pixels away, so each octant, the axes and the diagonals are all walked
+    for (int dy = -9; dy <= 9; dy++) {
+        for (int dx = -9; dx <= 9; dx++) {
+            if (dx == 0 && dy == 0)
+                continue;
+            const glm::ivec2 points[2] = {{5, -4}, {5 + dx, -4 + dy}};
+            LineRasterizer line(points[0].x, points[0].y, points[1].x, points[1].y);
+            pixelList expected;
+            for (const glm::ivec2 &p : line.all_pixels())
+                expected.push_back({p.x, p.y});
+            std::sort(expected.begin(), expected.end());
+
+            pixelList fromLine, fromPolyline;
+            auto addLine = [&fromLine](int y, int xBegin, int xEnd) {
+                for (int x = xBegin; x < xEnd; x++)
+                    fromLine.push_back({x, y});
+            };
+            auto addPolyline = [&fromPolyline](int y, int xBegin, int xEnd) {
+                for (int x = xBegin; x < xEnd; x++)
+                    fromPolyline.push_back({x, y});
+            };
+            LineRasterizer(points[0].x, points[0].y, points[1].x, points[1].y).for_each_span(addLine);
+            polyline.for_each_span(points, 2, false, addPolyline);
+            std::sort(fromLine.begin(), fromLine.end());
+            std::sort(fromPolyline.begin(), fromPolyline.end());
+            lineSpans = lineSpans && fromLine == expected;
+            polylineSpans = polylineSpans && fromPolyline == expected;
+        }
+    }
+    check(lineSpans, "LineRasterizer::for_each_span differs from the pixels of LineRasterizer");
+    check(polylineSpans, "polyline_rasterizer::for_each_span differs from the pixels of LineRasterizer");
+}
+
+// a wide polyline covers every pixel its segments cover on their own, also where it turns
+// ---------------------------------------------------------------------------------
+pixelList widePixels(const polyline_rasterizer &rasterizer, const glm::vec2 *points, int count){
+    pixelList pixels;
+    auto add = [&pixels](int x, int y, float) {
+        pixels.push_back({x, y});
+    };
+    rasterizer.for_each_fragment(points, count, false, add);
+    std::sort(pixels.begin(), pixels.end());
+    pixels.erase(std::unique(pixels.begin(), pixels.end()), pixels.end());
+    return pixels;
+}
+
+void testWideJoinsCoverTheSegments(){
+    // a right angle, both turns of a zigzag, a sharp turn back and a shallow one
+    const std::vector<std::vector<glm::vec2>> strips = {
+        {{0.f, 0.f}, {10.f, 0.f}, {10.f, 10.f}},
+        {{0.f, 0.f}, {12.f, 5.f}, {2.f, 11.f}, {14.f, 17.f}},
+        {{0.f, 0.f}, {15.f, 3.f}, {1.f, 6.f}},
+        {{0.f, 0.f}, {9.f, 2.f}, {20.f, 3.f}},
+    };
+    for (float width : {2.f, 3.f, 5.f, 8.f}) {
+        for (bool antialiased : {false, true}) {
+            const polyline_rasterizer rasterizer(width, antialiased);
+            bool covered = true;
+            for (const auto &strip : strips) {
+                pixelList segments;
+                for (size_t i = 0; i + 1 < strip.size(); i++) {
+                    pixelList segment = widePixels(rasterizer, &strip[i], 2);
+                    segments.insert(segments.end(), segment.begin(), segment.end());
+                }
+                std::sort(segments.begin(), segments.end());
+                segments.erase(std::unique(segments.begin(), segments.end()), segments.end());
+                covered = covered && widePixels(rasterizer, strip.data(), (int) strip.size()) == segments;
+            }
+            check(covered, "width " + std::to_string((int) width) + (antialiased ? " anti-aliased" : "") +
+                           ": a polyline misses pixels of its segments at a joint");
+        }
+    }
+
+    // the first row of the second segment reaches right of the end of the first one
+    const polyline_rasterizer rasterizer(5.f);
+    const glm::vec2 corner[3] = {{0.f, 0.f}, {10.f, 0.f}, {10.f, 10.f}};
+    pixelList pixels = widePixels(rasterizer, corner, 3);
+    for (int x : {11, 12})
+        check(std::binary_search(pixels.begin(), pixels.end(), std::make_pair(x, 0)),
+              "width 5 corner: pixel (" + std::to_string(x) + ", 0) is missing");
+}
+
+// a typed frame buffer gives back the values written in it, and toColors() puts them back in rows (detiling)
+// ---------------------------------------------------------------------------------
+template <typename Format, typename Layout, typename RandomValue>
+void checkRoundTrip(const std::string &name, RandomValue randomValue){
+    // not a multiple of the tiles, so the padding is skipped when detiling
+    const uint32_t width = 37, height = 21;
+    TypedFrameBuffer<Format, Layout> buffer(width, height);
+    std::vector<typename Format::value> expected(width * height);
+    std::mt19937 random(3);
+
+    buffer.clear(randomValue(random));
+    for (uint32_t y = 0; y < height; y++) {
+        // a span on every other row, and single pixels on the others
+        if (y % 2 == 0) {
+            uint32_t xBegin = random() % width, xEnd = xBegin + random() % (width - xBegin + 1);
+            typename Format::value v = randomValue(random);
+            buffer.setSpan(y, 0, width, randomValue(random));
+            buffer.setSpan(y, xBegin, xEnd, v);
+            for (uint32_t x = 0; x < width; x++)
+                expected[y * width + x] = x >= xBegin && x < xEnd ? v : buffer.get(x, y);
+        } else {
+            for (uint32_t x = 0; x < width; x++) {
+                expected[y * width + x] = randomValue(random);
+                buffer.set(x, y, expected[y * width + x]);
+            }
+        }
+    }
+
+    std::vector<Colors::color> colors(width * height);
+    buffer.toColors(colors.data());
+    bool readBack = true, detiled = true;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            typename Format::storage stored = Format::pack(expected[y * width + x]);
+            readBack = readBack && Format::pack(buffer.get(x, y)) == stored;
+            detiled = detiled && colors[y * width + x] == Format::toColor(stored);
+        }
+    }
+    check(readBack, name + ": get() differs from the values written");
+    check(detiled, name + ": toColors() differs from the values written");
+}
+
+void testTypedFrameBufferRoundTrip(){
+    auto randomColor = [](std::mt19937 &random) { return (Colors::color) random(); };
+    auto randomDepth = [](std::mt19937 &random) { return std::uniform_real_distribution<float>(0.f, 1.f)(random); };
+    checkRoundTrip<Formats::RGBA8, Layouts::Tiled>("RGBA8 tiled", randomColor);
+    checkRoundTrip<Formats::RGBA8, Layouts::Linear>("RGBA8 linear", randomColor);
+    checkRoundTrip<Formats::RGB565, Layouts::Tiled>("RGB565 tiled", randomColor);
+    checkRoundTrip<Formats::Depth24, Layouts::Linear>("Depth24 linear", randomDepth);
+    checkRoundTrip<Formats::Depth24, Layouts::Tiled>("Depth24 tiled", randomDepth);
+    checkRoundTrip<Formats::R32F, Layouts::Linear>("R32F linear", randomDepth);
+
+    // every one of the 2^24 depths, they are all a float apart near 1
+    uint32_t wrong = 0;
+    for (uint32_t s = 0; s <= Formats::Depth24::MAX; s++)
+        wrong += Formats::Depth24::pack(Formats::Depth24::unpack(s)) != s;
+    check(wrong == 0, "Depth24: " + std::to_string(wrong) + " depths do not unpack to themselves");
+}
+
+
+// clearing to the grid restores the painted pixels to it, and after the first clear only they are damaged
+// ---------------------------------------------------------------------------------
+void testGridClearDamage(){
+    const uint32_t width = 32, height = 24, size = width * height * 9;
+    CustomFrameBuffer grid(width, height), buffer(width, height);
+    for (uint32_t y = 0; y < height; y++)
+        grid.paintSpan(y, 0, width, Colors::dark, CustomFrameBuffer::fill::frame);
+
+    bool restored = true, covered = true, partial = true;
+    for (uint32_t frame = 0; frame < 8; frame++) {
+        std::vector<Colors::color> before(buffer.buffer, buffer.buffer + size);
+        buffer.clearDamage();
+        buffer.clearBuffer(Colors::black, Colors::dark);
+        restored = restored && std::equal(buffer.buffer, buffer.buffer + size, grid.buffer);
+        buffer.paintSpan(frame + 2, frame, frame + 6, Colors::green, CustomFrameBuffer::fill::solid);
+        buffer.paintAt(20, frame, Colors::blue, CustomFrameBuffer::fill::frame);
+
+        uint32_t area = 0;
+        for (const auto &r : buffer.damagedRegions())
+            area += (r.x1 - r.x0) * (r.y1 - r.y0);
+        partial = partial && (frame == 0 || area < width * height / 4);
+        for (uint32_t i = 0; i < size; i++) {
+            if (buffer.buffer[i] == before[i])
+                continue;
+            uint32_t x = i % (width * 3) / 3, y = i / (width * 3) / 3;
+            bool inside = false;
+            for (const auto &r : buffer.damagedRegions())
+                inside = inside || (x >= r.x0 && x < r.x1 && y >= r.y0 && y < r.y1);
+            covered = covered && inside;
+        }
+    }
+    check(restored, "grid clear: the cleared buffer differs from the painted grid");
+    check(covered, "grid clear: a changed pixel is outside the damaged regions");
+    check(partial, "grid clear: a clear after the first one damaged the whole buffer");
+}
+
+
+int main()
+{
+    const std::pair<const char *, std::function<void()>> tests[] = {
+        {"fill convention ties", testFillConventionTies},
+        {"shared edges cover once", testSharedEdgesCoverOnce},
+        {"tiled rasterizer matches single thread", testTiledMatchesSingleThread},
+        {"line spans match LineRasterizer", testLineSpansMatchLineRasterizer},
+        {"wide joins cover the segments", testWideJoinsCoverTheSegments},
+        {"typed frame buffer round trip", testTypedFrameBufferRoundTrip},
+        {"grid clear damages only the painted pixels", testGridClearDamage},
+    };
+    for (const auto &test : tests) {
+        int before = failures;
+        test.second();
+        printf("%-50s %s\n", test.first, failures == before ? "ok" : "FAILED");
+    }
+    return failures;
+}